@@ -0,0 +1,550 @@
+#ifndef __AABB_TREE_H__
+#define __AABB_TREE_H__
+
+#include "MathGeoLib\include\MathGeoLib.h"
+
+#include "DebugDraw.h"
+
+#include <vector>
+#include <unordered_map>
+#include <queue>
+#include <functional>
+
+#define AABB_TREE_NULL -1
+#define AABB_TREE_MARGIN 1.0f //Extra space added to each leaf so small movements don't touch the tree
+
+template<typename Type> class AABBTree;
+
+template<typename Type>
+struct AABBTreeNode
+{
+	bool IsLeaf()const { return child1 == AABB_TREE_NULL; }
+
+	math::AABB fat_box; //Leaf: tight box + margin. Branch: union of the children
+	math::AABB box; //Tight box. Only valid for leaves.
+	Type object;
+
+	int parent = AABB_TREE_NULL; //Next free node when the node is in the free list
+	int child1 = AABB_TREE_NULL;
+	int child2 = AABB_TREE_NULL;
+	int height = -1; //Leaf = 0, Free node = -1
+};
+
+/*
+	Dynamic bounding volume hierarchy for moving objects. Leaves hold fat AABBs so an object can move inside its
+	margin without touching the tree. When it leaves the margin it's reinserted choosing the sibling with the
+	surface area heuristic, and the path up to the root is rebalanced with tree rotations.
+	Nodes live in a single array with a free list.
+*/
+template<typename Type>
+class AABBTree
+{
+public:
+	AABBTree();
+	~AABBTree();
+
+	bool Insert(Type object, const math::AABB& box);
+	bool Remove(Type object);
+	bool Update(Type object, const math::AABB& box); //Returns true if the object had to be reinserted
+	bool Contains(Type object)const;
+	void Clear();
+	void Draw()const;
+	unsigned int Size()const;
+	int GetHeight()const;
+
+	template<typename Primitive>
+	bool Intersect(std::vector<Type>& results, Primitive& prim)const;
+
+	/*
+		Visits the leaves in order of ray entry distance. Same visitor as Octree::RayCast:
+			bool Accept(Type object) -> Cheap filter checked before queueing the leaf.
+			bool Hit(Type object, float& distance) -> Exact test.
+		Stops when the next entry is farther than the closest confirmed hit. Returns that distance (or max_distance).
+	*/
+	template<typename Visitor>
+	float RayCast(const math::Ray& ray, Visitor& visitor, float max_distance = FLOAT_INF)const;
+
+private:
+	AABBTree(const AABBTree&); //Prevent copies
+	AABBTree& operator= (const AABBTree&);
+
+	int AllocateNode();
+	void FreeNode(int index);
+
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	int Balance(int index);
+	void FixUpwards(int index);
+
+	static math::AABB Union(const math::AABB& a, const math::AABB& b);
+
+private:
+	std::vector<AABBTreeNode<Type>> nodes;
+	int root = AABB_TREE_NULL;
+	int free_list = AABB_TREE_NULL;
+
+	std::unordered_map<Type, int> leaves; //Object -> leaf node
+};
+
+template<typename Type>
+inline AABBTree<Type>::AABBTree()
+{}
+
+template<typename Type>
+inline AABBTree<Type>::~AABBTree()
+{}
+
+template<typename Type>
+inline bool AABBTree<Type>::Insert(Type object, const math::AABB& box)
+{
+	if (leaves.find(object) != leaves.end()) //Already inserted
+		return false;
+
+	int leaf = AllocateNode();
+	AABBTreeNode<Type>& node = nodes[leaf];
+	node.object = object;
+	node.box = box;
+	node.fat_box = box;
+	node.fat_box.minPoint -= math::float3(AABB_TREE_MARGIN);
+	node.fat_box.maxPoint += math::float3(AABB_TREE_MARGIN);
+	node.height = 0;
+
+	InsertLeaf(leaf);
+	leaves[object] = leaf;
+	return true;
+}
+
+template<typename Type>
+inline bool AABBTree<Type>::Remove(Type object)
+{
+	typename std::unordered_map<Type, int>::iterator leaf = leaves.find(object);
+	if (leaf == leaves.end())
+		return false;
+
+	RemoveLeaf(leaf->second);
+	FreeNode(leaf->second);
+	leaves.erase(leaf);
+	return true;
+}
+
+template<typename Type>
+inline bool AABBTree<Type>::Update(Type object, const math::AABB& box)
+{
+	typename std::unordered_map<Type, int>::iterator it = leaves.find(object);
+	if (it == leaves.end())
+		return false;
+
+	int leaf = it->second;
+	nodes[leaf].box = box;
+
+	if (nodes[leaf].fat_box.Contains(box)) //Still inside the margin
+		return false;
+
+	RemoveLeaf(leaf);
+	nodes[leaf].fat_box = box;
+	nodes[leaf].fat_box.minPoint -= math::float3(AABB_TREE_MARGIN);
+	nodes[leaf].fat_box.maxPoint += math::float3(AABB_TREE_MARGIN);
+	InsertLeaf(leaf);
+	return true;
+}
+
+template<typename Type>
+inline bool AABBTree<Type>::Contains(Type object) const
+{
+	return leaves.find(object) != leaves.end();
+}
+
+template<typename Type>
+inline void AABBTree<Type>::Clear()
+{
+	nodes.clear();
+	leaves.clear();
+	root = AABB_TREE_NULL;
+	free_list = AABB_TREE_NULL;
+}
+
+template<typename Type>
+inline void AABBTree<Type>::Draw() const
+{
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].height < 0)
+			continue;
+		g_Debug->AddAABB(nodes[i].fat_box, (nodes[i].IsLeaf()) ? g_Debug->green : g_Debug->orange, 1.0f);
+	}
+}
+
+template<typename Type>
+inline unsigned int AABBTree<Type>::Size() const
+{
+	return leaves.size();
+}
+
+template<typename Type>
+inline int AABBTree<Type>::GetHeight() const
+{
+	return (root == AABB_TREE_NULL) ? 0 : nodes[root].height;
+}
+
+template<typename Type>
+inline int AABBTree<Type>::AllocateNode()
+{
+	if (free_list == AABB_TREE_NULL)
+	{
+		nodes.push_back(AABBTreeNode<Type>());
+		return nodes.size() - 1;
+	}
+
+	int index = free_list;
+	free_list = nodes[index].parent;
+	nodes[index] = AABBTreeNode<Type>();
+	return index;
+}
+
+template<typename Type>
+inline void AABBTree<Type>::FreeNode(int index)
+{
+	nodes[index].parent = free_list;
+	nodes[index].child1 = AABB_TREE_NULL;
+	nodes[index].child2 = AABB_TREE_NULL;
+	nodes[index].height = -1;
+	free_list = index;
+}
+
+template<typename Type>
+inline void AABBTree<Type>::InsertLeaf(int leaf)
+{
+	if (root == AABB_TREE_NULL)
+	{
+		root = leaf;
+		nodes[root].parent = AABB_TREE_NULL;
+		return;
+	}
+
+	//Find the best sibling (surface area heuristic)
+	math::AABB leaf_box = nodes[leaf].fat_box;
+	int index = root;
+	while (nodes[index].IsLeaf() == false)
+	{
+		const AABBTreeNode<Type>& node = nodes[index];
+		int child1 = node.child1;
+		int child2 = node.child2;
+
+		float area = node.fat_box.SurfaceArea();
+		float combined_area = Union(node.fat_box, leaf_box).SurfaceArea();
+
+		//Cost of creating a new parent for this node and the new leaf
+		float cost = 2.0f * combined_area;
+		//Minimum cost of pushing the leaf further down the tree
+		float inheritance_cost = 2.0f * (combined_area - area);
+
+		float cost1 = Union(leaf_box, nodes[child1].fat_box).SurfaceArea() + inheritance_cost;
+		if (nodes[child1].IsLeaf() == false)
+			cost1 -= nodes[child1].fat_box.SurfaceArea();
+
+		float cost2 = Union(leaf_box, nodes[child2].fat_box).SurfaceArea() + inheritance_cost;
+		if (nodes[child2].IsLeaf() == false)
+			cost2 -= nodes[child2].fat_box.SurfaceArea();
+
+		if (cost < cost1 && cost < cost2)
+			break;
+
+		index = (cost1 < cost2) ? child1 : child2;
+	}
+
+	int sibling = index;
+
+	//Create a new parent
+	int new_parent = AllocateNode(); //Can move the nodes array. Don't keep references before this.
+	int old_parent = nodes[sibling].parent;
+	nodes[new_parent].parent = old_parent;
+	nodes[new_parent].fat_box = Union(leaf_box, nodes[sibling].fat_box);
+	nodes[new_parent].height = nodes[sibling].height + 1;
+	nodes[new_parent].child1 = sibling;
+	nodes[new_parent].child2 = leaf;
+	nodes[sibling].parent = new_parent;
+	nodes[leaf].parent = new_parent;
+
+	if (old_parent != AABB_TREE_NULL)
+	{
+		if (nodes[old_parent].child1 == sibling)
+			nodes[old_parent].child1 = new_parent;
+		else
+			nodes[old_parent].child2 = new_parent;
+	}
+	else
+		root = new_parent;
+
+	FixUpwards(nodes[leaf].parent);
+}
+
+template<typename Type>
+inline void AABBTree<Type>::RemoveLeaf(int leaf)
+{
+	if (leaf == root)
+	{
+		root = AABB_TREE_NULL;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grand_parent = nodes[parent].parent;
+	int sibling = (nodes[parent].child1 == leaf) ? nodes[parent].child2 : nodes[parent].child1;
+
+	if (grand_parent != AABB_TREE_NULL)
+	{
+		//Destroy the parent and connect the sibling to the grand parent
+		if (nodes[grand_parent].child1 == parent)
+			nodes[grand_parent].child1 = sibling;
+		else
+			nodes[grand_parent].child2 = sibling;
+		nodes[sibling].parent = grand_parent;
+		FreeNode(parent);
+
+		FixUpwards(grand_parent);
+	}
+	else
+	{
+		root = sibling;
+		nodes[sibling].parent = AABB_TREE_NULL;
+		FreeNode(parent);
+	}
+}
+
+template<typename Type>
+inline void AABBTree<Type>::FixUpwards(int index)
+{
+	while (index != AABB_TREE_NULL)
+	{
+		index = Balance(index);
+
+		AABBTreeNode<Type>& node = nodes[index];
+		const AABBTreeNode<Type>& child1 = nodes[node.child1];
+		const AABBTreeNode<Type>& child2 = nodes[node.child2];
+
+		node.height = 1 + math::Max(child1.height, child2.height);
+		node.fat_box = Union(child1.fat_box, child2.fat_box);
+
+		index = node.parent;
+	}
+}
+
+/*
+	Performs a left or right rotation if node A is imbalanced. Returns the new root of the subtree.
+		  A
+		/   \
+	   B     C
+	  / \   / \
+	 D   E F   G
+*/
+template<typename Type>
+inline int AABBTree<Type>::Balance(int i_a)
+{
+	AABBTreeNode<Type>* a = &nodes[i_a];
+	if (a->IsLeaf() || a->height < 2)
+		return i_a;
+
+	int i_b = a->child1;
+	int i_c = a->child2;
+	AABBTreeNode<Type>* b = &nodes[i_b];
+	AABBTreeNode<Type>* c = &nodes[i_c];
+
+	int balance = c->height - b->height;
+
+	//Rotate C up
+	if (balance > 1)
+	{
+		int i_f = c->child1;
+		int i_g = c->child2;
+		AABBTreeNode<Type>* f = &nodes[i_f];
+		AABBTreeNode<Type>* g = &nodes[i_g];
+
+		c->child1 = i_a;
+		c->parent = a->parent;
+		a->parent = i_c;
+
+		if (c->parent != AABB_TREE_NULL)
+		{
+			if (nodes[c->parent].child1 == i_a)
+				nodes[c->parent].child1 = i_c;
+			else
+				nodes[c->parent].child2 = i_c;
+		}
+		else
+			root = i_c;
+
+		if (f->height > g->height)
+		{
+			c->child2 = i_f;
+			a->child2 = i_g;
+			g->parent = i_a;
+			a->fat_box = Union(b->fat_box, g->fat_box);
+			c->fat_box = Union(a->fat_box, f->fat_box);
+			a->height = 1 + math::Max(b->height, g->height);
+			c->height = 1 + math::Max(a->height, f->height);
+		}
+		else
+		{
+			c->child2 = i_g;
+			a->child2 = i_f;
+			f->parent = i_a;
+			a->fat_box = Union(b->fat_box, f->fat_box);
+			c->fat_box = Union(a->fat_box, g->fat_box);
+			a->height = 1 + math::Max(b->height, f->height);
+			c->height = 1 + math::Max(a->height, g->height);
+		}
+
+		return i_c;
+	}
+
+	//Rotate B up
+	if (balance < -1)
+	{
+		int i_d = b->child1;
+		int i_e = b->child2;
+		AABBTreeNode<Type>* d = &nodes[i_d];
+		AABBTreeNode<Type>* e = &nodes[i_e];
+
+		b->child1 = i_a;
+		b->parent = a->parent;
+		a->parent = i_b;
+
+		if (b->parent != AABB_TREE_NULL)
+		{
+			if (nodes[b->parent].child1 == i_a)
+				nodes[b->parent].child1 = i_b;
+			else
+				nodes[b->parent].child2 = i_b;
+		}
+		else
+			root = i_b;
+
+		if (d->height > e->height)
+		{
+			b->child2 = i_d;
+			a->child1 = i_e;
+			e->parent = i_a;
+			a->fat_box = Union(c->fat_box, e->fat_box);
+			b->fat_box = Union(a->fat_box, d->fat_box);
+			a->height = 1 + math::Max(c->height, e->height);
+			b->height = 1 + math::Max(a->height, d->height);
+		}
+		else
+		{
+			b->child2 = i_e;
+			a->child1 = i_d;
+			d->parent = i_a;
+			a->fat_box = Union(c->fat_box, d->fat_box);
+			b->fat_box = Union(a->fat_box, e->fat_box);
+			a->height = 1 + math::Max(c->height, d->height);
+			b->height = 1 + math::Max(a->height, e->height);
+		}
+
+		return i_b;
+	}
+
+	return i_a;
+}
+
+template<typename Type>
+inline math::AABB AABBTree<Type>::Union(const math::AABB& a, const math::AABB& b)
+{
+	math::AABB ret = a;
+	ret.Enclose(b);
+	return ret;
+}
+
+template<typename Type>
+template<typename Primitive>
+inline bool AABBTree<Type>::Intersect(std::vector<Type>& results, Primitive& prim) const
+{
+	if (root == AABB_TREE_NULL)
+		return false;
+
+	bool ret = false;
+	std::vector<int> stack;
+	stack.push_back(root);
+
+	while (stack.empty() == false)
+	{
+		const AABBTreeNode<Type>& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!prim.Intersects(node.fat_box))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			if (prim.Intersects(node.box))
+			{
+				results.push_back(node.object);
+				ret = true;
+			}
+		}
+		else
+		{
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+
+	return ret;
+}
+
+template<typename Type>
+template<typename Visitor>
+inline float AABBTree<Type>::RayCast(const math::Ray& ray, Visitor& visitor, float max_distance) const
+{
+	if (root == AABB_TREE_NULL)
+		return max_distance;
+
+	//Entry distance -> node. Leaves are queued with the distance to their tight box.
+	typedef std::pair<float, int> RayEntry;
+	std::priority_queue<RayEntry, std::vector<RayEntry>, std::greater<RayEntry>> queue;
+
+	float d_near, d_far;
+	const AABBTreeNode<Type>& root_node = nodes[root];
+	if (root_node.IsLeaf())
+	{
+		if (ray.Intersects(root_node.box, d_near, d_far) == false || visitor.Accept(root_node.object) == false)
+			return max_distance;
+	}
+	else if (ray.Intersects(root_node.fat_box, d_near, d_far) == false)
+		return max_distance;
+	queue.push(RayEntry(d_near, root));
+
+	while (queue.empty() == false)
+	{
+		RayEntry entry = queue.top();
+		queue.pop();
+
+		if (entry.first > max_distance) //Nothing left can be closer than the current hit
+			break;
+
+		const AABBTreeNode<Type>& node = nodes[entry.second];
+		if (node.IsLeaf())
+		{
+			float distance;
+			if (visitor.Hit(node.object, distance) && distance < max_distance)
+				max_distance = distance;
+			continue;
+		}
+
+		int childs[2] = { node.child1, node.child2 };
+		for (int i = 0; i < 2; i++)
+		{
+			const AABBTreeNode<Type>& child = nodes[childs[i]];
+			if (child.IsLeaf())
+			{
+				if (ray.Intersects(child.box, d_near, d_far) && d_near <= max_distance && visitor.Accept(child.object))
+					queue.push(RayEntry(d_near, childs[i]));
+			}
+			else if (ray.Intersects(child.fat_box, d_near, d_far) && d_near <= max_distance)
+				queue.push(RayEntry(d_near, childs[i]));
+		}
+	}
+
+	return max_distance;
+}
+
+#endif // !__AABB_TREE_H__
@@ -18,6 +18,7 @@
 #include "Time.h"
 #include "Random.h"
 #include "EventQueue.h"
+#include "JobSystem.h"
 #include "Data.h"
 
 #include "Brofiler/include/Brofiler.h"
@@ -37,6 +38,9 @@ Application::Application()
 	// EventQueue
 	event_queue = new EventQueue();
 
+	// Worker threads. Started on Init.
+	job_system = new JobSystem();
+
 	// Modules
 	window = new ModuleWindow("window");
 	resource_manager = new ModuleResourceManager("resource_manager");
@@ -85,6 +89,7 @@ Application::~Application()
 {
 	delete rnd;
 	delete event_queue;
+	delete job_system;
 
 	vector<Module*>::reverse_iterator i = list_modules.rbegin();
 
@@ -133,6 +138,9 @@ bool Application::Init()
 		game_state = GAME_RUNNING;
 	}		
 
+	// Workers are ready before any module can schedule jobs
+	job_system->Init();
+
 	// Call Init() in all modules
 	vector<Module*>::iterator i = list_modules.begin();
 
@@ -285,6 +293,8 @@ bool Application::CleanUp()
 		++i;
 	}
 
+	job_system->CleanUp();
+
 	return ret;
 }
 
@@ -23,6 +23,7 @@ class ModuleScripting;
 
 class Random;
 class EventQueue;
+class JobSystem;
 
 using namespace std; 
 enum PLAYER;
@@ -90,6 +91,7 @@ public:
 
 	Random* rnd = nullptr;
 	EventQueue *event_queue = nullptr;
+	JobSystem* job_system = nullptr;
 
 private:
 
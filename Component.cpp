@@ -4,14 +4,27 @@
 #include "Globals.h"
 #include "Data.h"
 #include "Random.h"
+#include "ModuleGOManager.h"
+
+//Components have many sizes, so the map only stores the pointer. Function-local so it outlives every component.
+static SlotMap<Component*, Component>& GetHandles()
+{
+	static SlotMap<Component*, Component> handles;
+	return handles;
+}
 
 Component::Component(ComponentType type, GameObject* game_object) : type (type), game_object(game_object)
 {
 	uuid = uuid = App->rnd->RandomInt();
+	handle = GetHandles().Insert(this);
 }
 
 Component::~Component()
-{}
+{
+	GetHandles().Erase(handle);
+	if (ticking || registry_index >= 0)
+		App->go_manager->UnregisterComponent(this);
+}
 
 ComponentType Component::GetType() const
 {
@@ -28,6 +41,17 @@ unsigned int Component::GetUUID() const
 	return uuid;
 }
 
+ComponentHandle Component::GetHandle() const
+{
+	return handle;
+}
+
+Component* Component::Get(const ComponentHandle& handle)
+{
+	Component** component = GetHandles().Get(handle);
+	return (component) ? *component : nullptr;
+}
+
 bool Component::IsActive()
 {
 	return active;
@@ -36,6 +60,20 @@ bool Component::IsActive()
 void Component::SetActive(bool value)
 {
 	active = value;
+	RefreshTick();
+}
+
+void Component::RefreshTick()
+{
+	bool value = active && removed == false && game_object != nullptr && game_object->IsActive();
+	if (value != ticking)
+		App->go_manager->OnComponentActivityChanged(this, value);
+}
+
+void Component::LeaveTickLists()
+{
+	removed = true;
+	RefreshTick();
 }
 
 void Component::Remove()
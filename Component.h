@@ -1,33 +1,23 @@
 #ifndef __COMPONENT_H__
 #define __COMPONENT_H__
 
-enum ComponentType
+#include "ComponentType.h"
+
+enum ComponentPhase
 {
-	C_TRANSFORM = 0,
-	C_MESH = 1,
-	C_MATERIAL = 2,
-	C_CAMERA = 3,
-	C_LIGHT = 4,
-	C_ANIMATION = 5,
-	C_BONE = 6,
-	//C_Audio was here
-	C_COLLIDER = 8,
-	C_CAR = 9,
-	C_SCRIPT = 10,
-	C_RECT_TRANSFORM = 11,
-	C_CANVAS = 12,
-	C_UI_IMAGE = 13,
-	C_UI_TEXT = 14,
-	C_UI_BUTTON = 15,
-	C_GRID = 16,
-	C_AUDIO_LISTENER = 17,
-	C_AUDIO_SOURCE = 18,
-	C_SPRITE = 19,
-	C_PARTICLE_SYSTEM = 20
+	PHASE_PRE_UPDATE = 0,
+	PHASE_UPDATE,
+	PHASE_POST_UPDATE,
+	NUM_COMPONENT_PHASES
 };
 
+#include "SlotMap.h"
+
 class GameObject;
 class Data;
+class Component;
+
+typedef SlotHandle<Component> ComponentHandle;
 
 class Component
 {
@@ -43,11 +33,17 @@ public:
 
 	bool IsActive();
 	void SetActive(bool value);
+	//Adds or removes the component from the scheduler tick lists and the active registry. Called when its active flag or its GameObject activity changes.
+	void RefreshTick();
+	void LeaveTickLists(); //Queued for deletion: stops ticking for the rest of the frame and never ticks again
 	virtual void OnInspector(bool debug) {}
 
 	ComponentType GetType()const;
 	GameObject* GetGameObject()const;
 	unsigned int GetUUID()const;
+	//Safe reference: resolves to nullptr once the component is deleted
+	ComponentHandle GetHandle()const;
+	static Component* Get(const ComponentHandle& handle);
 
 	virtual void OnTransformModified() {}
 	virtual void Save(Data& file) const {}
@@ -64,5 +60,15 @@ protected:
 	GameObject* game_object = nullptr;
 	unsigned int uuid = 0;
 
+private:
+	ComponentHandle handle;
+
+	friend class ComponentScheduler;
+	friend class ComponentRegistry;
+	bool ticking = false;
+	bool removed = false;
+	int registry_index = -1; //Position in the ComponentRegistry lists
+	int active_registry_index = -1;
+	int tick_slots[NUM_COMPONENT_PHASES] = { -1, -1, -1 }; //Position in each tick list
 };
 #endif // !__COMPONENT_H__
\ No newline at end of file
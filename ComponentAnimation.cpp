@@ -207,7 +207,7 @@ void ComponentAnimation::Save(Data& file)const
 void ComponentAnimation::Load(Data& conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 
 	const char* path = conf.GetString("path");
 
@@ -390,6 +390,13 @@ bool ComponentAnimation::StartAnimation()
 	return started;
 }
 
+void ComponentAnimation::PreUpdate()
+{
+	//The first start can warn the editor, so it's done here on the main thread. Update runs on the workers.
+	if (App->IsGameRunning() && playing == true && started == false)
+		StartAnimation();
+}
+
 void ComponentAnimation::Update()
 {
 	BROFILER_CATEGORY("ComponentAnimation::Update", Profiler::Color::Red)
@@ -398,9 +405,8 @@ void ComponentAnimation::Update()
 	{
 		if (playing == true)
 		{
-			if (started == false)
-				if (StartAnimation() == false)
-					return;
+			if (started == false) //Started in the next PreUpdate
+				return;
 			
 			float blend_ratio = 0.0f;
 
@@ -72,6 +72,7 @@ public:
 	void SetResource(ResourceFileAnimation* resource);
 
 	bool StartAnimation();
+	void PreUpdate();
 	void Update();
 
 private:
@@ -78,7 +78,7 @@ void ComponentAudioListener::Save(Data & file)const
 void ComponentAudioListener::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 
 	// Setting listener configuration for saved listener_id
 	App->audio->RemoveListener(listener_id);
@@ -172,7 +172,7 @@ void ComponentAudioSource::Save(Data & file)const
 void ComponentAudioSource::Load(Data &conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 
 	// It's mandatory to load Init Soundbank first
 	if (!App->audio->IsInitSoundbankLoaded())
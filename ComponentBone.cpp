@@ -48,7 +48,7 @@ void ComponentBone::Save(Data& file)const
 void ComponentBone::Load(Data& conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 
 	const char* path = conf.GetString("path");
 
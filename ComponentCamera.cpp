@@ -154,6 +154,15 @@ void ComponentCamera::OnInspector(bool debug)
 		//LayerMask
 		App->go_manager->layer_system->DisplayLayerMask(layer_mask);
 
+		const CameraRenderStats* stats = App->renderer3D->GetRenderStats(this);
+		if (stats)
+		{
+			ImGui::Text("Culling: %u visible, %u occluded (%u occluder triangles)", stats->visible, stats->occluded, stats->occluder_triangles);
+			ImGui::Text("Draws: %u (%u instanced objects), program changes: %u, material changes: %u", stats->queue.draws, stats->queue.instances, stats->queue.program_changes, stats->queue.material_changes);
+			ImGui::Text("Buffer binds: %u, texture binds: %u, indirect commands: %u", stats->queue.buffer_binds, stats->queue.texture_binds, stats->queue.indirect_commands);
+			ImGui::Text("UI text draws: %u", stats->ui_text_draws);
+		}
+
 		//RenderTexture
 		string ren_name = "RenderTexture: " + ((render_texture) ? render_texture_path : "none");
 		if (ImGui::BeginMenu(ren_name.data()))
@@ -326,30 +335,21 @@ void ComponentCamera::SetBackgroundColor(const math::float3 color)
 
 bool ComponentCamera::Intersects(const math::AABB & box)const
 {
-	bool ret = true;
-	math::vec corners[8];
-	box.GetCornerPoints(corners);
+	//Center-extents test: the box is outside if its projected radius can't reach the plane
+	math::float3 center = box.CenterPoint();
+	math::float3 extents = box.HalfSize();
 
 	math::Plane planes[6];
 	frustum.GetPlanes(planes);
 
 	for (int p = 0; p < 6; p++)
 	{
-		int count = 0;
-		for (int i = 0; i < 8; i++)
-		{
-			if (planes[p].IsOnPositiveSide(corners[i]))
-				count++;
-		}
-
-		if (count == 8)
-		{
-			ret = false;
-			break;
-		}
+		float radius = planes[p].normal.Abs().Dot(extents);
+		if (planes[p].SignedDistance(center) > radius)
+			return false;
 	}
 
-	return ret;
+	return true;
 }
 
 math::float4x4 ComponentCamera::GetViewMatrix() const
@@ -402,7 +402,7 @@ void ComponentCamera::Save(Data & file)const
 void ComponentCamera::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 
 	near_plane = conf.GetFloat("near_plane");
 	far_plane = conf.GetFloat("far_plane");
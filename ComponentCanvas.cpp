@@ -103,7 +103,7 @@ void ComponentCanvas::Save(Data & file) const
 void ComponentCanvas::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 }
 
 void ComponentCanvas::Remove()
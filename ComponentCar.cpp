@@ -1857,7 +1857,7 @@ void ComponentCar::Save(Data& file) const
 void ComponentCar::Load(Data& conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 
 	//Game loop settings
 	lose_height = conf.GetFloat("lose_height");
@@ -2022,25 +2022,25 @@ void ComponentCar::Load(Data& conf)
 	// Posting events to further loading of GameObject wheels when all have been loaded)
 	if (conf.GetUInt("Wheel Front Left") != 0)
 	{
-		EventLinkGos *ev = new EventLinkGos((GameObject**)&wheels_go[0], conf.GetUInt("Wheel Front Left"));
+		EventLinkGos *ev = new EventLinkGos((GameObject**)&wheels_go[0], conf.GetUInt("Wheel Front Left"), GetHandle());
 		App->event_queue->PostEvent(ev);
 	}
 
 	if (conf.GetUInt("Wheel Front Right") != 0)
 	{
-		EventLinkGos *ev = new EventLinkGos((GameObject**)&wheels_go[1], conf.GetUInt("Wheel Front Right"));
+		EventLinkGos *ev = new EventLinkGos((GameObject**)&wheels_go[1], conf.GetUInt("Wheel Front Right"), GetHandle());
 		App->event_queue->PostEvent(ev);
 	}
 
 	if (conf.GetUInt("Wheel Back Left") != 0)
 	{
-		EventLinkGos *ev = new EventLinkGos((GameObject**)&wheels_go[2], conf.GetUInt("Wheel Back Left"));
+		EventLinkGos *ev = new EventLinkGos((GameObject**)&wheels_go[2], conf.GetUInt("Wheel Back Left"), GetHandle());
 		App->event_queue->PostEvent(ev);
 	}
 
 	if (conf.GetUInt("Wheel Back Right") != 0)
 	{
-		EventLinkGos *ev = new EventLinkGos((GameObject**)&wheels_go[3], conf.GetUInt("Wheel Back Right"));
+		EventLinkGos *ev = new EventLinkGos((GameObject**)&wheels_go[3], conf.GetUInt("Wheel Back Right"), GetHandle());
 		App->event_queue->PostEvent(ev);
 	}
 
@@ -265,7 +265,7 @@ void ComponentCollider::Save(Data & file)const
 void ComponentCollider::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 
 	shape = (Collider_Shapes) conf.GetInt("shape");
 	Static = conf.GetBool("static");
@@ -303,7 +303,7 @@ void ComponentGrid::Save(Data & file) const
 void ComponentGrid::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 	players_controlling = conf.GetInt("players_controlling");
 	num_elements = conf.GetInt("num_elements");
 	grid_enabled = conf.GetBool("grid_enabled");
@@ -86,7 +86,7 @@ void ComponentLight::Save(Data & file) const
 void ComponentLight::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 	light_type = (LightType)conf.GetInt("light_type");
 }
 
@@ -13,6 +13,7 @@
 #include "ResourceFileRenderTexture.h"
 
 #include "Assets.h"
+#include "ShaderReflection.h"
 #include "Glew\include\glew.h"
 
 ComponentMaterial::ComponentMaterial(ComponentType type, GameObject* game_object) : Component(type, game_object)
@@ -96,6 +97,7 @@ void ComponentMaterial::OnInspector(bool debug)
 									tex_resources.push_back(rc_rndtx);
 									texture_ids.insert(pair<string, uint>((*uni)->name.data(), rc_rndtx->GetTexture()));
 								}
+								texture_locations_dirty = true;
 							}
 						}
 					}
@@ -191,7 +193,8 @@ void ComponentMaterial::Save(Data & file)const
 void ComponentMaterial::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
+	texture_locations_dirty = true;
 	material_path = conf.GetString("path");
 	const char* m_a_p = conf.GetString("path_assets");
 	material_assets_path = (m_a_p) ? m_a_p : "";
@@ -602,6 +605,7 @@ void ComponentMaterial::ChangeTexture(string tex_name, Uniform* &value)
 void ComponentMaterial::RefreshTextures()
 {
 	texture_ids.clear();
+	texture_locations_dirty = true;
 	list_textures_paths.clear();
 	for (vector<Uniform*>::iterator uni = rc_material->material.uniforms.begin(); uni != rc_material->material.uniforms.end(); ++uni)
 	{
@@ -655,6 +659,7 @@ bool ComponentMaterial::AddTexture()
 				{
 					tex_resources.push_back(rc_tmp);
 					texture_ids.insert(pair<string, uint>(to_string(texture_ids.size()), rc_tmp->GetTexture()));
+					texture_locations_dirty = true;
 					list_textures_paths.push_back(path);
 					ret = true;
 				}
@@ -711,6 +716,7 @@ void ComponentMaterial::RemoveTexture(std::string name)
 		else
 		{
 			texture_ids.erase(it);
+			texture_locations_dirty = true;
 		}
 	}
 }
@@ -737,6 +743,50 @@ void ComponentMaterial::CleanUp()
 	}
 
 	texture_ids.clear();
+	texture_locations_dirty = true;
 	list_textures_paths.clear();
 
 }
+
+static inline void HashCombine(size_t& seed, size_t value)
+{
+	seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+size_t ComponentMaterial::RenderStateHash() const
+{
+	std::hash<float> hash_float;
+	size_t seed = std::hash<const void*>()(rc_material);
+	HashCombine(seed, alpha);
+	HashCombine(seed, blend_type);
+	HashCombine(seed, hash_float(alpha_test));
+	HashCombine(seed, hash_float(specular));
+	for (int i = 0; i < 4; i++)
+		HashCombine(seed, hash_float(color[i]));
+	for (map<string, uint>::const_iterator tex = texture_ids.begin(); tex != texture_ids.end(); ++tex)
+	{
+		HashCombine(seed, std::hash<string>()(tex->first));
+		HashCombine(seed, tex->second);
+	}
+	return seed;
+}
+
+bool ComponentMaterial::SameRenderState(const ComponentMaterial & other) const
+{
+	return rc_material == other.rc_material && alpha == other.alpha && blend_type == other.blend_type && alpha_test == other.alpha_test &&
+		specular == other.specular && color[0] == other.color[0] && color[1] == other.color[1] && color[2] == other.color[2] &&
+		color[3] == other.color[3] && texture_ids == other.texture_ids;
+}
+
+const std::vector<int>& ComponentMaterial::GetTextureLocations(const ShaderReflection* shader)
+{
+	if (texture_locations_dirty || shader->GetGeneration() != texture_locations_generation)
+	{
+		texture_locations.clear();
+		for (map<string, uint>::const_iterator tex = texture_ids.begin(); tex != texture_ids.end(); ++tex)
+			texture_locations.push_back(shader->FindLocation(tex->first));
+		texture_locations_generation = shader->GetGeneration();
+		texture_locations_dirty = false;
+	}
+	return texture_locations;
+}
@@ -9,6 +9,7 @@
 class ResourceFileTexture;
 class ResourceFileMaterial;
 class ResourceFile;
+class ShaderReflection;
 
 class ComponentMaterial : public Component
 {
@@ -25,6 +26,14 @@ public:
 	void SetIdToRender(int new_id);
 
 	bool DefaultMaterialInspector();
+
+	//Sampler location of each entry of texture_ids, in map order. Resolved by name only when the program is relinked or the textures change.
+	const std::vector<int>& GetTextureLocations(const ShaderReflection* shader);
+
+	//What the renderer sets when it binds the material: resource, textures, color, alpha mode and specular.
+	//Materials with the same render state can be drawn by the same call.
+	size_t RenderStateHash()const;
+	bool SameRenderState(const ComponentMaterial& other)const;
 private:
 	void PrintMaterialProperties();
 	void ChooseAlphaType();
@@ -59,5 +68,9 @@ private:
 	int id_to_render = 0;
 	std::string material_assets_path;
 
+	std::vector<int> texture_locations;
+	unsigned int texture_locations_generation = 0; //Of the ShaderReflection they were resolved from
+	bool texture_locations_dirty = true; //Set whenever an entry is added to or removed from texture_ids
+
 };
 #endif // !__COMPONENT_MATERIAL_H__
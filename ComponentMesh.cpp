@@ -15,6 +15,7 @@
 
 #include "ModuleRenderer3D.h"
 #include "ModuleResourceManager.h"
+#include "ModuleGOManager.h"
 
 #include "Brofiler/include/Brofiler.h"
 
@@ -44,11 +45,7 @@ void ComponentMesh::Update()
 	if (!IsActive())
 		return;
 	if (mesh)
-	{
-		game_object->mesh_to_draw = mesh;
-
-		App->renderer3D->AddToDraw(GetGameObject());
-	}
+		game_object->SetMeshToDraw(mesh);
 	if (App->renderer3D->renderAABBs)
 	{
 		App->renderer3D->DrawAABB(bounding_box.minPoint, bounding_box.maxPoint, float4(1, 1, 0, 1));
@@ -81,6 +78,12 @@ void ComponentMesh::OnInspector(bool debug)
 			SetActive(is_active);
 		}
 
+		ImGui::Checkbox("Occluder###occluderMesh", &occluder);
+		if (occluder && game_object->IsStatic() == false)
+		{
+			ImGui::SameLine(); ImGui::TextColored(ImVec4(1, 1, 0, 1), "(only static GameObjects occlude)");
+		}
+
 		if (mesh)
 		{
 			ImGui::Text("Number of vertices %d", mesh->num_vertices);
@@ -101,9 +104,14 @@ void ComponentMesh::OnInspector(bool debug)
 			else
 				ImGui::Text("Has Colors: no");
 
-			ImGui::Text("Vertices id: %i", mesh->id_vertices);
-			ImGui::Text("Indices id: %i", mesh->id_indices);
-			ImGui::Text("UVs id: %i", mesh->id_uvs);
+			if (mesh->in_arena)
+				ImGui::Text("Geometry arena: base vertex %u, first index %u", mesh->base_vertex, mesh->first_index);
+			else
+			{
+				ImGui::Text("Vertices id: %i", mesh->id_vertices);
+				ImGui::Text("Indices id: %i (%i bits)", mesh->id_indices, mesh->index_size * 8);
+			}
+			ImGui::Text("Vertex array id: %i", mesh->id_vao);
 		}
 		else
 		{
@@ -127,7 +135,7 @@ bool ComponentMesh::SetMesh(Mesh *mesh)
 
 		aabb.Enclose((float3*)mesh->vertices, mesh->num_vertices);
 		RecalculateBoundingBox();
-		game_object->mesh_to_draw = this->mesh;
+		game_object->SetMeshToDraw(this->mesh);
 		ret = true;
 	}
 		
@@ -145,6 +153,7 @@ void ComponentMesh::RecalculateBoundingBox()
 	math::OBB ob = aabb.Transform(game_object->GetGlobalMatrix());
 	bounding_box = ob.MinimalEnclosingAABB();
 	game_object->bounding_box = &bounding_box;
+	App->go_manager->OnBoundingBoxModified(game_object);
 }
 
 void ComponentMesh::Save(Data & file)const
@@ -153,6 +162,7 @@ void ComponentMesh::Save(Data & file)const
 	data.AppendInt("type", type);
 	data.AppendUInt("UUID", uuid);
 	data.AppendBool("active", active);
+	data.AppendBool("occluder", occluder);
 	if (mesh)
 		data.AppendString("path", mesh->file_path.data());
 	else
@@ -164,7 +174,8 @@ void ComponentMesh::Save(Data & file)const
 void ComponentMesh::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
+	occluder = conf.GetBool("occluder");
 
 	const char* path = conf.GetString("path");
 
@@ -271,6 +282,14 @@ void ComponentMesh::InitAnimBuffers()
 			}
 		}
 
+		//Bone ids and weights start at vertex 0, but arena meshes are drawn from base_vertex. Skinned meshes get their own buffers.
+		mesh->keep_out_of_arena = true;
+		if (mesh->in_arena)
+		{
+			MeshImporter::DeleteBuffers(mesh);
+			MeshImporter::LoadBuffers(mesh);
+		}
+
 		MeshImporter::LoadAnimBuffers(weights, size, weight_id, bones_ids, size, bone_id);
 
 		delete[] weights;
@@ -24,19 +24,35 @@ struct Bone_Reference
 	float4x4 offset = float4x4::identity;
 };
 
+//Vertex of the buffers made by MeshImporter::LoadBuffers: position(3), uv(2), normal(3), tangent(3)
+#define MESH_VERTEX_STRIDE (11 * sizeof(float))
+#define MESH_UV_OFFSET (3 * sizeof(float))
+#define MESH_NORMAL_OFFSET (5 * sizeof(float))
+#define MESH_TANGENT_OFFSET (8 * sizeof(float))
+
 struct Mesh
 {
-	//Vertices
+	//Vertices. Interleaved (MESH_VERTEX_STRIDE) when the mesh has a vertex array.
 	unsigned int id_vertices = 0;
 	unsigned int num_vertices = 0;
 	float* vertices = nullptr;
 
+	//Vertex array with the attributes 0 to 3 and the index buffer
+	unsigned int id_vao = 0;
+
 	//Indices
 	unsigned int id_indices = 0;
 	unsigned int num_indices = 0;
 	unsigned int* indices = nullptr;
+	unsigned int index_size = sizeof(unsigned int); //Bytes per index in id_indices. 2 with less than 65536 vertices.
+
+	//Place in the GeometryArena. id_vao is the vertex array of the arena and the mesh has no buffers of its own.
+	bool in_arena = false;
+	unsigned int base_vertex = 0; //Added to every index
+	unsigned int first_index = 0;
+	bool keep_out_of_arena = false; //Skinned meshes and meshes drawn outside the render queue need buffers of their own
 
-	//UVs
+	//UVs. id_uvs, id_normals and id_tangents are only used by meshes without vertex array.
 	unsigned int id_uvs = 0;
 	unsigned int num_uvs = 0;
 	float* uvs = nullptr;
@@ -105,6 +121,7 @@ private:
 public:
 
 	bool animated = false;
+	bool occluder = false; //Its triangles hide what is behind in the occlusion culling. Only for static, low-poly meshes.
 	unsigned int weight_id = 0;
 	unsigned int bone_id = 0;
 	std::vector<math::float4x4> bones_trans;
@@ -192,7 +192,7 @@ void ComponentParticleSystem::Save(Data & file) const
 void ComponentParticleSystem::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 
 	life_time = conf.GetFloat("life_time");
 	max_particles = conf.GetInt("max_particles");
@@ -383,6 +383,25 @@ unsigned int ComponentParticleSystem::GetTextureId() const
 	return (texture) ? texture->GetTexture() : 0;
 }
 
+math::AABB ComponentParticleSystem::GetBoundingBox() const
+{
+	math::AABB box;
+	box.SetNegativeInfinity();
+	for (int i = 0; i < max_particles; ++i)
+	{
+		if (particles_container[i].life > 0.0f)
+			box.Enclose(particles_container[i].position);
+	}
+
+	//The billboards stick out of the particle positions
+	if (box.IsFinite())
+	{
+		box.minPoint -= math::float3(size);
+		box.maxPoint += math::float3(size);
+	}
+	return box;
+}
+
 void ComponentParticleSystem::SortParticles(ComponentCamera * cam)
 {
 	BROFILER_CATEGORY("ComponentParticleSystem::SortParticles", Profiler::Color::Navy);
@@ -56,6 +56,7 @@ public:
 	void OnStop();
 
 	unsigned int GetTextureId()const;
+	math::AABB GetBoundingBox()const; //Of the alive particles. Not finite when there are none.
 
 	void SortParticles(ComponentCamera* cam);
 
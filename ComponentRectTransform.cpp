@@ -24,7 +24,7 @@ ComponentRectTransform::ComponentRectTransform(ComponentType type, GameObject* g
 	GeneratePlane();
 
 	if (game_object)
-		game_object->layer = 1; //TODO: User could change layer 1?
+		game_object->SetLayer(1); //TODO: User could change layer 1?
 }
 
 void ComponentRectTransform::GeneratePlane()
@@ -39,6 +39,7 @@ void ComponentRectTransform::GeneratePlane()
 	plane->mesh->indices = new uint[plane->mesh->num_indices];
 	plane->mesh->num_uvs = 4;
 	plane->mesh->uvs = new float[plane->mesh->num_uvs * 2];
+	plane->mesh->keep_out_of_arena = true; //The UI draws it from id_vertices
 	ResizePlane();
 }
 
@@ -283,7 +284,7 @@ void ComponentRectTransform::Save(Data & file) const
 void ComponentRectTransform::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 
 	transform_matrix = conf.GetMatrix("matrix");
 	rect_size = conf.GetFloat2("rect_size");
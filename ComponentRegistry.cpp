@@ -0,0 +1,61 @@
+#include "ComponentRegistry.h"
+
+ComponentRegistry::ComponentRegistry()
+{}
+
+ComponentRegistry::~ComponentRegistry()
+{}
+
+void ComponentRegistry::Add(Component * component)
+{
+	if (component->registry_index >= 0)
+		return;
+
+	std::vector<Component*>& list = all[component->GetType()];
+	component->registry_index = list.size();
+	list.push_back(component);
+}
+
+void ComponentRegistry::Remove(Component * component)
+{
+	SetActive(component, false);
+
+	int index = component->registry_index;
+	if (index < 0)
+		return;
+
+	std::vector<Component*>& list = all[component->GetType()];
+	list[index] = list.back();
+	list[index]->registry_index = index;
+	list.pop_back();
+	component->registry_index = -1;
+}
+
+void ComponentRegistry::SetActive(Component * component, bool value)
+{
+	std::vector<Component*>& list = active[component->GetType()];
+	int index = component->active_registry_index;
+
+	if (value && index < 0)
+	{
+		component->active_registry_index = list.size();
+		list.push_back(component);
+	}
+	else if (value == false && index >= 0)
+	{
+		list[index] = list.back();
+		list[index]->active_registry_index = index;
+		list.pop_back();
+		component->active_registry_index = -1;
+	}
+}
+
+const std::vector<Component*>& ComponentRegistry::GetAll(ComponentType type) const
+{
+	return all[type];
+}
+
+const std::vector<Component*>& ComponentRegistry::GetActive(ComponentType type) const
+{
+	return active[type];
+}
@@ -0,0 +1,31 @@
+#ifndef __COMPONENT_REGISTRY_H__
+#define __COMPONENT_REGISTRY_H__
+
+#include "Component.h"
+
+#include <vector>
+
+/*
+	Dense list of the live components of each ComponentType, plus a second one with only the active ones
+	(active component on an active GameObject). Whole-scene queries cost O(components of that type).
+	Removal swaps with the last element, so the order is the order of registration until something is removed.
+*/
+class ComponentRegistry
+{
+public:
+	ComponentRegistry();
+	~ComponentRegistry();
+
+	void Add(Component* component);
+	void Remove(Component* component);
+	void SetActive(Component* component, bool value);
+
+	const std::vector<Component*>& GetAll(ComponentType type)const;
+	const std::vector<Component*>& GetActive(ComponentType type)const;
+
+private:
+	std::vector<Component*> all[NUM_COMPONENT_TYPES];
+	std::vector<Component*> active[NUM_COMPONENT_TYPES];
+};
+
+#endif // !__COMPONENT_REGISTRY_H__
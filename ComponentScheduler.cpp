@@ -0,0 +1,215 @@
+#include "ComponentScheduler.h"
+
+#include "Application.h"
+#include "JobSystem.h"
+
+#include "Brofiler/include/Brofiler.h"
+
+ComponentTypeTraits::ComponentTypeTraits(const char* name, unsigned char phases, unsigned int reads, unsigned int writes, unsigned char worker_phases, bool split_instances) :
+	name(name), phases(phases), reads(reads), writes(writes), worker_phases(worker_phases), split_instances(split_instances)
+{}
+
+bool ComponentTypeTraits::Conflicts(const ComponentTypeTraits & other) const
+{
+	return (writes & (other.reads | other.writes)) != 0 || (other.writes & reads) != 0;
+}
+
+const ComponentTypeTraits& GetComponentTypeTraits(ComponentType type)
+{
+	//The phases must match the methods each type overrides.
+	//Only types whose phase touches nothing but the declared data may run on a worker. Anything that logs warnings to the editor,
+	//talks to physics, scripts, input or the renderer stays on the main thread.
+	static ComponentTypeTraits traits[NUM_COMPONENT_TYPES];
+	static bool initialized = false;
+	if (initialized == false)
+	{
+		traits[C_TRANSFORM] = ComponentTypeTraits("Transform", 0, DATA_TRANSFORM, DATA_TRANSFORM);
+		traits[C_MESH] = ComponentTypeTraits("Mesh", PHASE_BIT(PHASE_UPDATE), DATA_TRANSFORM, DATA_RENDER);
+		traits[C_MATERIAL] = ComponentTypeTraits("Material", 0, DATA_OWN, DATA_RENDER);
+		traits[C_CAMERA] = ComponentTypeTraits("Camera", PHASE_BIT(PHASE_PRE_UPDATE) | PHASE_BIT(PHASE_UPDATE), DATA_OWN, DATA_RENDER, PHASE_BIT(PHASE_PRE_UPDATE), true); //PreUpdate only moves its own frustum
+		traits[C_LIGHT] = ComponentTypeTraits("Light", PHASE_BIT(PHASE_UPDATE), DATA_TRANSFORM, DATA_RENDER);
+		traits[C_ANIMATION] = ComponentTypeTraits("Animation", PHASE_BIT(PHASE_PRE_UPDATE) | PHASE_BIT(PHASE_UPDATE), DATA_TRANSFORM, DATA_TRANSFORM | DATA_SKIN, PHASE_BIT(PHASE_UPDATE), true); //PreUpdate starts it, Update only writes its own bones
+		traits[C_BONE] = ComponentTypeTraits("Bone", PHASE_BIT(PHASE_UPDATE), DATA_TRANSFORM, DATA_RENDER);
+		traits[C_COLLIDER] = ComponentTypeTraits("Collider", PHASE_BIT(PHASE_UPDATE), DATA_TRANSFORM, DATA_PHYSICS);
+		traits[C_CAR] = ComponentTypeTraits("Car", PHASE_BIT(PHASE_UPDATE), DATA_TRANSFORM | DATA_INPUT, DATA_TRANSFORM | DATA_PHYSICS | DATA_SCENE | DATA_AUDIO);
+		traits[C_SCRIPT] = ComponentTypeTraits("Script", PHASE_BIT(PHASE_UPDATE), ~0u, ~0u);
+		traits[C_RECT_TRANSFORM] = ComponentTypeTraits("RectTransform", PHASE_BIT(PHASE_UPDATE), DATA_TRANSFORM, DATA_TRANSFORM | DATA_UI);
+		traits[C_CANVAS] = ComponentTypeTraits("Canvas", PHASE_BIT(PHASE_UPDATE), DATA_INPUT | DATA_UI, DATA_UI | DATA_RENDER);
+		traits[C_UI_IMAGE] = ComponentTypeTraits("UiImage", PHASE_BIT(PHASE_UPDATE), DATA_UI, DATA_RENDER);
+		traits[C_UI_TEXT] = ComponentTypeTraits("UiText", PHASE_BIT(PHASE_UPDATE), DATA_UI, DATA_RENDER);
+		traits[C_UI_BUTTON] = ComponentTypeTraits("UiButton", PHASE_BIT(PHASE_UPDATE), DATA_UI | DATA_INPUT, DATA_UI);
+		traits[C_GRID] = ComponentTypeTraits("Grid", PHASE_BIT(PHASE_UPDATE), DATA_SCENE, DATA_TRANSFORM | DATA_UI);
+		traits[C_AUDIO_LISTENER] = ComponentTypeTraits("AudioListener", PHASE_BIT(PHASE_UPDATE), DATA_TRANSFORM, DATA_AUDIO, PHASE_BIT(PHASE_UPDATE));
+		traits[C_AUDIO_SOURCE] = ComponentTypeTraits("AudioSource", PHASE_BIT(PHASE_UPDATE), DATA_TRANSFORM, DATA_AUDIO, PHASE_BIT(PHASE_UPDATE));
+		traits[C_SPRITE] = ComponentTypeTraits("Sprite", PHASE_BIT(PHASE_UPDATE), DATA_OWN, DATA_RENDER);
+		traits[C_PARTICLE_SYSTEM] = ComponentTypeTraits("ParticleSystem", PHASE_BIT(PHASE_UPDATE) | PHASE_BIT(PHASE_POST_UPDATE), DATA_TRANSFORM, DATA_RENDER, PHASE_BIT(PHASE_UPDATE), true); //Update only spawns into its own pool
+		initialized = true;
+	}
+
+	return traits[type];
+}
+
+ComponentScheduler::ComponentScheduler()
+{
+	for (int phase = 0; phase < NUM_COMPONENT_PHASES; phase++)
+	{
+		for (int type = 0; type < NUM_COMPONENT_TYPES; type++)
+			holes[phase][type] = 0;
+		BuildWaves((ComponentPhase)phase);
+	}
+}
+
+ComponentScheduler::~ComponentScheduler()
+{}
+
+void ComponentScheduler::Register(Component * component)
+{
+	if (component->ticking)
+		return;
+	component->ticking = true;
+
+	ComponentType type = component->GetType();
+	unsigned char phases = GetComponentTypeTraits(type).phases;
+	for (int phase = 0; phase < NUM_COMPONENT_PHASES; phase++)
+	{
+		if (phases & PHASE_BIT(phase))
+		{
+			component->tick_slots[phase] = tick_lists[phase][type].size();
+			tick_lists[phase][type].push_back(component);
+		}
+	}
+}
+
+void ComponentScheduler::Unregister(Component * component)
+{
+	if (component->ticking == false)
+		return;
+	component->ticking = false;
+
+	ComponentType type = component->GetType();
+	for (int phase = 0; phase < NUM_COMPONENT_PHASES; phase++)
+	{
+		int slot = component->tick_slots[phase];
+		if (slot >= 0)
+		{
+			tick_lists[phase][type][slot] = nullptr;
+			holes[phase][type]++;
+			component->tick_slots[phase] = -1;
+		}
+	}
+}
+
+unsigned int ComponentScheduler::NumTicking(ComponentPhase phase) const
+{
+	unsigned int ret = 0;
+	for (int type = 0; type < NUM_COMPONENT_TYPES; type++)
+		ret += tick_lists[phase][type].size() - holes[phase][type];
+	return ret;
+}
+
+void ComponentScheduler::Compact(ComponentPhase phase, ComponentType type)
+{
+	std::vector<Component*>& list = tick_lists[phase][type];
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < list.size(); i++)
+	{
+		if (list[i] != nullptr)
+		{
+			list[count] = list[i];
+			list[count]->tick_slots[phase] = count;
+			++count;
+		}
+	}
+	list.resize(count);
+	holes[phase][type] = 0;
+}
+
+void ComponentScheduler::BuildWaves(ComponentPhase phase)
+{
+	//Greedy, in ComponentType order: a group goes to the first wave after the last one it conflicts with
+	for (int type = 0; type < NUM_COMPONENT_TYPES; type++)
+	{
+		const ComponentTypeTraits& traits = GetComponentTypeTraits((ComponentType)type);
+		if (traits.name == nullptr || (traits.phases & PHASE_BIT(phase)) == 0)
+			continue;
+
+		if ((traits.worker_phases & PHASE_BIT(phase)) == 0)
+		{
+			main_groups[phase].push_back((ComponentType)type);
+			continue;
+		}
+
+		unsigned int wave = 0;
+		for (unsigned int w = 0; w < worker_waves[phase].size(); w++)
+			for (unsigned int g = 0; g < worker_waves[phase][w].size(); g++)
+				if (traits.Conflicts(GetComponentTypeTraits(worker_waves[phase][w][g])))
+					wave = w + 1;
+
+		if (wave == worker_waves[phase].size())
+			worker_waves[phase].push_back(std::vector<ComponentType>());
+		worker_waves[phase][wave].push_back((ComponentType)type);
+	}
+}
+
+void ComponentScheduler::Run(ComponentPhase phase)
+{
+	BROFILER_CATEGORY("ComponentScheduler::Run", Profiler::Color::SkyBlue)
+
+	for (int type = 0; type < NUM_COMPONENT_TYPES; type++)
+		if (holes[phase][type] > 0)
+			Compact(phase, (ComponentType)type);
+
+	JobSystem* jobs = App->job_system;
+
+	for (unsigned int w = 0; w < worker_waves[phase].size(); w++)
+	{
+		Job* wave = jobs->CreateJob("ComponentScheduler::Wave", nullptr);
+
+		const std::vector<ComponentType>& wave_groups = worker_waves[phase][w];
+		for (unsigned int g = 0; g < wave_groups.size(); g++)
+		{
+			const std::vector<Component*>& group = tick_lists[phase][wave_groups[g]];
+			if (group.empty())
+				continue;
+
+			const ComponentTypeTraits& traits = GetComponentTypeTraits(wave_groups[g]);
+			unsigned int batch = traits.split_instances ? COMPONENT_SCHEDULER_BATCH : group.size();
+			for (unsigned int begin = 0; begin < group.size(); begin += batch)
+			{
+				unsigned int end = (begin + batch < group.size()) ? begin + batch : group.size();
+				jobs->Run(jobs->CreateJob(traits.name, [&group, phase, begin, end]() { UpdateGroup(group, phase, begin, end); }, wave));
+			}
+		}
+
+		jobs->Run(wave);
+		jobs->Wait(wave); //The main thread helps with the jobs
+	}
+
+	for (unsigned int g = 0; g < main_groups[phase].size(); g++)
+	{
+		const std::vector<Component*>& group = tick_lists[phase][main_groups[phase][g]];
+		UpdateGroup(group, phase, 0, group.size());
+	}
+}
+
+void ComponentScheduler::UpdateGroup(const std::vector<Component*>& group, ComponentPhase phase, unsigned int begin, unsigned int end)
+{
+	switch (phase)
+	{
+	case PHASE_PRE_UPDATE:
+		for (unsigned int i = begin; i < end; i++)
+			if (group[i])
+				group[i]->PreUpdate();
+		break;
+	case PHASE_UPDATE:
+		for (unsigned int i = begin; i < end; i++)
+			if (group[i])
+				group[i]->Update();
+		break;
+	case PHASE_POST_UPDATE:
+		for (unsigned int i = begin; i < end; i++)
+			if (group[i])
+				group[i]->PostUpdate();
+		break;
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef __COMPONENT_SCHEDULER_H__
+#define __COMPONENT_SCHEDULER_H__
+
+#include "Component.h"
+
+#include <vector>
+
+#define COMPONENT_SCHEDULER_BATCH 16 //Components per job when a type is split across workers
+
+#define PHASE_BIT(phase) (1 << (phase))
+
+//Shared data a component type touches while updating. Types that don't conflict can run at the same time.
+enum ComponentData
+{
+	DATA_OWN = 0, //Only its own members
+	DATA_TRANSFORM = 1 << 0, //Transforms of its GameObject or of its hierarchy
+	DATA_SKIN = 1 << 1, //Bone matrices of the skinned meshes
+	DATA_AUDIO = 1 << 2, //Sound engine and ModuleAudio
+	DATA_RENDER = 1 << 3, //Renderer queues and debug draw
+	DATA_PHYSICS = 1 << 4,
+	DATA_SCENE = 1 << 5, //GameObject creation, removal and hierarchy
+	DATA_INPUT = 1 << 6,
+	DATA_UI = 1 << 7
+};
+
+struct ComponentTypeTraits
+{
+	ComponentTypeTraits(const char* name = nullptr, unsigned char phases = 0, unsigned int reads = DATA_OWN, unsigned int writes = DATA_OWN, unsigned char worker_phases = 0, bool split_instances = false);
+
+	bool Conflicts(const ComponentTypeTraits& other)const;
+
+	const char* name; //Job name in the profiler
+	unsigned char phases; //Bit per ComponentPhase the type overrides. The others are never called.
+	unsigned int reads;
+	unsigned int writes;
+	unsigned char worker_phases; //Bit per ComponentPhase that is safe to run on a worker thread
+	bool split_instances; //Instances don't write anything shared, so one type can be spread over several jobs
+};
+
+const ComponentTypeTraits& GetComponentTypeTraits(ComponentType type);
+
+/*
+	Runs the component updates phase by phase, grouped by ComponentType.
+	Keeps one dense tick list per phase and type with the components that are active and implement that phase.
+	Components enter and leave the lists when their activity changes, so the cost depends on what ticks and not on the scene size.
+	Types marked for a phase run first on the job system, in waves of groups without conflicting data.
+	Then the rest run on the main thread in ComponentType order. Inside a list components keep the order they started ticking in,
+	so the result doesn't depend on the number of threads.
+*/
+class ComponentScheduler
+{
+public:
+	ComponentScheduler();
+	~ComponentScheduler();
+
+	void Register(Component* component);
+	void Unregister(Component* component);
+	void Run(ComponentPhase phase);
+
+	unsigned int NumTicking(ComponentPhase phase)const;
+
+private:
+	void BuildWaves(ComponentPhase phase);
+	void Compact(ComponentPhase phase, ComponentType type);
+	static void UpdateGroup(const std::vector<Component*>& group, ComponentPhase phase, unsigned int begin, unsigned int end);
+
+private:
+	//Removed components leave a nullptr that is compacted, keeping the order, before the next run of the list
+	std::vector<Component*> tick_lists[NUM_COMPONENT_PHASES][NUM_COMPONENT_TYPES];
+	unsigned int holes[NUM_COMPONENT_PHASES][NUM_COMPONENT_TYPES];
+	std::vector<std::vector<ComponentType>> worker_waves[NUM_COMPONENT_PHASES];
+	std::vector<ComponentType> main_groups[NUM_COMPONENT_PHASES];
+};
+
+#endif // !__COMPONENT_SCHEDULER_H__
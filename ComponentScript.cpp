@@ -51,6 +51,8 @@ void ComponentScript::Update()
 		}
 	}
 
+	ValidatePublicGos();
+
 	//Component must be active to update
 	if (!IsActive())
 		return;	
@@ -258,6 +260,7 @@ void ComponentScript::OnInspector(bool debug)
 		}
 		if (!public_gos.empty())
 		{
+			ValidatePublicGos();
 			for (map<const char*, GameObject*>::iterator it = public_gos.begin(); it != public_gos.end(); it++)
 			{
 				ImGui::Text((*it).first);
@@ -334,7 +337,7 @@ void ComponentScript::Save(Data & file) const
 void ComponentScript::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 	SetPath(conf.GetString("script_path"));
 	script_num = conf.GetInt("script_num");
 	
@@ -394,6 +397,7 @@ void ComponentScript::SetPath(const char * path)
 		public_bools.clear();
 	if (!public_gos.empty())
 		public_gos.clear();
+	public_go_handles.clear();
 
 	if (App->scripting->scripts_loaded)
 	{
@@ -419,6 +423,34 @@ void ComponentScript::SetGOVar(GameObject* game_object)
 	App->scripting->setting_go_var_name = "";
 }
 
+void ComponentScript::ValidatePublicGos()
+{
+	//Scripts and the editor write raw pointers in public_gos, so the handle is refreshed when the pointer changes.
+	//GameObject memory is never returned to the system, so reading the slot of a deleted one is safe.
+	for (map<const char*, GameObject*>::iterator it = public_gos.begin(); it != public_gos.end(); it++)
+	{
+		GameObjectHandle& handle = public_go_handles[(*it).first];
+		if ((*it).second == nullptr)
+		{
+			handle = GameObjectHandle();
+			continue;
+		}
+
+		if (GameObject::Get(handle) == (*it).second)
+			continue;
+
+		GameObjectHandle current = (*it).second->GetHandle();
+		bool same_slot_reused = (handle.IsNull() == false && handle.index == current.index);
+		if (current.IsNull() || same_slot_reused)
+		{
+			(*it).second = nullptr;
+			handle = GameObjectHandle();
+		}
+		else
+			handle = current;
+	}
+}
+
 void ComponentScript::OnFocus()
 {
 	if (App->scripting->scripts_loaded)
@@ -2,6 +2,7 @@
 #define __COMPONENT_SCRIPT_H__
 
 #include "Component.h"
+#include "GameObject.h"
 #include "Globals.h"
 #include <string>
 #include <map>
@@ -51,6 +52,9 @@ private:
 
 	map<const char*, unsigned int> tmp_public_gos_uuint;
 	bool public_gos_to_set;
+	map<const char*, GameObjectHandle> public_go_handles; //Last known handle of each public_gos entry
+
+	void ValidatePublicGos(); //Clears the public_gos entries whose GameObject was deleted
 
 public:
 	map<const char*, string> public_chars;
@@ -10,6 +10,7 @@
 
 #include "ModuleEditor.h"
 #include "ModuleRenderer3D.h"
+#include "ModuleGOManager.h"
 #include "DebugDraw.h"
 
 ComponentSprite::ComponentSprite(ComponentType type, GameObject* game_object) : Component(type, game_object)
@@ -65,6 +66,7 @@ void ComponentSprite::OnTransformModified()
 	math::OBB ob = aabb.Transform(game_object->GetGlobalMatrix());
 	bounding_box = ob.MinimalEnclosingAABB();
 	game_object->bounding_box = &bounding_box;
+	App->go_manager->OnBoundingBoxModified(game_object);
 }
 
 unsigned int ComponentSprite::GetTextureId() const
@@ -27,19 +27,6 @@ ComponentTransform::~ComponentTransform()
 
 }
 
-void ComponentTransform::Update()
-{
-	BROFILER_CATEGORY("ComponentTransform::Update", Profiler::Color::Tomato)
-
-	if (transform_modified)
-	{
-		transform_matrix = transform_matrix.FromTRS(position, rotation, scale);
-		CalculateFinalTransform();
-
-		transform_modified = false;
-	}
-}
-
 void ComponentTransform::OnInspector(bool debug)
 {
 	string str = (string("Transform") + string("##") + std::to_string(uuid));
@@ -243,6 +230,31 @@ math::float3 ComponentTransform::GetForward() const
 	return final_transform_matrix.WorldZ();
 }
 
+bool ComponentTransform::UpdateGlobalMatrix(bool parent_changed)
+{
+	if (transform_modified)
+		transform_matrix = transform_matrix.FromTRS(position, rotation, scale);
+	else if (parent_changed == false)
+		return false;
+
+	transform_modified = false;
+
+	GameObject* parent = game_object->GetParent();
+	final_transform_matrix = (parent) ? parent->transform->final_transform_matrix * transform_matrix : transform_matrix;
+	return true;
+}
+
+void ComponentTransform::ForceUpdate()
+{
+	if (transform_modified)
+	{
+		transform_matrix = transform_matrix.FromTRS(position, rotation, scale);
+		CalculateFinalTransform();
+
+		transform_modified = false;
+	}
+}
+
 void ComponentTransform::Save(Data & file) const
 {
 	Data data;
@@ -257,7 +269,7 @@ void ComponentTransform::Save(Data & file) const
 void ComponentTransform::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 
 	transform_matrix = conf.GetMatrix("matrix");
 
@@ -17,8 +17,6 @@ public:
 	ComponentTransform(ComponentType type, GameObject* game_object, math::float4x4** global_matrix);
 	~ComponentTransform();
 
-	void Update();
-
 	void OnInspector(bool debug);
 
 	void SetPosition(const math::float3& pos);
@@ -44,6 +42,11 @@ public:
 
 	math::float3 GetForward() const;
 
+	//Called by ModuleGOManager once per frame in parent-before-child order. Returns true if the global matrix changed.
+	bool UpdateGlobalMatrix(bool parent_changed);
+	//Recomputes the matrices right away instead of waiting for the ModuleGOManager pass
+	void ForceUpdate();
+
 	void Save(Data& file)const;
 	void Load(Data& conf);
 	void Reset();
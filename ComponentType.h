@@ -0,0 +1,31 @@
+#ifndef __COMPONENT_TYPE_H__
+#define __COMPONENT_TYPE_H__
+
+enum ComponentType
+{
+	C_TRANSFORM = 0,
+	C_MESH = 1,
+	C_MATERIAL = 2,
+	C_CAMERA = 3,
+	C_LIGHT = 4,
+	C_ANIMATION = 5,
+	C_BONE = 6,
+	//C_Audio was here
+	C_COLLIDER = 8,
+	C_CAR = 9,
+	C_SCRIPT = 10,
+	C_RECT_TRANSFORM = 11,
+	C_CANVAS = 12,
+	C_UI_IMAGE = 13,
+	C_UI_TEXT = 14,
+	C_UI_BUTTON = 15,
+	C_GRID = 16,
+	C_AUDIO_LISTENER = 17,
+	C_AUDIO_SOURCE = 18,
+	C_SPRITE = 19,
+	C_PARTICLE_SYSTEM = 20
+};
+
+#define NUM_COMPONENT_TYPES 21 //Size of the per-type tables. Must stay above the last ComponentType.
+
+#endif // !__COMPONENT_TYPE_H__
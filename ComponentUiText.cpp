@@ -6,8 +6,7 @@
 #include "ComponentRectTransform.h"
 #include "ComponentMaterial.h"
 #include "ResourceFileTexture.h"
-#include "ResourceFileMesh.h"
-#include "ComponentMesh.h"
+#include "GlyphAtlas.h"
 #include "imgui\imgui.h"
 
 ComponentUiText::ComponentUiText(ComponentType type, GameObject * game_object) : Component(type, game_object)
@@ -22,64 +21,14 @@ ComponentUiText::ComponentUiText(ComponentType type, GameObject * game_object) :
 	img_height = 100;
 	char_w = new int[2];
 	char_h = new int[2];
-	GeneratePlane();
 }
 
 ComponentUiText::~ComponentUiText()
 {
+	GlyphAtlas::Release(atlas);
 	delete UImaterial;
 }
 
-void ComponentUiText::GeneratePlane()
-{
-	std::string prim_path = "Resources/Primitives/2147000003.msh";
-	ResourceFileMesh* tmp_rc = (ResourceFileMesh*)App->resource_manager->LoadResource(prim_path, ResourceFileType::RES_MESH);
-	ResourceFileMesh* plane = new ResourceFileMesh(*tmp_rc);
-	plane->mesh = new Mesh();
-	plane->mesh->num_vertices = 4;
-	plane->mesh->vertices = new float[plane->mesh->num_vertices * 3];
-	plane->mesh->num_indices = 6;
-	plane->mesh->indices = new uint[plane->mesh->num_indices];
-	plane->mesh->num_uvs = 4;
-	plane->mesh->uvs = new float[plane->mesh->num_uvs * 2];
-	plane->mesh->vertices[0] = 0.0f;
-	plane->mesh->vertices[1] = 0.0f;
-	plane->mesh->vertices[2] = 0.0f;
-	plane->mesh->vertices[3] = 1.0f;
-	plane->mesh->vertices[4] = 0.0f;
-	plane->mesh->vertices[5] = 0.0f;
-	plane->mesh->vertices[6] = 0.0f;
-	plane->mesh->vertices[7] = 1.0f;
-	plane->mesh->vertices[8] = 0.0f;
-	plane->mesh->vertices[9] = 1.0f;
-	plane->mesh->vertices[10] = 1.0f;
-	plane->mesh->vertices[11] = 0.0f;
-
-
-	plane->mesh->indices[0] = 0;
-	plane->mesh->indices[1] = 2;
-	plane->mesh->indices[2] = 1;
-	plane->mesh->indices[3] = 1;
-	plane->mesh->indices[4] = 2;
-	plane->mesh->indices[5] = 3;
-
-
-
-	plane->mesh->uvs[0] = 0.0f;
-	plane->mesh->uvs[1] = 1.0f;
-	plane->mesh->uvs[2] = 1.0f;
-	plane->mesh->uvs[3] = 1.0f;
-	plane->mesh->uvs[4] = 0.0f;
-	plane->mesh->uvs[5] = 0.0f;
-	plane->mesh->uvs[6] = 1.0f;
-	plane->mesh->uvs[7] = 0.0f;
-
-	plane->ReLoadInMemory();
-	tplane = plane;
-	planes.push_back(plane);
-	meshes.push_back(plane->mesh);
-}
-
 void ComponentUiText::Update()
 {
 		
@@ -138,7 +87,8 @@ void ComponentUiText::OnInspector(bool debug)
 			SetText(array_values);
 		}
 
-		ImGui::InputInt("Letter offset", &char_offset);
+		if (ImGui::InputInt("Letter offset", &char_offset))
+			quads_dirty = true;
 	}
 }
 
@@ -160,7 +110,7 @@ void ComponentUiText::Save(Data & file) const
 void ComponentUiText::Load(Data & conf)
 {
 	uuid = conf.GetUInt("UUID");
-	active = conf.GetBool("active");
+	SetActive(conf.GetBool("active"));
 	text = conf.GetString("text");
 	array_values = conf.GetString("array_values");
 	char_offset = conf.GetInt("char_offset");
@@ -248,12 +198,86 @@ void ComponentUiText::SetText(string &text)
 
 void ComponentUiText::SetDisplayText(string text)
 {
+	//Scripts set it every frame, most of the times with the same text
+	if (this->text == text)
+		return;
 	this->text = text;
+	quads_dirty = true;
 }
 
 void ComponentUiText::SetCharOffset(int off)
 {
+	if (char_offset == off)
+		return;
 	char_offset = off;
+	quads_dirty = true;
+}
+
+const vector<float>& ComponentUiText::GetQuads()
+{
+	if (quads_dirty)
+	{
+		RebuildQuads();
+		quads_dirty = false;
+	}
+	return quads;
+}
+
+const GlyphAtlas * ComponentUiText::GetAtlas() const
+{
+	return atlas;
+}
+
+void ComponentUiText::RebuildQuads()
+{
+	quads.clear();
+
+	if (atlas == nullptr)
+	{
+		//Glyph i is the texture "i" of the material. The font is known by the paths of its textures.
+		vector<uint> textures;
+		string font_key;
+		for (uint i = 0; ; i++)
+		{
+			map<string, uint>::const_iterator tex = UImaterial->texture_ids.find(to_string(i));
+			if (tex == UImaterial->texture_ids.end())
+				break;
+			textures.push_back(tex->second);
+			font_key += (i < UImaterial->list_textures_paths.size()) ? UImaterial->list_textures_paths[i] : to_string(tex->second);
+			font_key += '|';
+		}
+		if (textures.empty())
+			return;
+		atlas = GlyphAtlas::Acquire(font_key, textures);
+	}
+
+	//Same corners as the glyph planes: the top of the quad takes the v = 1 of the glyph
+	float x = 0.0f;
+	for (size_t i = 0; i < text.length(); i++)
+	{
+		size_t j = array_values.find(text[i]);
+		if (j == string::npos)
+			continue;
+
+		float letter_w = 0.0f;
+		if (j < atlas->NumGlyphs())
+		{
+			const GlyphRect& glyph = atlas->GetGlyph(j);
+			letter_w = glyph.width;
+			if (glyph.width > 0.0f)
+			{
+				float corners[4][4] = {
+					{ x, 0.0f, glyph.u0, glyph.v1 },
+					{ x + glyph.width, 0.0f, glyph.u1, glyph.v1 },
+					{ x, glyph.height, glyph.u0, glyph.v0 },
+					{ x + glyph.width, glyph.height, glyph.u1, glyph.v0 } };
+				const int triangles[6] = { 0, 2, 1, 1, 2, 3 };
+				for (int v = 0; v < 6; v++)
+					quads.insert(quads.end(), corners[triangles[v]], corners[triangles[v]] + 4);
+			}
+		}
+		x += letter_w + char_offset;
+	}
 }
 
 void ComponentUiText::GenerateFont()
@@ -263,14 +287,13 @@ void ComponentUiText::GenerateFont()
 
 bool ComponentUiText::OnChangeTexture()
 {
+	//The font may be another one, it is baked again on the next GetQuads()
+	GlyphAtlas::Release(atlas);
+	atlas = nullptr;
+	quads_dirty = true;
+
 	if (UImaterial->list_textures_paths.size() > 0)
 	{
-		for (vector<ResourceFileMesh*>::const_iterator it = planes.begin(); it != planes.end(); it++)
-		{
-			(*it)->Unload();
-		}
-		planes.clear();
-		meshes.clear();
 		int i = 0;
 		char_w = new int[UImaterial->list_textures_paths.size()];
 		char_h = new int[UImaterial->list_textures_paths.size()];
@@ -286,49 +309,6 @@ bool ComponentUiText::OnChangeTexture()
 
 				char_w[i] = img_width;
 				char_h[i] = img_height;
-
-				ResourceFileMesh* plane = new ResourceFileMesh(*tplane);
-				plane->mesh = new Mesh();
-
-				plane->mesh->num_vertices = 4;
-				plane->mesh->vertices = new float[plane->mesh->num_vertices * 3];
-				plane->mesh->num_indices = 6;
-				plane->mesh->indices = new uint[plane->mesh->num_indices];
-				plane->mesh->num_uvs = 4;
-				plane->mesh->uvs = new float[plane->mesh->num_uvs * 2];
-				plane->mesh->vertices[0] = 0.0f;
-				plane->mesh->vertices[1] = 0.0f;
-				plane->mesh->vertices[2] = 0.0f;
-				plane->mesh->vertices[3] = char_w[i];
-				plane->mesh->vertices[4] = 0.0f;
-				plane->mesh->vertices[5] = 0.0f;
-				plane->mesh->vertices[6] = 0.0f;
-				plane->mesh->vertices[7] = char_h[i];
-				plane->mesh->vertices[8] = 0.0f;
-				plane->mesh->vertices[9] = char_w[i];
-				plane->mesh->vertices[10] = char_h[i];
-				plane->mesh->vertices[11] = 0.0f;
-
-				plane->mesh->indices[0] = 0;
-				plane->mesh->indices[1] = 2;
-				plane->mesh->indices[2] = 1;
-				plane->mesh->indices[3] = 1;
-				plane->mesh->indices[4] = 2;
-				plane->mesh->indices[5] = 3;
-
-				plane->mesh->uvs[0] = 0.0f;
-				plane->mesh->uvs[1] = 1.0f;
-				plane->mesh->uvs[2] = 1.0f;
-				plane->mesh->uvs[3] = 1.0f;
-				plane->mesh->uvs[4] = 0.0f;
-				plane->mesh->uvs[5] = 0.0f;
-				plane->mesh->uvs[6] = 1.0f;
-				plane->mesh->uvs[7] = 0.0f;
-
-				plane->ReLoadInMemory();
-
-				planes.push_back(plane);
-				meshes.push_back(plane->mesh);
 			}
 
 			i++;
@@ -5,8 +5,7 @@
 #include "Component.h"
 //#include <vector>
 class ComponentMaterial;
-class ResourceFileMesh;
-class Mesh;
+class GlyphAtlas;
 
 class ComponentUiText : public Component
 {
@@ -38,14 +37,20 @@ public:
 	void SetDisplayText(string text);
 	void SetCharOffset(int off);
 
-	vector<Mesh*> meshes;
+	//Glyph quads in the space of the rect transform: x, y, u, v per vertex, two triangles per glyph, uvs in the atlas.
+	//Rebuilt only when the text, the font or the letter offset change.
+	const vector<float>& GetQuads();
+	const GlyphAtlas* GetAtlas()const; //nullptr until GetQuads() bakes the font
+
 private:
 	void GenerateFont();
 	bool OnChangeTexture();
-	void GeneratePlane();
+	void RebuildQuads();
 	bool change_text = false;
 	bool change_array_values = false;
-	vector<ResourceFileMesh*> planes;
+	GlyphAtlas* atlas = nullptr; //Shared with the texts with the same font
+	vector<float> quads;
+	bool quads_dirty = true;
 	string text = "";
 	string array_values = "";
 	uint len = 0;
@@ -56,7 +61,6 @@ private:
 	int char_offset = 0;
 	int text_type = 0;
 	string current_text_changing = "";
-	ResourceFileMesh* tplane = nullptr;
 };
 
 #endif // !__COMPONENTUITEXT_H__
\ No newline at end of file
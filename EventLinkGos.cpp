@@ -3,7 +3,7 @@
 #include "Application.h"
 #include "ModuleGOManager.h"
 
-EventLinkGos::EventLinkGos(GameObject **pointer_to_go, unsigned int uuid_to_assign)
+EventLinkGos::EventLinkGos(GameObject **pointer_to_go, unsigned int uuid_to_assign, const ComponentHandle& owner) : owner(owner)
 {
 	type = EventType::E_LINK_GOS;
 	this->pointer_to_go = pointer_to_go;
@@ -12,6 +12,9 @@ EventLinkGos::EventLinkGos(GameObject **pointer_to_go, unsigned int uuid_to_assi
 
 bool EventLinkGos::Process()
 {
+	if (owner.IsNull() == false && Component::Get(owner) == nullptr)
+		return true; //The owner is gone, pointer_to_go is not valid memory anymore
+
 	App->go_manager->LinkGameObjectPointer(pointer_to_go, uuid_to_assign);
 	return true;
 }
@@ -2,6 +2,7 @@
 #define __EVENTLINKGOS_H__
 
 #include "EventData.h"
+#include "Component.h"
 
 class GameObject;
 
@@ -12,10 +13,11 @@ private:
 
 	unsigned int uuid_to_assign;
 	GameObject **pointer_to_go;
+	ComponentHandle owner; //Component that holds pointer_to_go. If it's deleted before the event is processed nothing is written.
 
 public:
 
-	EventLinkGos(GameObject **pointer_to_go, unsigned int uuid_to_assign);
+	EventLinkGos(GameObject **pointer_to_go, unsigned int uuid_to_assign, const ComponentHandle& owner = ComponentHandle());
 	bool Process();
 };
 
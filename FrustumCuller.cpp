@@ -0,0 +1,171 @@
+#include "FrustumCuller.h"
+
+#include <xmmintrin.h>
+
+FrustumCuller::FrustumCuller()
+{}
+
+FrustumCuller::~FrustumCuller()
+{}
+
+void FrustumCuller::ClearFrustums()
+{
+	frustums.clear();
+}
+
+void FrustumCuller::AddFrustum(const math::Frustum& frustum)
+{
+	math::Plane planes[6];
+	frustum.GetPlanes(planes);
+
+	//Plane normals point outside the frustum
+	FrustumPlanes fp;
+	for (int p = 0; p < 6; p++)
+	{
+		fp.normal_x[p] = planes[p].normal.x;
+		fp.normal_y[p] = planes[p].normal.y;
+		fp.normal_z[p] = planes[p].normal.z;
+		fp.d[p] = planes[p].d;
+	}
+	frustums.push_back(fp);
+}
+
+unsigned int FrustumCuller::NumFrustums() const
+{
+	return frustums.size();
+}
+
+void FrustumCuller::ClearBoxes()
+{
+	center_x.clear(); center_y.clear(); center_z.clear();
+	extent_x.clear(); extent_y.clear(); extent_z.clear();
+	num_boxes = 0;
+}
+
+unsigned int FrustumCuller::AddBox(const math::AABB& box)
+{
+	math::float3 center = box.CenterPoint();
+	math::float3 extents = box.HalfSize();
+
+	if ((num_boxes & 3) == 0) //Open a new block of 4. Unused slots are masked out after culling.
+	{
+		center_x.resize(num_boxes + 4, 0.0f); center_y.resize(num_boxes + 4, 0.0f); center_z.resize(num_boxes + 4, 0.0f);
+		extent_x.resize(num_boxes + 4, 0.0f); extent_y.resize(num_boxes + 4, 0.0f); extent_z.resize(num_boxes + 4, 0.0f);
+	}
+
+	center_x[num_boxes] = center.x; center_y[num_boxes] = center.y; center_z[num_boxes] = center.z;
+	extent_x[num_boxes] = extents.x; extent_y[num_boxes] = extents.y; extent_z[num_boxes] = extents.z;
+
+	return num_boxes++;
+}
+
+unsigned int FrustumCuller::NumBoxes() const
+{
+	return num_boxes;
+}
+
+void FrustumCuller::Cull()
+{
+	unsigned int num_blocks = (num_boxes + 3) / 4;
+	unsigned int num_words = (num_boxes + 31) / 32;
+
+	visibility.resize(frustums.size());
+	for (unsigned int f = 0; f < frustums.size(); f++)
+		visibility[f].assign(num_words, 0);
+
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+
+	for (unsigned int block = 0; block < num_blocks; block++)
+	{
+		unsigned int base = block * 4;
+		__m128 cx = _mm_loadu_ps(&center_x[base]);
+		__m128 cy = _mm_loadu_ps(&center_y[base]);
+		__m128 cz = _mm_loadu_ps(&center_z[base]);
+		__m128 ex = _mm_loadu_ps(&extent_x[base]);
+		__m128 ey = _mm_loadu_ps(&extent_y[base]);
+		__m128 ez = _mm_loadu_ps(&extent_z[base]);
+
+		for (unsigned int f = 0; f < frustums.size(); f++)
+		{
+			const FrustumPlanes& fp = frustums[f];
+			__m128 outside = _mm_setzero_ps();
+
+			for (int p = 0; p < 6; p++)
+			{
+				__m128 nx = _mm_set1_ps(fp.normal_x[p]);
+				__m128 ny = _mm_set1_ps(fp.normal_y[p]);
+				__m128 nz = _mm_set1_ps(fp.normal_z[p]);
+
+				//Signed distance from the center to the plane
+				__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_mul_ps(nz, cz));
+				dist = _mm_sub_ps(dist, _mm_set1_ps(fp.d[p]));
+
+				//Projected radius of the box over the plane normal
+				__m128 radius = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_andnot_ps(sign_mask, nx), ex),
+					_mm_mul_ps(_mm_andnot_ps(sign_mask, ny), ey)),
+					_mm_mul_ps(_mm_andnot_ps(sign_mask, nz), ez));
+
+				outside = _mm_or_ps(outside, _mm_cmpgt_ps(dist, radius));
+			}
+
+			uint32_t visible = (~_mm_movemask_ps(outside)) & 0xF;
+			visibility[f][base >> 5] |= visible << (base & 31);
+		}
+	}
+
+	//Clear the padding of the last block
+	if (num_boxes & 31)
+	{
+		uint32_t valid = (1u << (num_boxes & 31)) - 1;
+		for (unsigned int f = 0; f < frustums.size(); f++)
+			visibility[f].back() &= valid;
+	}
+}
+
+bool FrustumCuller::IsVisible(unsigned int frustum, unsigned int box) const
+{
+	return (visibility[frustum][box >> 5] & (1u << (box & 31))) != 0;
+}
+
+void FrustumCuller::Hide(unsigned int frustum, unsigned int box)
+{
+	visibility[frustum][box >> 5] &= ~(1u << (box & 31));
+}
+
+unsigned int FrustumCuller::NumVisible(unsigned int frustum) const
+{
+	unsigned int ret = 0;
+	for (size_t i = 0; i < visibility[frustum].size(); i++)
+	{
+		uint32_t word = visibility[frustum][i];
+		while (word)
+		{
+			word &= word - 1;
+			++ret;
+		}
+	}
+	return ret;
+}
+
+bool FrustumCuller::Intersects(const math::AABB& box) const
+{
+	math::float3 center = box.CenterPoint();
+	math::float3 extents = box.HalfSize();
+
+	for (unsigned int f = 0; f < frustums.size(); f++)
+	{
+		const FrustumPlanes& fp = frustums[f];
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++)
+		{
+			float dist = fp.normal_x[p] * center.x + fp.normal_y[p] * center.y + fp.normal_z[p] * center.z - fp.d[p];
+			float radius = math::Abs(fp.normal_x[p]) * extents.x + math::Abs(fp.normal_y[p]) * extents.y + math::Abs(fp.normal_z[p]) * extents.z;
+			if (dist > radius)
+				inside = false;
+		}
+		if (inside)
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,58 @@
+#ifndef __FRUSTUM_CULLER_H__
+#define __FRUSTUM_CULLER_H__
+
+#include "MathGeoLib\include\MathGeoLib.h"
+
+#include <vector>
+#include <cstdint>
+
+/*
+	Batch frustum culling for every active camera at once.
+	Boxes are stored as center/extents in structure-of-arrays form and tested 4 at a time with SSE against the
+	6 planes of each frustum. The result is one visibility bitset per frustum.
+*/
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+	~FrustumCuller();
+
+	void ClearFrustums();
+	void AddFrustum(const math::Frustum& frustum);
+	unsigned int NumFrustums()const;
+
+	void ClearBoxes();
+	unsigned int AddBox(const math::AABB& box); //Returns the index of the box
+	unsigned int NumBoxes()const;
+
+	void Cull();
+	bool IsVisible(unsigned int frustum, unsigned int box)const;
+	void Hide(unsigned int frustum, unsigned int box); //For later passes that find more hidden boxes (occlusion)
+	unsigned int NumVisible(unsigned int frustum)const;
+
+	bool Intersects(const math::AABB& box)const; //True if any frustum sees the box. Used as broadphase primitive.
+
+private:
+	struct FrustumPlanes
+	{
+		float normal_x[6];
+		float normal_y[6];
+		float normal_z[6];
+		float d[6];
+	};
+
+	std::vector<FrustumPlanes> frustums;
+
+	//Boxes (SoA). Padded to a multiple of 4.
+	std::vector<float> center_x;
+	std::vector<float> center_y;
+	std::vector<float> center_z;
+	std::vector<float> extent_x;
+	std::vector<float> extent_y;
+	std::vector<float> extent_z;
+	unsigned int num_boxes = 0;
+
+	std::vector<std::vector<uint32_t>> visibility; //One bitset per frustum
+};
+
+#endif // !__FRUSTUM_CULLER_H__
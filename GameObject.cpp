@@ -30,14 +30,53 @@
 #include "ComponentBone.h"
 #include "ModuleGOManager.h"
 #include "ResourceFilePrefab.h"
+#include "ResourceFileMesh.h"
+#include "MeshBVH.h"
 
 #include "Random.h"
 
+#include <algorithm>
+
+//Function-local so it exists before the first GameObject and outlives the last one
+static SlotMap<GameObject>& GetStorage()
+{
+	static SlotMap<GameObject> storage;
+	return storage;
+}
+
+void* GameObject::operator new(size_t size)
+{
+	GameObjectHandle handle;
+	return GetStorage().Allocate(handle);
+}
+
+void GameObject::operator delete(void* p)
+{
+	if (p)
+		GetStorage().Release(p);
+}
+
+GameObjectHandle GameObject::GetHandle() const
+{
+	return GetStorage().GetHandle(this);
+}
+
+GameObject* GameObject::Get(const GameObjectHandle& handle)
+{
+	return GetStorage().Get(handle);
+}
+
+unsigned int GameObject::Count()
+{
+	return GetStorage().Count();
+}
+
 GameObject::GameObject()
 {
 	name.resize(30);
 	name = "Empty GameObject";
 	uuid = App->rnd->RandomInt();
+	App->go_manager->RegisterGameObject(this);
 	AddComponent(C_TRANSFORM);
 }
 
@@ -46,7 +85,9 @@ GameObject::GameObject(GameObject* parent) : parent(parent)
 	name.resize(30);
 	name = "Empty GameObject";
 	uuid = App->rnd->RandomInt();
+	App->go_manager->RegisterGameObject(this);
 	AddComponent(C_TRANSFORM);
+	RefreshActiveInHierarchy();
 	if (parent)
 	{
 		if (parent->IsPrefab())
@@ -61,11 +102,14 @@ GameObject::GameObject(GameObject* parent) : parent(parent)
 GameObject::GameObject(const char* name, unsigned int uuid, GameObject* parent, bool active, bool is_static, bool is_prefab, int layer, unsigned int prefab_root_uuid, const string& prefab_path) 
 	: name(name), uuid(uuid), parent(parent), active(active), is_static(is_static), is_prefab(is_prefab), layer(layer), prefab_root_uuid(prefab_root_uuid), prefab_path(prefab_path)
 {
+	App->go_manager->RegisterGameObject(this);
 	AddComponent(C_TRANSFORM);
+	RefreshActiveInHierarchy();
 }
 
 GameObject::~GameObject()
 {
+	App->go_manager->UnregisterGameObject(this);
 	global_matrix = nullptr;
 	bounding_box = nullptr;
 	mesh_to_draw = nullptr;
@@ -85,11 +129,8 @@ GameObject::~GameObject()
 	}
 }
 
-void GameObject::PreUpdate()
+void GameObject::RemovePendingComponents()
 {
-	//Reset elements to draw
-	mesh_to_draw = nullptr;
-
 	//Remove all components that need to be removed. Secure way.
 	for (std::vector<Component*>::iterator component = components_to_remove.begin(); component != components_to_remove.end(); ++component)
 	{
@@ -101,34 +142,39 @@ void GameObject::PreUpdate()
 				break;
 			}
 		}
+
+		//The slot moves to the next component of the same type, if any
+		ComponentType type = (*component)->GetType();
+		if (component_slots[type] == (*component))
+		{
+			component_slots[type] = nullptr;
+			component_mask &= ~(1u << type);
+			for (std::vector<Component*>::iterator comp = components.begin(); comp != components.end(); ++comp)
+			{
+				if ((*comp)->GetType() == type)
+				{
+					component_slots[type] = (*comp);
+					component_mask |= (1u << type);
+					break;
+				}
+			}
+		}
+		if (type == C_MESH)
+			InvalidateBounds();
 		delete (*component);
 	}
 
 	components_to_remove.clear();
 }
 
-void GameObject::Update()
-{
-	for (std::vector<Component*>::iterator comp = components.begin(); comp != components.end(); comp++)
-	{
-		(*comp)->PreUpdate();
-	}
-	for (std::vector<Component*>::iterator comp = components.begin(); comp != components.end(); comp++)
-	{
-		(*comp)->Update();
-	}
-	for (std::vector<Component*>::iterator comp = components.begin(); comp != components.end(); comp++)
-	{
-		(*comp)->PostUpdate();
-	}
-}
-
 bool GameObject::AddChild(GameObject* child)
 {
 	bool ret = false;
 	if (child)
 	{
 		childs.push_back(child);
+		App->go_manager->OnHierarchyModified(child);
+		InvalidateBounds();
 		ret = true;
 	}
 
@@ -148,6 +194,8 @@ bool GameObject::RemoveChild(GameObject* child)
 			if (*item == child)
 			{
 				childs.erase(item);
+				App->go_manager->OnHierarchyModified();
+				InvalidateBounds();
 				ret = true;
 				break;
 			}
@@ -166,6 +214,8 @@ void GameObject::RemoveAllChilds()
 	}
 
 	childs.clear();
+	App->go_manager->OnHierarchyModified();
+	InvalidateBounds();
 }
 
 GameObject* GameObject::GetParent()const
@@ -185,6 +235,7 @@ void GameObject::SetParent(GameObject * parent)
 
 		float4x4 global = transform->GetGlobalMatrix();
 		this->parent = parent;
+		RefreshActiveInHierarchy();
 		if (parent)
 		{
 			float4x4 new_local = parent->transform->GetGlobalMatrix().Inverted() * global;
@@ -268,48 +319,64 @@ void GameObject::OnPause()
 	}
 }
 
-bool *GameObject::GetActiveBoolean()
+bool GameObject::IsActiveSelf() const
 {
-	return &active;
+	return active;
 }
 
 bool GameObject::IsActive() const
 {	
-	// Obtaning all gameobjects from "this" to root, up in the hierarchy
-	const GameObject *curr_go = this;
-	std::vector<const GameObject*> hierarchy_gos;	
-
-	while (curr_go != nullptr && !App->go_manager->IsRoot(curr_go))
-	{
-		hierarchy_gos.push_back(curr_go);
-		curr_go = curr_go->parent;
-	}
+	return active_in_hierarchy;
+}
 
-	// Checking if all Gameobjects are active
-	bool is_active = true;
-	for (std::vector<const GameObject*>::const_iterator it = hierarchy_gos.begin(); it != hierarchy_gos.end(); ++it)
+void GameObject::SetActive(bool value)
+{
+	if (value != active)
 	{
-		if (!(*it)->active)
-		{
-			is_active = false;	 // There is one that it's not active, so...
-			break;				 // this gameobject is not active at the end.
-		}			
+		active = value;
+		RefreshActiveInHierarchy();
 	}
-
-	return is_active;
 }
 
-void GameObject::SetActive(bool value)
+void GameObject::SetAllActive(bool value)
 {
-	if (value != active) active = value;
+	std::vector<GameObject*> stack(1, this);
+	while (stack.empty() == false)
+	{
+		GameObject* go = stack.back();
+		stack.pop_back();
+		go->active = value;
+		stack.insert(stack.end(), go->childs.begin(), go->childs.end());
+	}
+	RefreshActiveInHierarchy();
 }
 
-void GameObject::SetAllActive(bool value)
+void GameObject::RefreshActiveInHierarchy()
 {
-	if (value != active) active = value;
-	for (uint i = 0; i < childs.size(); i++)
+	//Explicit stack instead of recursion, deep hierarchies would overflow it. Parents are always refreshed before their childs.
+	//Not done over the flat transform order: this runs in the middle of hierarchy changes, when that order is outdated.
+	std::vector<GameObject*> stack(1, this);
+	while (stack.empty() == false)
 	{
-		childs[i]->SetAllActive(value);
+		GameObject* go = stack.back();
+		stack.pop_back();
+
+		//Root is always active. Objects right under it only depend on their own flag.
+		bool value;
+		if (go->parent == nullptr)
+			value = go->active || App->go_manager->IsRoot(go);
+		else
+			value = go->active && (App->go_manager->IsRoot(go->parent) || go->parent->active_in_hierarchy);
+
+		if (value == go->active_in_hierarchy)
+			continue; //The subtree is already up to date
+
+		go->active_in_hierarchy = value;
+		for (uint i = 0; i < go->components.size(); i++)
+		{
+			go->components[i]->RefreshTick();
+		}
+		stack.insert(stack.end(), go->childs.begin(), go->childs.end());
 	}
 }
 
@@ -374,9 +441,18 @@ bool GameObject::IsPrefab() const
 	return is_prefab;
 }
 
+void GameObject::SetLayer(int _layer)
+{
+	if (layer != _layer)
+	{
+		layer = _layer;
+		InvalidateBounds();
+	}
+}
+
 void GameObject::SetLayerChilds(int _layer)
 {
-	layer = _layer;
+	SetLayer(_layer);
 	for (vector<GameObject*>::iterator child = childs.begin(); child != childs.end(); ++child)
 		(*child)->SetLayerChilds(_layer);
 }
@@ -480,6 +556,15 @@ Component* GameObject::AddComponent(ComponentType type)
 	if (item != nullptr)
 	{
 		components.push_back(item);
+		if (component_slots[type] == nullptr)
+		{
+			component_slots[type] = item;
+			component_mask |= (1u << type);
+		}
+		App->go_manager->RegisterComponent(item);
+		item->RefreshTick();
+		if (type == C_MESH)
+			InvalidateBounds();
 	}
 	else
 	{
@@ -497,22 +582,12 @@ const std::vector<Component*>* GameObject::GetComponents()
 
 Component* GameObject::GetComponent(ComponentType type)const
 {
-	if (components.empty() == false)
-	{
-		if (type == C_TRANSFORM)
-			return transform;
+	return ((unsigned int)type < NUM_COMPONENT_TYPES) ? component_slots[type] : nullptr;
+}
 
-		std::vector<Component*>::const_iterator comp = components.begin();
-		while (comp != components.end())
-		{
-			if ((*comp)->GetType() == type)
-			{
-				return (*comp);
-			}
-			++comp;
-		}
-	}
-	return nullptr;
+bool GameObject::HasComponent(ComponentType type) const
+{
+	return ((unsigned int)type < NUM_COMPONENT_TYPES) && (component_mask & (1u << type)) != 0;
 }
 
 Component* GameObject::GetComponentInChilds(ComponentType type) const
@@ -533,15 +608,15 @@ Component* GameObject::GetComponentInChilds(ComponentType type) const
 
 void GameObject::GetComponentsInChilds(ComponentType type, std::vector<Component*>& vector) const
 {
-	Component* comp = GetComponent(type);
-	if (comp != nullptr)
-		vector.push_back(comp);
+	App->go_manager->GetAllComponents(vector, type, this);
+}
 
-	std::vector<GameObject*>::const_iterator it = childs.begin();
-	for (it; it != childs.end(); ++it)
-	{
-		(*it)->GetComponentsInChilds(type, vector);
-	}
+bool GameObject::IsInSubtreeOf(const GameObject* go) const
+{
+	for (const GameObject* it = this; it != nullptr; it = it->parent)
+		if (it == go)
+			return true;
+	return false;
 }
 
 void GameObject::RemoveComponent(Component * component)
@@ -554,12 +629,26 @@ void GameObject::RemoveComponent(Component * component)
 	{
 		if ((*it) == component)
 		{
+			if (components_to_remove.empty())
+				App->go_manager->OnComponentRemovalQueued(this);
 			components_to_remove.push_back(component);
+			component->LeaveTickLists();
 			break;
 		}
 	}
 }
 
+void GameObject::SetMeshToDraw(Mesh * mesh)
+{
+	mesh_to_draw = mesh;
+	mesh_to_draw_frame = App->go_manager->GetFrame();
+}
+
+Mesh * GameObject::GetMeshToDraw() const
+{
+	return (mesh_to_draw_frame == App->go_manager->GetFrame()) ? mesh_to_draw : nullptr;
+}
+
 float4x4 GameObject::GetGlobalMatrix() const
 {
 	return (global_matrix) ? *global_matrix : float4x4::identity;
@@ -572,6 +661,7 @@ unsigned int GameObject::GetUUID() const
 
 void GameObject::TransformModified()
 {
+	InvalidateBounds();
 	if (global_matrix == nullptr)
 		return;
 	std::vector<Component*>::iterator component = components.begin();
@@ -582,6 +672,87 @@ void GameObject::TransformModified()
 	}
 }
 
+void GameObject::InvalidateBounds()
+{
+	for (GameObject* go = this; go != nullptr && go->bounds_dirty == false; go = go->parent)
+		go->bounds_dirty = true;
+}
+
+const AABB& GameObject::GetSubtreeAABB()
+{
+	if (bounds_dirty)
+		RefreshBounds();
+	return subtree_aabb;
+}
+
+bool GameObject::GetSubtreeAABB(const std::vector<int>& layers, AABB& aabb)
+{
+	if (bounds_dirty)
+		RefreshBounds();
+
+	bool found = false;
+	for (std::vector<LayerBounds>::const_iterator it = subtree_layer_bounds.begin(); it != subtree_layer_bounds.end(); ++it)
+	{
+		if (std::find(layers.begin(), layers.end(), it->layer) == layers.end())
+			continue;
+
+		if (found)
+			aabb.Enclose(it->bounds);
+		else
+			aabb = it->bounds;
+		found = true;
+	}
+	return found;
+}
+
+void GameObject::RefreshBounds()
+{
+	//Dirty nodes in breadth-first order, then refreshed backwards: childs before their parents, without recursion.
+	//Clean childs give their cache as it is, so their subtrees are not visited.
+	std::vector<GameObject*> dirty(1, this);
+	for (size_t i = 0; i < dirty.size(); i++)
+	{
+		for (std::vector<GameObject*>::const_iterator child = dirty[i]->childs.begin(); child != dirty[i]->childs.end(); ++child)
+			if ((*child)->bounds_dirty)
+				dirty.push_back(*child);
+	}
+
+	for (size_t i = dirty.size(); i > 0; i--)
+		dirty[i - 1]->RefreshOwnBounds();
+}
+
+void GameObject::RefreshOwnBounds()
+{
+	ComponentMesh* mesh = (ComponentMesh*)GetComponent(C_MESH);
+	if (mesh)
+		subtree_aabb = mesh->GetBoundingBox();
+	else
+		subtree_aabb = AABB(transform->GetPosition(), transform->GetPosition());
+
+	subtree_layer_bounds.clear();
+	subtree_layer_bounds.push_back(LayerBounds(layer, subtree_aabb));
+
+	for (std::vector<GameObject*>::iterator child = childs.begin(); child != childs.end(); ++child)
+	{
+		subtree_aabb.Enclose((*child)->subtree_aabb);
+
+		const std::vector<LayerBounds>& child_bounds = (*child)->subtree_layer_bounds;
+		for (std::vector<LayerBounds>::const_iterator it = child_bounds.begin(); it != child_bounds.end(); ++it)
+		{
+			std::vector<LayerBounds>::iterator item = subtree_layer_bounds.begin();
+			while (item != subtree_layer_bounds.end() && item->layer < it->layer)
+				++item;
+
+			if (item != subtree_layer_bounds.end() && item->layer == it->layer)
+				item->bounds.Enclose(it->bounds);
+			else
+				subtree_layer_bounds.insert(item, *it);
+		}
+	}
+
+	bounds_dirty = false;
+}
+
 void GameObject::Save(Data & file, bool ignore_prefab) const
 {
 	Data data;
@@ -649,7 +820,6 @@ void GameObject::SaveAsChildPrefab(Data & file) const
 
 bool GameObject::RayCast(Ray raycast, RaycastHit & hit_OUT)
 {
-	RaycastHit hit_info;
 	bool ret = false;
 	ComponentMesh* c_mesh = (ComponentMesh*)GetComponent(C_MESH);
 	if (c_mesh)
@@ -660,36 +830,25 @@ bool GameObject::RayCast(Ray raycast, RaycastHit & hit_OUT)
 			//Transform ray into local coordinates
 			raycast.Transform(global_matrix->Inverted());
 
-			uint u1, u2, u3;
 			float distance;
 			vec hit_point;
 			Triangle triangle;
-			for (unsigned int i = 0; i < mesh->num_indices; i+=3)
+			ResourceFileMesh* rc_mesh = c_mesh->GetResource();
+			MeshBVH* bvh = (rc_mesh && rc_mesh->GetMesh() == mesh) ? rc_mesh->GetBVH() : nullptr;
+			if (bvh)
+				ret = bvh->RayCast(raycast, distance, hit_point, triangle);
+			else
+				ret = MeshBVH::RayCastBruteForce(mesh->vertices, mesh->indices, mesh->num_indices, raycast, distance, hit_point, triangle);
+
+			if (ret == true)
 			{
-				u1 = mesh->indices[i];
-				u2 = mesh->indices[i+1];
-				u3 = mesh->indices[i+2];
-				triangle = Triangle(float3(&mesh->vertices[u1 * 3]), float3(&mesh->vertices[u2 * 3]), float3(&mesh->vertices[u3 * 3]));
-				if (raycast.Intersects(triangle, &distance, &hit_point))
-				{
-					ret = true;
-					if (hit_info.distance > distance || hit_info.distance == 0)
-					{
-						hit_info.distance = distance;
-						hit_info.point = hit_point;
-						hit_info.normal = triangle.NormalCCW();
-					}
-				}
-				if (ret == true)
-				{
-					//Transfrom the hit parameters to global coordinates
-					hit_OUT.point = global_matrix->MulPos(hit_info.point);
-					hit_OUT.distance = hit_info.distance;
-					//hit_OUT.distance = ray.pos.Distance(hit.point);
-					hit_OUT.object = this;
-					hit_OUT.normal = global_matrix->MulDir(hit_info.normal); //TODO: normal needs revision. May not work as expected.
-					hit_OUT.normal.Normalize();
-				}
+				//Transfrom the hit parameters to global coordinates
+				hit_OUT.point = global_matrix->MulPos(hit_point);
+				hit_OUT.distance = distance;
+				//hit_OUT.distance = ray.pos.Distance(hit.point);
+				hit_OUT.object = this;
+				hit_OUT.normal = global_matrix->MulDir(triangle.NormalCCW()); //TODO: normal needs revision. May not work as expected.
+				hit_OUT.normal.Normalize();
 			}
 		}
 	}
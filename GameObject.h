@@ -4,6 +4,8 @@
 #include <vector>
 #include <string>
 #include "MathGeoLib\include\MathGeoLib.h"
+#include "SlotMap.h"
+#include "ComponentType.h"
 
 class Component;
 class ComponentTransform;
@@ -12,20 +14,37 @@ class RaycastHit;
 class Data;
 class ResourceFilePrefab;
 
-enum ComponentType;
 struct Mesh;
 
+class GameObject;
+typedef SlotHandle<GameObject> GameObjectHandle;
+
+//Bounds of the part of a subtree that is in one layer
+struct LayerBounds
+{
+	LayerBounds(int layer, const AABB& bounds) : layer(layer), bounds(bounds) {}
+	int layer;
+	AABB bounds;
+};
+
 class GameObject
 {
 public:
+	//GameObjects live in a generational slot map. new/delete keep working as usual.
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
+
+	//Safe reference: resolves to nullptr once the GameObject is deleted
+	GameObjectHandle GetHandle()const;
+	static GameObject* Get(const GameObjectHandle& handle);
+	static unsigned int Count();
 
 	GameObject();
 	GameObject(GameObject* parent);
 	GameObject(const char* name, unsigned int uuid, GameObject* parent, bool active, bool is_static, bool is_prefab, int layer, unsigned int prefab_root_uuid,const std::string& prefab_path);
 	~GameObject();
 
-	void PreUpdate();
-	void Update();
+	void RemovePendingComponents(); //Deletes the components queued by RemoveComponent
 
 	bool AddChild(GameObject* child);
 	bool RemoveChild(GameObject* child); //Breaks the link with the parent but does not delete the child.
@@ -40,8 +59,8 @@ public:
 	void OnStop();
 	void OnPause();
 
-	bool *GetActiveBoolean();
-	bool IsActive()const;
+	bool IsActiveSelf()const; //Own flag, ignoring the parents
+	bool IsActive()const; //Active through all the hierarchy
 	void SetActive(bool value);
 	void SetAllActive(bool value);
 	bool IsStatic()const;
@@ -50,13 +69,16 @@ public:
 	void SetAsPrefab(unsigned int root_uuid);
 	bool IsPrefab()const;
 
+	void SetLayer(int _layer);
 	void SetLayerChilds(int _layer);
 
 	Component* AddComponent(ComponentType type);
 	const std::vector<Component*>* GetComponents();
-	Component *GetComponent(ComponentType type) const;
+	Component *GetComponent(ComponentType type) const; //First component of that type
+	bool HasComponent(ComponentType type) const;
 	Component* GetComponentInChilds(ComponentType type) const;
 	void GetComponentsInChilds(ComponentType type, std::vector<Component*>& vector) const;
+	bool IsInSubtreeOf(const GameObject* go) const; //True if go is this GameObject or one of its ancestors
 
 	void RemoveComponent(Component* component);
 
@@ -65,6 +87,12 @@ public:
 
 	void TransformModified();
 
+	//Cached bounds of the whole subtree: mesh boxes, or the position of the GameObjects without mesh.
+	//Invalidated up to the root when something below changes and rebuilt on the next query, only through the dirty branches.
+	void InvalidateBounds();
+	const AABB& GetSubtreeAABB();
+	bool GetSubtreeAABB(const std::vector<int>& layers, AABB& aabb); //Only GameObjects of those layers. False if there are none.
+
 	void Save(Data& file, bool ignore_prefab = false) const;
 	void SaveAsChildPrefab(Data& file)const; //Only saves the UUID
 
@@ -75,11 +103,17 @@ public:
 	void RevertPrefabChanges();
 	void UnlinkPrefab();
 
+private:
+	void RefreshActiveInHierarchy();
+	void RefreshBounds();
+	void RefreshOwnBounds(); //Only this node, from the cache of its childs
+
 public:
+	//Mesh to draw this frame. Set by the mesh component every frame it updates, stale ones read as nullptr.
+	void SetMeshToDraw(Mesh* mesh);
+	Mesh* GetMeshToDraw()const;
 
 	std::string name;
-	//Filled the moment to draw. Do not use it elsewhere.
-	Mesh* mesh_to_draw = nullptr; //Pointer to the mesh to draw in one frame
 	ComponentTransform *transform = nullptr; // Direct access to Transform Component
 
 	AABB* bounding_box = nullptr; //Only mesh component can Set this.
@@ -95,11 +129,19 @@ private:
 	std::vector<GameObject*> childs;
 
 	bool active = true; // Represents the status of the GameObject, but not the activity trough its hierarchy. IsActive() gives its final activity
+	bool active_in_hierarchy = true; //Cached final activity. Refreshed down the subtree when the active flag or the parent changes.
 	bool is_static = false;
 	std::vector<Component*> components;
 	std::vector<Component*> components_to_remove;
+	Mesh* mesh_to_draw = nullptr;
+	unsigned int mesh_to_draw_frame = 0; //ModuleGOManager frame mesh_to_draw was set on
+	Component* component_slots[NUM_COMPONENT_TYPES] = { nullptr }; //First component of each type, for O(1) GetComponent
+	unsigned int component_mask = 0; //One bit per ComponentType present
 
 	float4x4* global_matrix = nullptr;
+	AABB subtree_aabb;
+	std::vector<LayerBounds> subtree_layer_bounds; //Sorted by layer, only the layers present in the subtree
+	bool bounds_dirty = true; //If set, all the ancestors are set too
 	bool is_prefab = false;
 	unsigned int uuid = 0;
 };
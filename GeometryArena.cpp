@@ -0,0 +1,309 @@
+#include "GeometryArena.h"
+#include "ComponentMesh.h"
+#include "MeshImporter.h"
+#include "Globals.h"
+
+#include "Glew\include\glew.h"
+#include <gl/GL.h>
+
+#include <algorithm>
+
+// ---- RangeAllocator -------------------------------------------------
+
+void RangeAllocator::Reset(unsigned int capacity, unsigned int used)
+{
+	this->capacity = capacity;
+	free_space = capacity - used;
+	free_blocks.clear();
+	if (free_space > 0)
+	{
+		Block block;
+		block.offset = used;
+		block.size = free_space;
+		free_blocks.push_back(block);
+	}
+}
+
+bool RangeAllocator::Allocate(unsigned int size, unsigned int & offset)
+{
+	for (std::vector<Block>::iterator it = free_blocks.begin(); it != free_blocks.end(); ++it)
+	{
+		if (it->size < size)
+			continue;
+
+		offset = it->offset;
+		it->offset += size;
+		it->size -= size;
+		if (it->size == 0)
+			free_blocks.erase(it);
+		free_space -= size;
+		return true;
+	}
+	return false;
+}
+
+void RangeAllocator::Free(unsigned int offset, unsigned int size)
+{
+	if (size == 0)
+		return;
+
+	//First block after the freed range
+	std::vector<Block>::iterator next = free_blocks.begin();
+	while (next != free_blocks.end() && next->offset < offset)
+		++next;
+
+	bool merge_prev = (next != free_blocks.begin() && (next - 1)->offset + (next - 1)->size == offset);
+	bool merge_next = (next != free_blocks.end() && offset + size == next->offset);
+
+	if (merge_prev && merge_next)
+	{
+		(next - 1)->size += size + next->size;
+		free_blocks.erase(next);
+	}
+	else if (merge_prev)
+		(next - 1)->size += size;
+	else if (merge_next)
+	{
+		next->offset = offset;
+		next->size += size;
+	}
+	else
+	{
+		Block block;
+		block.offset = offset;
+		block.size = size;
+		free_blocks.insert(next, block);
+	}
+	free_space += size;
+}
+
+unsigned int RangeAllocator::Capacity() const
+{
+	return capacity;
+}
+
+unsigned int RangeAllocator::FreeSpace() const
+{
+	return free_space;
+}
+
+unsigned int RangeAllocator::NumFreeBlocks() const
+{
+	return free_blocks.size();
+}
+
+// ---- GeometryArena --------------------------------------------------
+
+GeometryArena::GeometryArena()
+{}
+
+GeometryArena::~GeometryArena()
+{}
+
+bool GeometryArena::Add(Mesh * mesh)
+{
+	if (mesh == nullptr || mesh->in_arena || mesh->num_vertices == 0 || mesh->num_indices == 0 || mesh->num_vertices > 0xFFFF)
+		return false;
+
+	if (vao == 0)
+		Resize(std::max((unsigned int)GEOMETRY_ARENA_VERTICES, mesh->num_vertices), std::max((unsigned int)GEOMETRY_ARENA_INDICES, mesh->num_indices));
+
+	unsigned int vertex, index;
+	if (Allocate(mesh, vertex, index) == false)
+	{
+		//Packing the meshes may be enough, otherwise the buffers grow
+		unsigned int vertex_capacity = vertices.Capacity();
+		unsigned int index_capacity = indices.Capacity();
+		if (vertices.FreeSpace() < mesh->num_vertices)
+			vertex_capacity = std::max(vertex_capacity * 2, vertex_capacity + mesh->num_vertices);
+		if (indices.FreeSpace() < mesh->num_indices)
+			index_capacity = std::max(index_capacity * 2, index_capacity + mesh->num_indices);
+		Resize(vertex_capacity, index_capacity);
+
+		if (Allocate(mesh, vertex, index) == false)
+			return false;
+	}
+
+	std::vector<float> interleaved;
+	MeshImporter::InterleaveVertices(mesh, interleaved);
+	std::vector<GLushort> short_indices(mesh->indices, mesh->indices + mesh->num_indices);
+
+	//Copy targets, so the element buffer of the bound vertex array is not touched
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vertex_buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, vertex * MESH_VERTEX_STRIDE, mesh->num_vertices * MESH_VERTEX_STRIDE, interleaved.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, index_buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, index * sizeof(GLushort), mesh->num_indices * sizeof(GLushort), short_indices.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	mesh->in_arena = true;
+	mesh->base_vertex = vertex;
+	mesh->first_index = index;
+	mesh->index_size = sizeof(GLushort);
+	mesh->id_vao = vao;
+	meshes.push_back(mesh);
+	return true;
+}
+
+void GeometryArena::Remove(Mesh * mesh)
+{
+	if (mesh == nullptr || mesh->in_arena == false)
+		return;
+
+	std::vector<Mesh*>::iterator it = std::find(meshes.begin(), meshes.end(), mesh);
+	if (it != meshes.end())
+	{
+		*it = meshes.back();
+		meshes.pop_back();
+	}
+
+	vertices.Free(mesh->base_vertex, mesh->num_vertices);
+	indices.Free(mesh->first_index, mesh->num_indices);
+	mesh->in_arena = false;
+	mesh->base_vertex = mesh->first_index = 0;
+	mesh->id_vao = 0;
+
+	if (vertices.NumFreeBlocks() > GEOMETRY_ARENA_MAX_FREE_BLOCKS || indices.NumFreeBlocks() > GEOMETRY_ARENA_MAX_FREE_BLOCKS)
+		fragmented = true;
+}
+
+void GeometryArena::Update()
+{
+	//A scene change removes many meshes at once. Packing them once afterwards is enough.
+	if (fragmented)
+		Defragment();
+}
+
+void GeometryArena::Defragment()
+{
+	if (vao != 0)
+		Resize(vertices.Capacity(), indices.Capacity());
+	fragmented = false;
+}
+
+void GeometryArena::CleanUp()
+{
+	for (std::vector<Mesh*>::iterator it = meshes.begin(); it != meshes.end(); ++it)
+	{
+		(*it)->in_arena = false;
+		(*it)->base_vertex = (*it)->first_index = 0;
+		(*it)->id_vao = 0;
+	}
+	meshes.clear();
+
+	if (vao != 0)
+		glDeleteVertexArrays(1, &vao);
+	if (vertex_buffer != 0)
+		glDeleteBuffers(1, &vertex_buffer);
+	if (index_buffer != 0)
+		glDeleteBuffers(1, &index_buffer);
+	vao = vertex_buffer = index_buffer = 0;
+	vertices.Reset(0);
+	indices.Reset(0);
+	fragmented = false;
+}
+
+unsigned int GeometryArena::GetVertexArray() const
+{
+	return vao;
+}
+
+unsigned int GeometryArena::NumMeshes() const
+{
+	return meshes.size();
+}
+
+const RangeAllocator & GeometryArena::GetVertexRanges() const
+{
+	return vertices;
+}
+
+const RangeAllocator & GeometryArena::GetIndexRanges() const
+{
+	return indices;
+}
+
+bool GeometryArena::Allocate(const Mesh * mesh, unsigned int & vertex, unsigned int & index)
+{
+	if (vertices.Allocate(mesh->num_vertices, vertex) == false)
+		return false;
+	if (indices.Allocate(mesh->num_indices, index) == false)
+	{
+		vertices.Free(vertex, mesh->num_vertices);
+		return false;
+	}
+	return true;
+}
+
+void GeometryArena::Resize(unsigned int vertex_capacity, unsigned int index_capacity)
+{
+	unsigned int new_vertex_buffer, new_index_buffer;
+	glGenBuffers(1, &new_vertex_buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, new_vertex_buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, vertex_capacity * MESH_VERTEX_STRIDE, nullptr, GL_STATIC_DRAW);
+
+	//Vertices of every mesh one after the other, in the order they were added
+	unsigned int vertex_cursor = 0;
+	if (vertex_buffer != 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, vertex_buffer);
+		for (std::vector<Mesh*>::iterator it = meshes.begin(); it != meshes.end(); ++it)
+		{
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (*it)->base_vertex * MESH_VERTEX_STRIDE, vertex_cursor * MESH_VERTEX_STRIDE, (*it)->num_vertices * MESH_VERTEX_STRIDE);
+			vertex_cursor += (*it)->num_vertices;
+		}
+	}
+
+	glGenBuffers(1, &new_index_buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, new_index_buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, index_capacity * sizeof(GLushort), nullptr, GL_STATIC_DRAW);
+
+	//Indices are relative to base_vertex, they are copied as they are
+	unsigned int index_cursor = 0;
+	if (index_buffer != 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, index_buffer);
+		for (std::vector<Mesh*>::iterator it = meshes.begin(); it != meshes.end(); ++it)
+		{
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (*it)->first_index * sizeof(GLushort), index_cursor * sizeof(GLushort), (*it)->num_indices * sizeof(GLushort));
+			index_cursor += (*it)->num_indices;
+		}
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	vertex_cursor = index_cursor = 0;
+	for (std::vector<Mesh*>::iterator it = meshes.begin(); it != meshes.end(); ++it)
+	{
+		(*it)->base_vertex = vertex_cursor;
+		(*it)->first_index = index_cursor;
+		vertex_cursor += (*it)->num_vertices;
+		index_cursor += (*it)->num_indices;
+	}
+	vertices.Reset(vertex_capacity, vertex_cursor);
+	indices.Reset(index_capacity, index_cursor);
+
+	if (vertex_buffer != 0)
+		glDeleteBuffers(1, &vertex_buffer);
+	if (index_buffer != 0)
+		glDeleteBuffers(1, &index_buffer);
+	vertex_buffer = new_vertex_buffer;
+	index_buffer = new_index_buffer;
+
+	//Vertices == 0, uvs == 1, normals == 2, tangents == 3, like MeshImporter::LoadBuffers
+	if (vao == 0)
+		glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)MESH_UV_OFFSET);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)MESH_NORMAL_OFFSET);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)MESH_TANGENT_OFFSET);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	glBindVertexArray(0);
+
+	LOG("Geometry arena: %u meshes packed in %u vertices and %u indices", meshes.size(), vertex_capacity, index_capacity);
+}
@@ -0,0 +1,76 @@
+#ifndef __GEOMETRY_ARENA_H__
+#define __GEOMETRY_ARENA_H__
+
+#include <vector>
+
+#define GEOMETRY_ARENA_VERTICES (1 << 18) //Initial capacity, in vertices
+#define GEOMETRY_ARENA_INDICES (3 << 18) //Initial capacity, in indices
+#define GEOMETRY_ARENA_MAX_FREE_BLOCKS 32 //More free blocks than this after a removal and the arena is defragmented
+
+struct Mesh;
+
+//First fit free list over a range of elements. Free blocks are kept sorted by offset and merged with their neighbours.
+class RangeAllocator
+{
+public:
+	void Reset(unsigned int capacity, unsigned int used = 0); //Everything from used on is free
+	bool Allocate(unsigned int size, unsigned int& offset);
+	void Free(unsigned int offset, unsigned int size);
+
+	unsigned int Capacity()const;
+	unsigned int FreeSpace()const;
+	unsigned int NumFreeBlocks()const;
+
+private:
+	struct Block
+	{
+		unsigned int offset;
+		unsigned int size;
+	};
+
+	std::vector<Block> free_blocks;
+	unsigned int capacity = 0;
+	unsigned int free_space = 0;
+};
+
+/*
+	Shared GPU storage of the static meshes: one interleaved vertex buffer (MESH_VERTEX_STRIDE) and one 16 bit index buffer,
+	sub-allocated with a RangeAllocator each and captured in a single vertex array.
+	Meshes in the arena only differ by base_vertex and first_index, so they can be drawn together with one multi draw.
+	Meshes with more than 65535 vertices don't fit in 16 bit indices and are left out.
+	When an allocation doesn't fit, the meshes are packed into new buffers, twice as big if the free space is not enough.
+	Removals leave holes. Update() packs the meshes again once there are too many of them.
+	Buffers are created on the first Add(), so it needs the GL context like MeshImporter::LoadBuffers.
+*/
+class GeometryArena
+{
+public:
+	GeometryArena();
+	~GeometryArena();
+
+	bool Add(Mesh* mesh); //Uploads the mesh. False if the mesh can't be in the arena, it needs its own buffers then.
+	void Remove(Mesh* mesh);
+	void Update(); //Defragments when needed. Call it outside of the rendering, it moves the meshes.
+	void Defragment();
+	void CleanUp();
+
+	unsigned int GetVertexArray()const;
+	unsigned int NumMeshes()const;
+	const RangeAllocator& GetVertexRanges()const;
+	const RangeAllocator& GetIndexRanges()const;
+
+private:
+	bool Allocate(const Mesh* mesh, unsigned int& vertex, unsigned int& index);
+	void Resize(unsigned int vertex_capacity, unsigned int index_capacity); //Packs the meshes at the start of new buffers
+
+private:
+	unsigned int vao = 0;
+	unsigned int vertex_buffer = 0;
+	unsigned int index_buffer = 0;
+	RangeAllocator vertices;
+	RangeAllocator indices;
+	std::vector<Mesh*> meshes;
+	bool fragmented = false;
+};
+
+#endif // !__GEOMETRY_ARENA_H__
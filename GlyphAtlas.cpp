@@ -0,0 +1,154 @@
+#include "GlyphAtlas.h"
+#include "Globals.h"
+
+#include "Glew\include\glew.h"
+#include <gl/GL.h>
+
+#include <algorithm>
+#include <string.h>
+
+std::map<std::string, GlyphAtlas*> GlyphAtlas::atlases;
+
+GlyphAtlas::GlyphAtlas()
+{}
+
+GlyphAtlas::~GlyphAtlas()
+{
+	if (texture != 0)
+		glDeleteTextures(1, &texture);
+}
+
+GlyphAtlas * GlyphAtlas::Acquire(const std::string & font_key, const std::vector<unsigned int>& textures)
+{
+	std::map<std::string, GlyphAtlas*>::iterator it = atlases.find(font_key);
+	if (it != atlases.end())
+	{
+		++it->second->references;
+		return it->second;
+	}
+
+	GlyphAtlas* atlas = new GlyphAtlas();
+	atlas->key = font_key;
+	atlas->references = 1;
+	atlas->Build(textures);
+	atlases[font_key] = atlas;
+	return atlas;
+}
+
+void GlyphAtlas::Release(GlyphAtlas * atlas)
+{
+	if (atlas == nullptr || --atlas->references > 0)
+		return;
+
+	atlases.erase(atlas->key);
+	delete atlas;
+}
+
+unsigned int GlyphAtlas::GetTexture() const
+{
+	return texture;
+}
+
+unsigned int GlyphAtlas::NumGlyphs() const
+{
+	return glyphs.size();
+}
+
+const GlyphRect & GlyphAtlas::GetGlyph(unsigned int index) const
+{
+	return glyphs[index];
+}
+
+void GlyphAtlas::Build(const std::vector<unsigned int>& textures)
+{
+	unsigned int num_glyphs = textures.size();
+	glyphs.resize(num_glyphs);
+
+	//Read back the texels of every glyph
+	std::vector<std::vector<unsigned char>> pixels(num_glyphs);
+	unsigned int area = 0, max_width = 0;
+	for (unsigned int i = 0; i < num_glyphs; i++)
+	{
+		if (textures[i] == 0)
+			continue;
+
+		GLint width = 0, height = 0;
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+		if (width <= 0 || height <= 0)
+			continue;
+
+		pixels[i].resize(width * height * 4);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels[i].data());
+		glyphs[i].width = (float)width;
+		glyphs[i].height = (float)height;
+		area += (width + 2 * GLYPH_ATLAS_PADDING) * (height + 2 * GLYPH_ATLAS_PADDING);
+		max_width = std::max(max_width, (unsigned int)width + 2 * GLYPH_ATLAS_PADDING);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	//Square-ish atlas, never narrower than the widest glyph
+	unsigned int atlas_width = 1;
+	while (atlas_width * atlas_width < area || atlas_width < max_width)
+		atlas_width <<= 1;
+
+	//Rows of glyphs, tallest first so each row wastes little height
+	std::vector<unsigned int> order(num_glyphs);
+	for (unsigned int i = 0; i < num_glyphs; i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) { return glyphs[a].height > glyphs[b].height; });
+
+	std::vector<unsigned int> glyph_x(num_glyphs, 0), glyph_y(num_glyphs, 0);
+	unsigned int x = 0, y = 0, row_height = 0;
+	for (std::vector<unsigned int>::const_iterator it = order.begin(); it != order.end(); ++it)
+	{
+		if (pixels[*it].empty())
+			continue;
+
+		unsigned int cell_width = (unsigned int)glyphs[*it].width + 2 * GLYPH_ATLAS_PADDING;
+		unsigned int cell_height = (unsigned int)glyphs[*it].height + 2 * GLYPH_ATLAS_PADDING;
+		if (x + cell_width > atlas_width)
+		{
+			y += row_height;
+			x = row_height = 0;
+		}
+		glyph_x[*it] = x + GLYPH_ATLAS_PADDING;
+		glyph_y[*it] = y + GLYPH_ATLAS_PADDING;
+		x += cell_width;
+		row_height = std::max(row_height, cell_height);
+	}
+
+	unsigned int atlas_height = 1;
+	while (atlas_height < y + row_height)
+		atlas_height <<= 1;
+
+	//Glyph rows are copied as they are, so uv (0, 0) of a glyph is its first texel in the atlas too
+	std::vector<unsigned char> atlas_pixels(atlas_width * atlas_height * 4, 0);
+	for (unsigned int i = 0; i < num_glyphs; i++)
+	{
+		if (pixels[i].empty())
+			continue;
+
+		unsigned int width = (unsigned int)glyphs[i].width;
+		unsigned int height = (unsigned int)glyphs[i].height;
+		for (unsigned int row = 0; row < height; row++)
+			memcpy(&atlas_pixels[((glyph_y[i] + row) * atlas_width + glyph_x[i]) * 4], &pixels[i][row * width * 4], width * 4);
+
+		glyphs[i].u0 = (float)glyph_x[i] / atlas_width;
+		glyphs[i].v0 = (float)glyph_y[i] / atlas_height;
+		glyphs[i].u1 = (float)(glyph_x[i] + width) / atlas_width;
+		glyphs[i].v1 = (float)(glyph_y[i] + height) / atlas_height;
+	}
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas_width, atlas_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas_pixels.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	LOG("Glyph atlas: %u glyphs in %ux%u", num_glyphs, atlas_width, atlas_height);
+}
@@ -0,0 +1,48 @@
+#ifndef __GLYPH_ATLAS_H__
+#define __GLYPH_ATLAS_H__
+
+#include <vector>
+#include <string>
+#include <map>
+
+#define GLYPH_ATLAS_PADDING 1 //Empty texels around each glyph, so filtering doesn't bleed the neighbours
+
+struct GlyphRect
+{
+	float u0 = 0.0f, v0 = 0.0f; //Atlas coordinates of the uv (0, 0) of the glyph texture
+	float u1 = 0.0f, v1 = 0.0f; //Atlas coordinates of the uv (1, 1)
+	float width = 0.0f, height = 0.0f; //In pixels, the size of the glyph texture
+};
+
+/*
+	Every glyph texture of a font packed in one texture, so a text is drawn without texture changes.
+	The glyphs are read back from their textures and packed in rows, tallest first.
+	A font is identified by the paths of its glyph textures: Acquire() bakes the atlas the first time and shares it
+	with the next texts that use the same font. Needs the GL context.
+*/
+class GlyphAtlas
+{
+public:
+	static GlyphAtlas* Acquire(const std::string& font_key, const std::vector<unsigned int>& textures); //textures[i] is glyph i
+	static void Release(GlyphAtlas* atlas);
+
+	unsigned int GetTexture()const;
+	unsigned int NumGlyphs()const;
+	const GlyphRect& GetGlyph(unsigned int index)const;
+
+private:
+	GlyphAtlas();
+	~GlyphAtlas();
+
+	void Build(const std::vector<unsigned int>& textures);
+
+private:
+	unsigned int texture = 0;
+	std::vector<GlyphRect> glyphs;
+	std::string key;
+	unsigned int references = 0;
+
+	static std::map<std::string, GlyphAtlas*> atlases;
+};
+
+#endif // !__GLYPH_ATLAS_H__
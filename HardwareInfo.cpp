@@ -2,6 +2,8 @@
 #include "SDL\include\SDL.h"
 #include <string>
 #include "Globals.h"
+#include "Application.h"
+#include "JobSystem.h"
 
 using namespace std;
 
@@ -23,6 +25,9 @@ void HardwareInfo::Draw()
 	ImGui::Text("CPUs: "); 
 	ImGui::SameLine(); ImGui::TextColored(TEXT_COLORED, "%d (Cache: %dkb)", SDL_GetCPUCount(), SDL_GetCPUCacheLineSize());
 	
+	ImGui::Text("Job workers: ");
+	ImGui::SameLine(); ImGui::TextColored(TEXT_COLORED, "%u (Physical cores: %u)", App->job_system->NumWorkers(), App->job_system->NumPhysicalCores());
+
 	ImGui::Text("System RAM: ");
 	ImGui::SameLine(); ImGui::TextColored(TEXT_COLORED, "%.2fG", (float)SDL_GetSystemRAM()/1000);
 
@@ -37,10 +37,10 @@ void Inspector::Draw()
 	if (selected_GO)
 	{
 		//Active
-		bool *is_active = selected_GO->GetActiveBoolean();
-		if (ImGui::Checkbox("", is_active))
-			selected_GO->SetActive(*is_active);
-		if (debug && ImGui::Checkbox("SetAllActive", is_active))
+		bool is_active = selected_GO->IsActiveSelf();
+		if (ImGui::Checkbox("", &is_active))
+			selected_GO->SetActive(is_active);
+		if (debug && ImGui::Checkbox("SetAllActive", &is_active))
 			selected_GO->SetAllActive(is_active);
 		//Name
 		ImGui::SameLine();
@@ -84,7 +84,10 @@ void Inspector::Draw()
 		}
 
 		ImGui::Separator();
-		App->go_manager->layer_system->DisplayLayerSelector(selected_GO->layer);
+		int layer = selected_GO->layer;
+		App->go_manager->layer_system->DisplayLayerSelector(layer);
+		if (layer != selected_GO->layer)
+			selected_GO->SetLayer(layer);
 
 		if (debug)
 		{
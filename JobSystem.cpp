@@ -0,0 +1,282 @@
+#include "JobSystem.h"
+#include "Globals.h"
+
+#include "Brofiler/include/Brofiler.h"
+
+//Index of the calling thread in JobSystem::threads. The main thread is 0.
+static thread_local unsigned int thread_index = 0;
+
+JobSystem::JobSystem()
+{
+	pending_jobs = 0;
+	quit = false;
+}
+
+JobSystem::~JobSystem()
+{
+	CleanUp();
+}
+
+void JobSystem::Init()
+{
+	DetectTopology();
+
+	//One thread per physical core. The main thread takes one of them.
+	unsigned int num_workers = (physical_cores > 1) ? physical_cores - 1 : 1;
+	if (num_workers > JOB_SYSTEM_MAX_WORKERS)
+		num_workers = JOB_SYSTEM_MAX_WORKERS;
+
+	LOG("Job system: %u physical cores, %u logical cores. Starting %u workers.", physical_cores, logical_cores, num_workers);
+
+	quit = false;
+	for (unsigned int i = 0; i <= num_workers; i++)
+	{
+		ThreadData* data = new ThreadData();
+		data->jobs = new Job[JOB_SYSTEM_MAX_JOBS];
+		threads.push_back(data);
+	}
+
+	worker_names.reserve(num_workers);
+	for (unsigned int i = 1; i <= num_workers; i++)
+	{
+		worker_names.push_back("Worker " + std::to_string(i));
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+void JobSystem::CleanUp()
+{
+	if (threads.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		quit = true;
+	}
+	sleep_condition.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+	worker_names.clear();
+
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		delete[] threads[i]->jobs;
+		delete threads[i];
+	}
+	threads.clear();
+	pending_jobs = 0;
+}
+
+void JobSystem::DetectTopology()
+{
+	logical_cores = std::thread::hardware_concurrency();
+	if (logical_cores == 0)
+		logical_cores = 1;
+	physical_cores = logical_cores;
+
+	DWORD length = 0;
+	GetLogicalProcessorInformation(nullptr, &length);
+	if (length == 0)
+		return;
+
+	std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+	if (GetLogicalProcessorInformation(info.data(), &length) == FALSE)
+		return;
+
+	unsigned int cores = 0;
+	for (size_t i = 0; i < info.size(); i++)
+		if (info[i].Relationship == RelationProcessorCore)
+			++cores;
+
+	if (cores > 0)
+		physical_cores = cores;
+}
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+	thread_index = index;
+	BROFILER_THREAD(worker_names[index - 1].c_str())
+
+	while (true)
+	{
+		Job* job = GetJob();
+		if (job)
+		{
+			Execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		sleep_condition.wait(lock, [this]() { return quit || pending_jobs > 0; });
+		if (quit)
+			break;
+	}
+}
+
+Job* JobSystem::AllocateJob()
+{
+	ThreadData* data = threads[thread_index];
+	Job* job = &data->jobs[data->allocated++ & (JOB_SYSTEM_MAX_JOBS - 1)];
+	return job;
+}
+
+Job* JobSystem::CreateJob(const char* name, const JobFunction& function, Job* parent)
+{
+	if (parent)
+		++parent->unfinished;
+
+	Job* job = AllocateJob();
+	job->function = function;
+	job->parent = parent;
+	job->unfinished = 1;
+	job->name = name;
+	return job;
+}
+
+void JobSystem::Run(Job* job)
+{
+	WorkQueue& queue = threads[thread_index]->queue;
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+
+	++pending_jobs;
+	{
+		//Pairs with the predicate check of the sleeping workers so the wake up is never lost
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+	}
+	sleep_condition.notify_one();
+}
+
+void JobSystem::Wait(const Job* job)
+{
+	while (!IsFinished(job))
+	{
+		Job* other = GetJob();
+		if (other)
+			Execute(other);
+		else
+			std::this_thread::yield();
+	}
+}
+
+bool JobSystem::IsFinished(const Job* job) const
+{
+	return job->unfinished <= 0;
+}
+
+void JobSystem::ParallelFor(const char* name, unsigned int count, unsigned int batch_size, const JobRangeFunction& function)
+{
+	if (count == 0)
+		return;
+	if (batch_size == 0)
+		batch_size = 1;
+
+	//A single batch is not worth the scheduling
+	if (count <= batch_size || threads.size() <= 1)
+	{
+		function(0, count);
+		return;
+	}
+
+	Job* root = CreateJob(name, nullptr);
+	for (unsigned int begin = 0; begin < count; begin += batch_size)
+	{
+		unsigned int end = (begin + batch_size < count) ? begin + batch_size : count;
+		Run(CreateJob(name, [&function, begin, end]() { function(begin, end); }, root));
+	}
+	Run(root);
+	Wait(root);
+}
+
+unsigned int JobSystem::NumWorkers() const
+{
+	return workers.size();
+}
+
+unsigned int JobSystem::NumThreads() const
+{
+	return workers.size() + 1;
+}
+
+unsigned int JobSystem::NumPhysicalCores() const
+{
+	return physical_cores;
+}
+
+unsigned int JobSystem::NumLogicalCores() const
+{
+	return logical_cores;
+}
+
+Job* JobSystem::GetJob()
+{
+	if (threads.empty())
+		return nullptr;
+
+	//Own queue first, newest job (its data is still in cache)
+	WorkQueue& own = threads[thread_index]->queue;
+	{
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty())
+		{
+			Job* job = own.jobs.back();
+			own.jobs.pop_back();
+			--pending_jobs;
+			return job;
+		}
+	}
+
+	//Steal the oldest job from the others
+	unsigned int num_threads = threads.size();
+	for (unsigned int i = 1; i < num_threads; i++)
+	{
+		WorkQueue& victim = threads[(thread_index + i) % num_threads]->queue;
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			Job* job = victim.jobs.front();
+			victim.jobs.pop_front();
+			--pending_jobs;
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+void JobSystem::Execute(Job* job)
+{
+	if (job->function)
+	{
+#if USE_PROFILER
+		if (job->name)
+		{
+			std::map<const char*, void*>& descriptions = threads[thread_index]->descriptions;
+			std::map<const char*, void*>::iterator description = descriptions.find(job->name);
+			if (description == descriptions.end())
+			{
+				std::lock_guard<std::mutex> lock(description_mutex);
+				description = descriptions.insert(std::pair<const char*, void*>(job->name, Profiler::EventDescription::Create(job->name, __FILE__, __LINE__, Profiler::Color::Orange))).first;
+			}
+			Profiler::Category category(*(Profiler::EventDescription*)description->second);
+			job->function();
+		}
+		else
+			job->function();
+#else
+		job->function();
+#endif
+	}
+
+	Finish(job);
+}
+
+void JobSystem::Finish(Job* job)
+{
+	if (--job->unfinished == 0 && job->parent)
+		Finish(job->parent);
+}
@@ -0,0 +1,96 @@
+#ifndef __JOB_SYSTEM_H__
+#define __JOB_SYSTEM_H__
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define JOB_SYSTEM_MAX_JOBS 4096 //Jobs per thread. Must be a power of two.
+#define JOB_SYSTEM_MAX_WORKERS 31
+
+typedef std::function<void()> JobFunction;
+typedef std::function<void(unsigned int begin, unsigned int end)> JobRangeFunction;
+
+struct Job
+{
+	JobFunction function;
+	Job* parent = nullptr;
+	std::atomic<int> unfinished; //Itself + children still running
+	const char* name = nullptr; //Profiler scope. Must be a string literal.
+};
+
+/*
+	Work-stealing thread pool owned by the Application.
+	Every thread (main included) has its own queue. A thread pops its own jobs LIFO and steals from the others FIFO.
+	Jobs are taken from a per-thread ring of JOB_SYSTEM_MAX_JOBS, so a Job* is only valid until that many more jobs are created on the same thread.
+	Jobs can only be created and waited from the main thread or from inside other jobs.
+*/
+class JobSystem
+{
+public:
+	JobSystem();
+	~JobSystem();
+
+	void Init();
+	void CleanUp();
+
+	//Creating a child of a running job makes Wait(parent) wait for the child too
+	Job* CreateJob(const char* name, const JobFunction& function, Job* parent = nullptr);
+	void Run(Job* job);
+	//Runs other jobs while the job (and its children) are not finished
+	void Wait(const Job* job);
+	bool IsFinished(const Job* job)const;
+
+	//Splits [0, count) in ranges of batch_size and runs them in parallel. Returns when every range is done.
+	void ParallelFor(const char* name, unsigned int count, unsigned int batch_size, const JobRangeFunction& function);
+
+	unsigned int NumWorkers()const;
+	unsigned int NumThreads()const; //Workers + main thread
+	unsigned int NumPhysicalCores()const;
+	unsigned int NumLogicalCores()const;
+
+private:
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Job*> jobs;
+	};
+
+	struct ThreadData
+	{
+		WorkQueue queue;
+		Job* jobs = nullptr;
+		unsigned int allocated = 0;
+		std::map<const char*, void*> descriptions; //Profiler event description by job name. Only used by its own thread.
+	};
+
+	void DetectTopology();
+	void WorkerLoop(unsigned int index);
+
+	Job* AllocateJob();
+	Job* GetJob();
+	void Execute(Job* job);
+	void Finish(Job* job);
+
+private:
+	unsigned int physical_cores = 1;
+	unsigned int logical_cores = 1;
+
+	std::vector<std::thread> workers;
+	std::vector<std::string> worker_names;
+	std::vector<ThreadData*> threads; //0 is the main thread
+
+	std::atomic<int> pending_jobs;
+	std::atomic<bool> quit;
+	std::mutex sleep_mutex;
+	std::condition_variable sleep_condition;
+	std::mutex description_mutex;
+};
+
+#endif // !__JOB_SYSTEM_H__
@@ -58,6 +58,7 @@ void Material::AddUniform(const std::string& name, UniformType type, char* value
 	}
 
 	uniforms.push_back(uni);
+	++uniforms_version;
 }
 
 bool Material::Save(const char * path) const
@@ -279,6 +280,7 @@ void Material::CleanUp()
 		delete *it;
 
 	uniforms.clear();
+	++uniforms_version;
 	uuid = 0;
 }
 
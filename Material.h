@@ -41,6 +41,7 @@ public:
 	std::string vertex_path;
 	std::string fragment_path;
 	std::vector<Uniform*> uniforms;
+	uint uniforms_version = 0; //Increase it whenever uniforms are added or removed
 	uint uuid = 0;
 	
 	bool has_color = false;
@@ -345,6 +345,7 @@ void MaterialCreatorWindow::PrintUniforms()
 	{
 		delete *it;
 		material.uniforms.erase(std::find(material.uniforms.begin(), material.uniforms.end(), *it));
+		++material.uniforms_version;
 	}
 }
 
@@ -0,0 +1,332 @@
+#include "MeshBVH.h"
+
+using namespace math;
+
+MeshBVH::MeshBVH()
+{}
+
+MeshBVH::~MeshBVH()
+{}
+
+void MeshBVH::Build(const float * vertices, const unsigned int * indices, unsigned int num_indices)
+{
+	nodes.clear();
+	triangles.clear();
+
+	unsigned int num_triangles = num_indices / 3;
+	if (vertices == nullptr || indices == nullptr || num_triangles == 0)
+		return;
+
+	std::vector<float3> centroids;
+	std::vector<AABB> boxes;
+	triangles.reserve(num_triangles);
+	centroids.reserve(num_triangles);
+	boxes.reserve(num_triangles);
+
+	for (unsigned int i = 0; i < num_indices; i += 3)
+	{
+		Triangle tri(float3(&vertices[indices[i] * 3]), float3(&vertices[indices[i + 1] * 3]), float3(&vertices[indices[i + 2] * 3]));
+		triangles.push_back(tri);
+		centroids.push_back(tri.Centroid());
+		boxes.push_back(tri.BoundingAABB());
+	}
+
+	nodes.reserve(num_triangles * 2);
+	MeshBVHNode root;
+	root.first = 0;
+	root.count = num_triangles;
+	nodes.push_back(root);
+
+	UpdateBounds(0, boxes);
+	Subdivide(0, 0, centroids, boxes);
+}
+
+void MeshBVH::UpdateBounds(unsigned int node_index, const std::vector<AABB>& boxes)
+{
+	MeshBVHNode& node = nodes[node_index];
+	node.box.SetNegativeInfinity();
+	for (unsigned int i = node.first; i < node.first + node.count; i++)
+		node.box.Enclose(boxes[i]);
+}
+
+void MeshBVH::Subdivide(unsigned int node_index, unsigned int depth, std::vector<float3>& centroids, std::vector<AABB>& boxes)
+{
+	unsigned int first = nodes[node_index].first;
+	unsigned int count = nodes[node_index].count;
+
+	if (count <= MESH_BVH_LEAF_TRIANGLES || depth >= MESH_BVH_MAX_DEPTH)
+		return;
+
+	AABB centroid_bounds;
+	centroid_bounds.SetNegativeInfinity();
+	for (unsigned int i = first; i < first + count; i++)
+		centroid_bounds.Enclose(centroids[i]);
+
+	//Binned SAH: find the best split plane over the three axis
+	int best_axis = -1;
+	unsigned int best_split = 0;
+	float best_cost = count * nodes[node_index].box.SurfaceArea();
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float axis_min = centroid_bounds.minPoint[axis];
+		float axis_extent = centroid_bounds.maxPoint[axis] - axis_min;
+		if (axis_extent <= 0.0f)
+			continue;
+
+		AABB bin_boxes[MESH_BVH_SAH_BINS];
+		unsigned int bin_counts[MESH_BVH_SAH_BINS] = { 0 };
+		for (int b = 0; b < MESH_BVH_SAH_BINS; b++)
+			bin_boxes[b].SetNegativeInfinity();
+
+		float scale = MESH_BVH_SAH_BINS / axis_extent;
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			int b = Min((int)((centroids[i][axis] - axis_min) * scale), MESH_BVH_SAH_BINS - 1);
+			bin_boxes[b].Enclose(boxes[i]);
+			bin_counts[b]++;
+		}
+
+		//Sweep from both sides to get the cost of every split plane
+		float left_area[MESH_BVH_SAH_BINS - 1];
+		unsigned int left_count[MESH_BVH_SAH_BINS - 1];
+		AABB acc;
+		acc.SetNegativeInfinity();
+		unsigned int acc_count = 0;
+		for (int b = 0; b < MESH_BVH_SAH_BINS - 1; b++)
+		{
+			acc_count += bin_counts[b];
+			if (bin_counts[b] > 0)
+				acc.Enclose(bin_boxes[b]);
+			left_count[b] = acc_count;
+			left_area[b] = (acc_count > 0) ? acc.SurfaceArea() : 0.0f;
+		}
+
+		acc.SetNegativeInfinity();
+		acc_count = 0;
+		for (int b = MESH_BVH_SAH_BINS - 1; b > 0; b--)
+		{
+			acc_count += bin_counts[b];
+			if (bin_counts[b] > 0)
+				acc.Enclose(bin_boxes[b]);
+			if (left_count[b - 1] == 0 || acc_count == 0)
+				continue;
+
+			float cost = left_count[b - 1] * left_area[b - 1] + acc_count * acc.SurfaceArea();
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_axis = axis;
+				best_split = b;
+			}
+		}
+	}
+
+	if (best_axis == -1) //Splitting is not cheaper than keeping the leaf
+		return;
+
+	//Partition the triangles in place
+	float axis_min = centroid_bounds.minPoint[best_axis];
+	float scale = MESH_BVH_SAH_BINS / (centroid_bounds.maxPoint[best_axis] - axis_min);
+	unsigned int i = first;
+	unsigned int j = first + count;
+	while (i < j)
+	{
+		int b = Min((int)((centroids[i][best_axis] - axis_min) * scale), MESH_BVH_SAH_BINS - 1);
+		if ((unsigned int)b < best_split)
+			++i;
+		else
+		{
+			--j;
+			std::swap(triangles[i], triangles[j]);
+			std::swap(centroids[i], centroids[j]);
+			std::swap(boxes[i], boxes[j]);
+		}
+	}
+
+	unsigned int left_count = i - first;
+	if (left_count == 0 || left_count == count)
+		return;
+
+	unsigned int left = nodes.size();
+	MeshBVHNode child;
+	child.first = first;
+	child.count = left_count;
+	nodes.push_back(child);
+	child.first = i;
+	child.count = count - left_count;
+	nodes.push_back(child);
+
+	nodes[node_index].first = left;
+	nodes[node_index].count = 0;
+
+	UpdateBounds(left, boxes);
+	UpdateBounds(left + 1, boxes);
+	Subdivide(left, depth + 1, centroids, boxes);
+	Subdivide(left + 1, depth + 1, centroids, boxes);
+}
+
+bool MeshBVH::IntersectBox(const AABB & box, const float3 & origin, const float3 & inv_dir, float max_distance, float & t_near)
+{
+	float tx1 = (box.minPoint.x - origin.x) * inv_dir.x;
+	float tx2 = (box.maxPoint.x - origin.x) * inv_dir.x;
+	float t_min = Min(tx1, tx2);
+	float t_max = Max(tx1, tx2);
+
+	float ty1 = (box.minPoint.y - origin.y) * inv_dir.y;
+	float ty2 = (box.maxPoint.y - origin.y) * inv_dir.y;
+	t_min = Max(t_min, Min(ty1, ty2));
+	t_max = Min(t_max, Max(ty1, ty2));
+
+	float tz1 = (box.minPoint.z - origin.z) * inv_dir.z;
+	float tz2 = (box.maxPoint.z - origin.z) * inv_dir.z;
+	t_min = Max(t_min, Min(tz1, tz2));
+	t_max = Min(t_max, Max(tz1, tz2));
+
+	t_near = t_min;
+	return t_max >= Max(t_min, 0.0f) && t_min <= max_distance;
+}
+
+bool MeshBVH::RayCast(const Ray & ray, float & distance, float3 & hit_point, Triangle & triangle) const
+{
+	if (nodes.empty())
+		return false;
+
+	float3 inv_dir(1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z);
+	float best_distance = FLOAT_INF;
+	bool hit = false;
+
+	float t_near;
+	if (!IntersectBox(nodes[0].box, ray.pos, inv_dir, best_distance, t_near))
+		return false;
+
+	//Each level pushes at most one node and the depth is limited on build
+	unsigned int stack[MESH_BVH_MAX_DEPTH + 2];
+	float stack_distance[MESH_BVH_MAX_DEPTH + 2];
+	int stack_size = 0;
+	stack[stack_size] = 0;
+	stack_distance[stack_size++] = t_near;
+
+	while (stack_size > 0)
+	{
+		--stack_size;
+		if (stack_distance[stack_size] > best_distance)
+			continue;
+
+		const MeshBVHNode& node = nodes[stack[stack_size]];
+		if (node.count > 0)
+		{
+			for (unsigned int i = node.first; i < node.first + node.count; i++)
+			{
+				float tri_distance;
+				float3 tri_point;
+				if (ray.Intersects(triangles[i], &tri_distance, &tri_point) && tri_distance < best_distance)
+				{
+					best_distance = tri_distance;
+					hit_point = tri_point;
+					triangle = triangles[i];
+					hit = true;
+				}
+			}
+			continue;
+		}
+
+		float left_near, right_near;
+		bool left_hit = IntersectBox(nodes[node.first].box, ray.pos, inv_dir, best_distance, left_near);
+		bool right_hit = IntersectBox(nodes[node.first + 1].box, ray.pos, inv_dir, best_distance, right_near);
+
+		if (left_hit && right_hit)
+		{
+			//Push the far child first so the near one is visited first
+			bool left_first = left_near <= right_near;
+			stack[stack_size] = left_first ? node.first + 1 : node.first;
+			stack_distance[stack_size++] = left_first ? right_near : left_near;
+			stack[stack_size] = left_first ? node.first : node.first + 1;
+			stack_distance[stack_size++] = left_first ? left_near : right_near;
+		}
+		else if (left_hit)
+		{
+			stack[stack_size] = node.first;
+			stack_distance[stack_size++] = left_near;
+		}
+		else if (right_hit)
+		{
+			stack[stack_size] = node.first + 1;
+			stack_distance[stack_size++] = right_near;
+		}
+	}
+
+	if (hit)
+		distance = best_distance;
+	return hit;
+}
+
+bool MeshBVH::RayCastAny(const Ray & ray, float max_distance) const
+{
+	if (nodes.empty())
+		return false;
+
+	float3 inv_dir(1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z);
+
+	unsigned int stack[MESH_BVH_MAX_DEPTH + 2];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+
+	float t_near;
+	while (stack_size > 0)
+	{
+		const MeshBVHNode& node = nodes[stack[--stack_size]];
+		if (!IntersectBox(node.box, ray.pos, inv_dir, max_distance, t_near))
+			continue;
+
+		if (node.count > 0)
+		{
+			for (unsigned int i = node.first; i < node.first + node.count; i++)
+			{
+				float tri_distance;
+				if (ray.Intersects(triangles[i], &tri_distance, nullptr) && tri_distance < max_distance)
+					return true;
+			}
+		}
+		else
+		{
+			stack[stack_size++] = node.first + 1;
+			stack[stack_size++] = node.first;
+		}
+	}
+
+	return false;
+}
+
+unsigned int MeshBVH::NumNodes() const
+{
+	return nodes.size();
+}
+
+unsigned int MeshBVH::NumTriangles() const
+{
+	return triangles.size();
+}
+
+bool MeshBVH::RayCastBruteForce(const float * vertices, const unsigned int * indices, unsigned int num_indices, const Ray & ray, float & distance, float3 & hit_point, Triangle & triangle)
+{
+	bool hit = false;
+	float min_distance = FLOAT_INF;
+	for (unsigned int i = 0; i + 2 < num_indices; i += 3)
+	{
+		Triangle tri(float3(&vertices[indices[i] * 3]), float3(&vertices[indices[i + 1] * 3]), float3(&vertices[indices[i + 2] * 3]));
+		float tri_distance;
+		float3 tri_point;
+		if (ray.Intersects(tri, &tri_distance, &tri_point) && tri_distance < min_distance)
+		{
+			min_distance = tri_distance;
+			hit_point = tri_point;
+			triangle = tri;
+			hit = true;
+		}
+	}
+
+	if (hit)
+		distance = min_distance;
+	return hit;
+}
@@ -0,0 +1,54 @@
+#ifndef __MESH_BVH_H__
+#define __MESH_BVH_H__
+
+#include "MathGeoLib\include\MathGeoLib.h"
+
+#include <vector>
+
+#define MESH_BVH_LEAF_TRIANGLES 4
+#define MESH_BVH_SAH_BINS 12
+#define MESH_BVH_MAX_DEPTH 32 //Keeps the traversal stack fixed size
+
+struct MeshBVHNode
+{
+	math::AABB box;
+	unsigned int first = 0; //Leaf: first triangle. Branch: left child (right child is first + 1)
+	unsigned int count = 0; //Number of triangles. 0 means branch.
+};
+
+/*
+	Bounding volume hierarchy over the triangles of one mesh, in mesh local space.
+	Built with a binned surface area heuristic. Triangles are copied in leaf order so a leaf reads contiguous memory.
+	Owned by ResourceFileMesh and shared by all the instances of the mesh.
+*/
+class MeshBVH
+{
+public:
+	MeshBVH();
+	~MeshBVH();
+
+	void Build(const float* vertices, const unsigned int* indices, unsigned int num_indices);
+
+	//Closest hit. Distance is along the ray direction.
+	bool RayCast(const math::Ray& ray, float& distance, math::float3& hit_point, math::Triangle& triangle)const;
+	//True if any triangle is hit before max_distance. Stops at the first one found.
+	bool RayCastAny(const math::Ray& ray, float max_distance = FLOAT_INF)const;
+
+	unsigned int NumNodes()const;
+	unsigned int NumTriangles()const;
+
+	//Reference loop that tests every triangle. Used when there's no BVH and for benchmarking.
+	static bool RayCastBruteForce(const float* vertices, const unsigned int* indices, unsigned int num_indices, const math::Ray& ray, float& distance, math::float3& hit_point, math::Triangle& triangle);
+
+private:
+	void Subdivide(unsigned int node_index, unsigned int depth, std::vector<math::float3>& centroids, std::vector<math::AABB>& boxes);
+	void UpdateBounds(unsigned int node_index, const std::vector<math::AABB>& boxes);
+
+	static bool IntersectBox(const math::AABB& box, const math::float3& origin, const math::float3& inv_dir, float max_distance, float& t_near);
+
+private:
+	std::vector<MeshBVHNode> nodes;
+	std::vector<math::Triangle> triangles;
+};
+
+#endif // !__MESH_BVH_H__
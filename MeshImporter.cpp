@@ -151,7 +151,7 @@ void MeshImporter::ImportNode(aiNode * node, const aiScene * scene, GameObject*
 	go_root->transform->SetRotation(rot);
 	go_root->transform->SetScale(scale);
 
-	go_root->transform->Update(); //Force it to update the matrix
+	go_root->transform->ForceUpdate(); //Force it to update the matrix
 
 	if (node->mName.length > 0)
 		go_root->name = node->mName.C_Str();
@@ -389,7 +389,7 @@ bool MeshImporter::Save(Mesh& mesh, const char* folder_path, string& output_name
 	return ret;
 }
 
-Mesh * MeshImporter::Load(const char * path)
+Mesh * MeshImporter::Load(const char * path, bool load_buffers)
 {
 	Mesh* mesh = nullptr;
 	char* buffer = nullptr;
@@ -455,7 +455,8 @@ Mesh * MeshImporter::Load(const char * path)
 		memcpy(mesh->tangents, cursor, bytes);
 		cursor += bytes;
 
-		LoadBuffers(mesh);
+		if (load_buffers)
+			LoadBuffers(mesh);
 	}
 	if(buffer)
 		delete[] buffer;
@@ -468,47 +469,90 @@ void MeshImporter::LoadBuffers(Mesh* mesh)
 {
 	//Vertices ------------------------------------------------------------------------------------------------------
 
+	//One interleaved buffer: position, uv, normal, tangent
+	std::vector<float> interleaved;
+	InterleaveVertices(mesh, interleaved);
+
 	//Load buffer to VRAM
 	glGenBuffers(1, (GLuint*)&(mesh->id_vertices));
 	glBindBuffer(GL_ARRAY_BUFFER, mesh->id_vertices);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * mesh->num_vertices, mesh->vertices, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, MESH_VERTEX_STRIDE * mesh->num_vertices, interleaved.data(), GL_STATIC_DRAW);
+
+	//Vertex array: captures the attributes and the index buffer. Without them RenderState::BindMesh sets the buffers on each draw.
+	bool vertex_array = App->renderer3D->AreVertexArraysSupported();
+	if (vertex_array)
+	{
+		glGenVertexArrays(1, (GLuint*)&(mesh->id_vao));
+		glBindVertexArray(mesh->id_vao);
+
+		//Vertices == 0, uvs == 1, normals == 2, tangents == 3
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)MESH_UV_OFFSET);
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)MESH_NORMAL_OFFSET);
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)MESH_TANGENT_OFFSET);
+	}
 
 	//Indices --------------------------------------------------------------------------------------------------------
 
-	//Load indices buffer to VRAM
+	//Load indices buffer to VRAM. 16 bits when every vertex fits.
 	glGenBuffers(1, (GLuint*) &(mesh->id_indices));
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->id_indices);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * mesh->num_indices, mesh->indices, GL_STATIC_DRAW);
-	//Load UVs -----------------------------------------------------------------------------------------------------------------------
-
-	glGenBuffers(1, (GLuint*)&(mesh->id_uvs));
-	glBindBuffer(GL_ARRAY_BUFFER, mesh->id_uvs);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 2 * mesh->num_uvs, mesh->uvs, GL_STATIC_DRAW);
+	if (mesh->num_vertices <= 0xFFFF)
+	{
+		std::vector<unsigned short> short_indices(mesh->indices, mesh->indices + mesh->num_indices);
+		mesh->index_size = sizeof(unsigned short);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned short) * mesh->num_indices, short_indices.data(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		mesh->index_size = sizeof(uint);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * mesh->num_indices, mesh->indices, GL_STATIC_DRAW);
+	}
 
-	//Load Normals -----------------------------------------------------------------------------------------------------------------------
+	//The rest of the renderer draws with the default vertex array
+	if (vertex_array)
+		glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
 
-	if (mesh->normals)
+void MeshImporter::InterleaveVertices(const Mesh * mesh, std::vector<float>& interleaved)
+{
+	//Missing attributes are left at 0
+	interleaved.assign(mesh->num_vertices * (MESH_VERTEX_STRIDE / sizeof(float)), 0.0f);
+	for (uint i = 0; i < mesh->num_vertices; i++)
 	{
-		glGenBuffers(1, (GLuint*)&(mesh->id_normals));
-		glBindBuffer(GL_ARRAY_BUFFER, mesh->id_normals);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * mesh->num_vertices, mesh->normals, GL_STATIC_DRAW);
+		float* vertex = &interleaved[i * (MESH_VERTEX_STRIDE / sizeof(float))];
+		if (mesh->vertices)
+			memcpy(vertex, &mesh->vertices[i * 3], sizeof(float) * 3);
+		if (mesh->uvs && i < mesh->num_uvs)
+			memcpy(vertex + 3, &mesh->uvs[i * 2], sizeof(float) * 2);
+		if (mesh->normals)
+			memcpy(vertex + 5, &mesh->normals[i * 3], sizeof(float) * 3);
+		if (mesh->tangents)
+			memcpy(vertex + 8, &mesh->tangents[i * 3], sizeof(float) * 3);
 	}
-
-	//Load Tangents-----------------------------------------------------------------------------------------------------------------------
-	glGenBuffers(1, (GLuint*)&(mesh->id_tangents));
-	glBindBuffer(GL_ARRAY_BUFFER, mesh->id_tangents);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * mesh->num_vertices, mesh->tangents, GL_STATIC_DRAW);
 }
 
 void MeshImporter::DeleteBuffers(Mesh* mesh)
 {
-	if (mesh != nullptr)
+	if (mesh != nullptr && mesh->in_arena)
+	{
+		App->renderer3D->GetGeometryArena()->Remove(mesh);
+	}
+	else if (mesh != nullptr)
 	{
+		if (mesh->id_vao != 0)
+			glDeleteVertexArrays(1, (GLuint*)&(mesh->id_vao));
 		App->renderer3D->RemoveBuffer(mesh->id_vertices);
 		App->renderer3D->RemoveBuffer(mesh->id_indices);
 		App->renderer3D->RemoveBuffer(mesh->id_uvs);
 		App->renderer3D->RemoveBuffer(mesh->id_normals);
 		App->renderer3D->RemoveBuffer(mesh->id_tangents);
+		mesh->id_vao = mesh->id_vertices = mesh->id_indices = mesh->id_uvs = mesh->id_normals = mesh->id_tangents = 0;
 	}
 	else
 	{
@@ -829,7 +873,7 @@ void MeshImporter::ImportNodeUUID(aiNode* node, const aiScene* scene, GameObject
 	go_root->transform->SetRotation(rot);
 	go_root->transform->SetScale(scale);
 
-	go_root->transform->Update(); //Force it to update the matrix
+	go_root->transform->ForceUpdate(); //Force it to update the matrix
 
 	if (node->mName.length > 0)
 		go_root->name = node->mName.C_Str();
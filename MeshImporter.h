@@ -3,6 +3,7 @@
 
 #include <string>
 #include <stack>
+#include <vector>
 
 struct aiMesh;
 struct aiNode;
@@ -28,9 +29,10 @@ namespace MeshImporter
 	bool ImportMeshUUID(const aiMesh* mesh, const char* folder_path, std::string& output_name, unsigned int uuid);
 	bool SaveUUID(Mesh& mesh, const char* folder_path, std::string& output_name, unsigned int uuid);
 
-	Mesh* Load(const char* path);
+	Mesh* Load(const char* path, bool load_buffers = true); //Without buffers the mesh can go to the GeometryArena
 	void LoadBuffers(Mesh* mesh);
-	void DeleteBuffers(Mesh* mesh);
+	void InterleaveVertices(const Mesh* mesh, std::vector<float>& interleaved); //Vertex layout of MESH_VERTEX_STRIDE
+	void DeleteBuffers(Mesh* mesh); //Also takes the mesh out of the GeometryArena
 
 	void CollectGameObjects(GameObject* root, std::vector<GameObject*> vector);
 	void SaveInfoFile(std::vector<GameObject*> vector, const char* file);
@@ -35,11 +35,18 @@
 #include "RenderTexEditorWindow.h"
 #include "TestWindow.h"
 #include "RaycastHit.h"
+#include "ComponentMesh.h"
+#include "ResourceFileMesh.h"
+#include "MeshBVH.h"
+#include "PerfTimer.h"
+#include "Random.h"
 
 #include "SDL/include/SDL_scancode.h"
 #include "SDL/include/SDL_messagebox.h"
 #include "SDL/include/SDL_mouse.h"
 
+#include <mutex>
+
 ModuleEditor::ModuleEditor(const char* name, bool start_enabled) : Module(name, start_enabled)
 {
 	windows.push_back(console = new Console()); //Create console in the constructor to get ALL init logs from other modules.
@@ -239,6 +246,8 @@ void ModuleEditor::DisplayWarning(WarningType type, const char *format, ...)
 	static char tmp_string[4096];
 	static char tmp_string2[4096];
 	static va_list ap;
+	static std::mutex warning_mutex; //Can be called from the job system workers
+	std::lock_guard<std::mutex> lock(warning_mutex);
 
 	// Construct the string from variable arguments
 	va_start(ap, format);
@@ -844,6 +853,85 @@ void ModuleEditor::DebugMenu()
 		App->renderer3D->renderAABBs = !App->renderer3D->renderAABBs;
 	}
 	if (App->renderer3D->renderAABBs) { ImGui::SameLine(); ImGui::Text("X"); }
+	if (ImGui::MenuItem("Occlusion culling"))
+	{
+		App->renderer3D->occlusion_culling = !App->renderer3D->occlusion_culling;
+	}
+	if (App->renderer3D->occlusion_culling) { ImGui::SameLine(); ImGui::Text("X"); }
+	if (ImGui::MenuItem("Instancing"))
+	{
+		App->renderer3D->instancing = !App->renderer3D->instancing;
+	}
+	if (App->renderer3D->instancing) { ImGui::SameLine(); ImGui::Text("X"); }
+	if (ImGui::MenuItem("Multi Draw Indirect", nullptr, false, App->renderer3D->IsMultiDrawSupported()))
+	{
+		App->renderer3D->multi_draw = !App->renderer3D->multi_draw;
+	}
+	if (App->renderer3D->multi_draw && App->renderer3D->IsMultiDrawSupported()) { ImGui::SameLine(); ImGui::Text("X"); }
+	if (ImGui::MenuItem("Benchmark mesh raycast", nullptr, false, selected.size() > 0))
+	{
+		BenchmarkMeshRayCast(10000);
+	}
+}
+
+//Casts random rays against the local AABB of the selected mesh and compares the BVH with the brute force loop
+void ModuleEditor::BenchmarkMeshRayCast(unsigned int num_rays) const
+{
+	if (selected.size() == 0)
+		return;
+
+	GameObject* go = selected.front();
+	ComponentMesh* c_mesh = (ComponentMesh*)go->GetComponent(C_MESH);
+	if (c_mesh == nullptr || c_mesh->GetMesh() == nullptr || c_mesh->GetResource() == nullptr)
+	{
+		LOG("[WARNING] Mesh raycast benchmark needs a GameObject with a mesh resource");
+		return;
+	}
+
+	const Mesh* mesh = c_mesh->GetMesh();
+	AABB box = c_mesh->GetLocalAABB();
+	vec size = box.Size();
+
+	PerfTimer timer;
+	timer.Start();
+	MeshBVH* bvh = c_mesh->GetResource()->GetBVH();
+	double build_ms = timer.ReadMs();
+	if (bvh == nullptr)
+		return;
+
+	//Rays start outside the box and aim at a random point inside it
+	vector<Ray> rays;
+	rays.reserve(num_rays);
+	for (unsigned int i = 0; i < num_rays; i++)
+	{
+		vec target = box.minPoint + vec(App->rnd->RandomFloat(), App->rnd->RandomFloat(), App->rnd->RandomFloat()).Mul(size);
+		vec origin = box.CenterPoint() + vec(App->rnd->RandomFloat(-1.0f, 1.0f), App->rnd->RandomFloat(-1.0f, 1.0f), App->rnd->RandomFloat(-1.0f, 1.0f)).Normalized() * size.Length();
+		rays.push_back(Ray(origin, (target - origin).Normalized()));
+	}
+
+	float distance;
+	vec hit_point;
+	Triangle triangle;
+	vector<float> brute_distances(num_rays, -1.0f);
+
+	timer.Start();
+	for (unsigned int i = 0; i < num_rays; i++)
+		if (MeshBVH::RayCastBruteForce(mesh->vertices, mesh->indices, mesh->num_indices, rays[i], distance, hit_point, triangle))
+			brute_distances[i] = distance;
+	double brute_ms = timer.ReadMs();
+
+	unsigned int mismatches = 0;
+	timer.Start();
+	for (unsigned int i = 0; i < num_rays; i++)
+	{
+		bool hit = bvh->RayCast(rays[i], distance, hit_point, triangle);
+		if (hit != (brute_distances[i] >= 0.0f) || (hit && Abs(distance - brute_distances[i]) > 1e-4f))
+			++mismatches;
+	}
+	double bvh_ms = timer.ReadMs();
+
+	LOG("Mesh raycast benchmark: %s, %u triangles, %u BVH nodes, build %.3f ms", go->name.data(), bvh->NumTriangles(), bvh->NumNodes(), build_ms);
+	LOG("%u rays: brute force %.3f ms, BVH %.3f ms (x%.1f), %u mismatches", num_rays, brute_ms, bvh_ms, (bvh_ms > 0.0) ? brute_ms / bvh_ms : 0.0, mismatches);
 }
 
 bool ModuleEditor::QuitWindow()
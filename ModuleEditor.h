@@ -91,6 +91,8 @@ private:
 	void GameObjectMenu();
 	void PhysicsMenu();
 
+	void BenchmarkMeshRayCast(unsigned int num_rays)const;
+
 	bool QuitWindow();
 	void OnSaveCall();
 	void OpenSaveSceneWindow();
@@ -25,6 +25,8 @@
 
 #include "Brofiler\include\Brofiler.h"
 
+#include <algorithm>
+
 ModuleGOManager::ModuleGOManager(const char* name, bool start_enabled) : Module(name, start_enabled)
 {}
 
@@ -34,6 +36,8 @@ ModuleGOManager::~ModuleGOManager()
 		delete root;
 
 	dynamic_gameobjects.clear();
+	dynamic_iterators.clear();
+	dynamic_tree.Clear();
 	delete layer_system;
 }
 
@@ -81,26 +85,26 @@ bool ModuleGOManager::Start()
 update_status ModuleGOManager::PreUpdate()
 {
 	BROFILER_CATEGORY("ModuleGOManager::PreUpdate", Profiler::Color::Aquamarine)
+	//Meshes set to draw on the last frame are stale from now on
+	++frame;
+
+	//Only the GameObjects with removed components, before any of them is deleted
+	for (vector<GameObject*>::iterator go = go_removing_components.begin(); go != go_removing_components.end(); ++go)
+		(*go)->RemovePendingComponents();
+	go_removing_components.clear();
+
 	//Remove all GameObjects that needs to be erased
 	for (vector<GameObject*>::iterator go = go_to_remove.begin(); go != go_to_remove.end(); ++go)
 	{
-		if ((*go)->IsStatic())
-		{
-			if ((*go)->bounding_box)
-				octree.Remove((*go), (*go)->bounding_box->CenterPoint());
-		}
-		else
-		{
-			dynamic_gameobjects.remove(*go);
-		}
+		//Removed from both: the static flag doesn't tell which one holds it, and a stale entry would alias the next GameObject of that slot
+		octree.Remove(*go);
+		RemoveDynamicGameObject(*go);
 		delete (*go);
+		transform_order_dirty = true;
 	}
 
 	go_to_remove.clear();
 
-	if (root)
-		PreUpdateGameObjects(root);
-
 	return UPDATE_CONTINUE;
 }
 
@@ -109,10 +113,16 @@ update_status ModuleGOManager::Update()
 	BROFILER_CATEGORY("ModuleGOManager::Update", Profiler::Color::SkyBlue)
 	//Update GameObjects
 	if(root)
-		UpdateGameObjects(root);
+		UpdateComponents();
+
+	//After the components so this frame's changes are rendered this frame
+	UpdateTransforms();
 
-	if(draw_octree)
+	if (draw_octree)
+	{
 		octree.Draw();
+		dynamic_tree.Draw();
+	}
 
 	return UPDATE_CONTINUE;
 }
@@ -143,7 +153,7 @@ GameObject* ModuleGOManager::CreateGameObject(GameObject* parent)
 		}
 	}
 
-	dynamic_gameobjects.push_back(object);
+	AddDynamicGameObject(object);
 
 	return object;
 }
@@ -218,6 +228,8 @@ bool ModuleGOManager::RemoveGameObject(GameObject* object)
 	{
 		if(object->GetParent() != nullptr)
 			object->GetParent()->RemoveChild(object);
+		UnregisterGameObject(object);
+		StopComponents(object);
 		object->RemoveAllChilds();
 		
 		go_to_remove.push_back(object);
@@ -234,6 +246,8 @@ bool ModuleGOManager::FastRemoveGameObject(GameObject * object)
 
 	if (object)
 	{
+		UnregisterGameObject(object);
+		StopComponents(object);
 		object->RemoveAllChilds();
 		go_to_remove.push_back(object);
 		ret = true;
@@ -280,35 +294,34 @@ void ModuleGOManager::DuplicateGameObject(GameObject* object)
 	}
 }
 
-void ModuleGOManager::GetAllComponents(std::vector<Component*> &list, ComponentType type, GameObject *from) const 
+void ModuleGOManager::GetAllComponents(std::vector<Component*> &list, ComponentType type, const GameObject *from) const 
 {
-	GameObject* go = (from) ? from : root;
+	const std::vector<Component*>& components = component_registry.GetAll(type);
+	if (from == nullptr || from == root)
+	{
+		list.insert(list.end(), components.begin(), components.end());
+		return;
+	}
 
-	Component* component = go->GetComponent(type);
-	if (component) list.push_back(component);
+	for (std::vector<Component*>::const_iterator component = components.begin(); component != components.end(); ++component)
+		if ((*component)->GetGameObject()->IsInSubtreeOf(from))
+			list.push_back(*component);
+}
 
-	const vector<GameObject*>* childs = go->GetChilds();
-	for (vector<GameObject*>::const_iterator child = childs->begin(); child != childs->end(); ++child)
-		GetAllComponents(list, type,(*child));
+const std::vector<Component*>& ModuleGOManager::GetComponentsOfType(ComponentType type, bool only_active) const
+{
+	return (only_active) ? component_registry.GetActive(type) : component_registry.GetAll(type);
 }
 
 ComponentLight * ModuleGOManager::GetDirectionalLight(GameObject* from) const
 {
-	ComponentLight* light = nullptr;
-	GameObject* go = (from) ? from : root;
-
-	light = (ComponentLight*)go->GetComponent(C_LIGHT);
-	if (light)
-	{
-		if(light->GetLightType() == LightType::DIRECTIONAL_LIGHT)
-			return light;
-	}		
-
-	const vector<GameObject*>* childs = go->GetChilds();
-	for (vector<GameObject*>::const_iterator child = childs->begin(); child != childs->end(); ++child)
+	const std::vector<Component*>& lights = component_registry.GetAll(C_LIGHT);
+	for (std::vector<Component*>::const_iterator it = lights.begin(); it != lights.end(); ++it)
 	{
-		light = GetDirectionalLight((*child));
-		if (light)
+		ComponentLight* light = (ComponentLight*)(*it);
+		if (light->GetLightType() != LightType::DIRECTIONAL_LIGHT)
+			continue;
+		if (from == nullptr || from == root || light->GetGameObject()->IsInSubtreeOf(from))
 			return light;
 	}
 
@@ -390,11 +403,9 @@ bool ModuleGOManager::InsertGameObjectInOctree(GameObject * go)
 	bool ret = false;
 	if (go->IsStatic())
 	{
-		if (go->bounding_box) //Only GameObjects with mesh can go inside for now.
-		{
-			dynamic_gameobjects.remove(go);
-			ret = octree.Insert(go, go->bounding_box->CenterPoint());
-		}
+		RemoveDynamicGameObject(go);
+		if (go->bounding_box) //Only GameObjects with mesh can go inside for now. The rest get in with their first box.
+			ret = octree.Insert(go, *go->bounding_box);
 	}
 	return ret;
 }
@@ -403,11 +414,99 @@ bool ModuleGOManager::RemoveGameObjectOfOctree(GameObject * go)
 {
 	bool ret = false;
 	if (go->bounding_box)
+		ret = octree.Remove(go);
+	AddDynamicGameObject(go);
+	return ret;
+}
+
+void ModuleGOManager::OnBoundingBoxModified(GameObject* go)
+{
+	go->InvalidateBounds();
+	if (spatial_hash.Contains(go))
+		spatial_hash.Update(go);
+	if (go->bounding_box == nullptr)
+		return;
+
+	if (go->IsStatic())
 	{
-		ret = octree.Remove(go, go->bounding_box->CenterPoint());
-		dynamic_gameobjects.push_back(go);
+		//A static GameObject that got its first box after being set static is not in the octree yet
+		if (octree.Update(go, *go->bounding_box) == false && octree.Insert(go, *go->bounding_box) == false)
+			LOG("[WARNING] %s couldn't be inserted in the octree", go->name.data());
 	}
-	return ret;
+	else if (dynamic_tree.Contains(go))
+		dynamic_tree.Update(go, *go->bounding_box); //Only touches the tree if the box left its margin
+	else if (dynamic_iterators.find(go) != dynamic_iterators.end())
+		dynamic_tree.Insert(go, *go->bounding_box); //First bounding box of a dynamic GameObject
+}
+
+void ModuleGOManager::OnHierarchyModified(GameObject* attached)
+{
+	transform_order_dirty = true;
+	//Moved subtrees are already notified by the transform pass. New GameObjects may never be, so they are queued as they get attached.
+	if (attached != nullptr)
+		spatial_hash_pending.insert(attached);
+}
+
+void ModuleGOManager::RegisterComponent(Component * component)
+{
+	component_registry.Add(component);
+}
+
+void ModuleGOManager::UnregisterComponent(Component * component)
+{
+	component_scheduler.Unregister(component);
+	component_registry.Remove(component);
+}
+
+void ModuleGOManager::OnComponentActivityChanged(Component * component, bool value)
+{
+	if (value)
+		component_scheduler.Register(component);
+	else
+		component_scheduler.Unregister(component);
+	component_registry.SetActive(component, value);
+}
+
+void ModuleGOManager::OnComponentRemovalQueued(GameObject * go)
+{
+	go_removing_components.push_back(go);
+}
+
+void ModuleGOManager::StopComponents(GameObject * go)
+{
+	//It is deleted on the next PreUpdate, but it must not tick for what is left of this frame
+	const std::vector<Component*>* components = go->GetComponents();
+	for (std::vector<Component*>::const_iterator it = components->begin(); it != components->end(); ++it)
+		(*it)->LeaveTickLists();
+}
+
+unsigned int ModuleGOManager::GetFrame() const
+{
+	return frame;
+}
+
+void ModuleGOManager::AddDynamicGameObject(GameObject* go)
+{
+	if (go->IsStatic() || dynamic_iterators.find(go) != dynamic_iterators.end())
+		return;
+
+	dynamic_gameobjects.push_back(go);
+	dynamic_iterators[go] = --dynamic_gameobjects.end();
+
+	if (go->bounding_box)
+		dynamic_tree.Insert(go, *go->bounding_box);
+}
+
+void ModuleGOManager::RemoveDynamicGameObject(GameObject* go)
+{
+	std::unordered_map<GameObject*, list<GameObject*>::iterator>::iterator it = dynamic_iterators.find(go);
+	if (it != dynamic_iterators.end())
+	{
+		dynamic_gameobjects.erase(it->second);
+		dynamic_iterators.erase(it);
+	}
+
+	dynamic_tree.Remove(go);
 }
 
 void ModuleGOManager::ClearScene()
@@ -425,7 +524,10 @@ void ModuleGOManager::ClearScene()
 		App->editor->selected.clear();
 
 		root = nullptr;
+		transform_order_dirty = true;
 		dynamic_gameobjects.clear();
+		dynamic_iterators.clear();
+		dynamic_tree.Clear();
 		octree.Create(OCTREE_SIZE);
 	}
 }
@@ -496,10 +598,10 @@ GameObject * ModuleGOManager::LoadGameObject(const Data & go_data)
 	if (go != nullptr)
 	{
 		//Space partioning
-		if (go->IsStatic())
-			octree.Insert(go, go->bounding_box->CenterPoint()); //Needs to go after the components because of the bounding box reference
-		else
-			dynamic_gameobjects.push_back(go);
+		if (go->IsStatic() == false)
+			AddDynamicGameObject(go);
+		else if (go->bounding_box)
+			octree.Insert(go, *go->bounding_box); //Needs to go after the components because of the bounding box reference
 	}
 
 	return go;
@@ -587,36 +689,49 @@ GameObject* ModuleGOManager::LoadPrefabGameObject(const Data & go_data, map<unsi
 			go_component->Load(component);
 	}
 
-	if (is_static)
-		octree.Insert(go, go->bounding_box->CenterPoint()); //Needs to go after the components because of the bounding box reference
-	else
-		dynamic_gameobjects.push_back(go);
+	if (is_static == false)
+		AddDynamicGameObject(go);
+	else if (go->bounding_box)
+		octree.Insert(go, *go->bounding_box); //Needs to go after the components because of the bounding box reference
 
 	return go;
 }
 
+void ModuleGOManager::RegisterGameObject(GameObject * go)
+{
+	//A newer GameObject with the same UUID replaces the old one (prefab instances are recreated with their UUID)
+	uuid_index[go->GetUUID()] = go;
+}
+
+void ModuleGOManager::UnregisterGameObject(GameObject * go)
+{
+	spatial_hash.Remove(go);
+	spatial_hash_pending.erase(go);
+	//Its pending components go with it
+	vector<GameObject*>::iterator pending = std::find(go_removing_components.begin(), go_removing_components.end(), go);
+	if (pending != go_removing_components.end())
+		go_removing_components.erase(pending);
+
+	std::unordered_map<unsigned int, GameObject*>::iterator it = uuid_index.find(go->GetUUID());
+	if (it != uuid_index.end() && it->second == go)
+		uuid_index.erase(it);
+}
+
 GameObject * ModuleGOManager::FindGameObjectByUUID(GameObject* start, unsigned int uuid) const
 {
-	GameObject* ret = nullptr;
-	if (start)
-	{
-		if (start->GetUUID() == uuid)
-		{
-			ret = start;
-		}
-		else
-		{
-			const std::vector<GameObject*>* childs = start->GetChilds();
-			for (std::vector<GameObject*>::const_iterator child = childs->begin(); child != childs->end(); ++child)
-			{
-				ret = FindGameObjectByUUID((*child), uuid);
-				if (ret != nullptr)
-					break;
-			}
-		}
-	}
-	
-	return ret;
+	if (start == nullptr)
+		return nullptr;
+
+	std::unordered_map<unsigned int, GameObject*>::const_iterator it = uuid_index.find(uuid);
+	if (it == uuid_index.end())
+		return nullptr;
+
+	//The GameObject must hang from start
+	for (GameObject* go = it->second; go != nullptr; go = go->GetParent())
+		if (go == start)
+			return it->second;
+
+	return nullptr;
 }
 
 void ModuleGOManager::LinkGameObjectPointer(GameObject **pointer_to_pointer_go, unsigned int uuid_to_assign)
@@ -624,53 +739,52 @@ void ModuleGOManager::LinkGameObjectPointer(GameObject **pointer_to_pointer_go,
 	*pointer_to_pointer_go = FindGameObjectByUUID(root, uuid_to_assign);
 }
 
-//Sort the AABBs for the distance from the current camera
-int  CompareAABB(const void * a, const void * b)
+//Layer filter and exact mesh test for the ordered scene raycast. Keeps the closest hit.
+struct SceneRaycastVisitor
 {
-	float3 cam_pos = App->camera->GetPosition();
-	float a_dst = (cam_pos - ((GameObject*)a)->bounding_box->CenterPoint()).Length();
-	float b_dst = (cam_pos - ((GameObject*)b)->bounding_box->CenterPoint()).Length();
-	if (a_dst < b_dst) return -1;
-	if (a_dst = b_dst) return 0;
-	if (a_dst > b_dst) return 1;
-	return 99999;
-}
+	SceneRaycastVisitor(const Ray& ray, const std::vector<int>& layers) : ray(ray), layers(layers)
+	{}
 
-RaycastHit ModuleGOManager::Raycast(const Ray & ray, std::vector<int> layersToCheck, bool keepDrawing)
-{
-	vector<GameObject*> collisions;
-	octree.Intersect(collisions, ray);
-	for (list<GameObject*>::const_iterator dyn_go = dynamic_gameobjects.begin(); dyn_go != dynamic_gameobjects.end(); dyn_go++)
+	bool Accept(GameObject* go)const
 	{
-		if ((*dyn_go)->bounding_box)
-		{
-			if (ray.Intersects(*(*dyn_go)->bounding_box))
-			{
-				collisions.push_back((*dyn_go));
-			}
-		}
+		//If layers to check is empty, object must be checked
+		if (layers.empty())
+			return true;
+		for (std::vector<int>::const_iterator l = layers.begin(); l != layers.end(); ++l)
+			if (go->layer == *l)
+				return true;
+		return false;
 	}
-	std::sort(collisions.begin(), collisions.end(), CompareAABB);
 
-	vector<GameObject*>::iterator it = collisions.begin(); //Test with vertices
-	RaycastHit hit;
-	for (;it != collisions.end(); it++)
+	bool Hit(GameObject* go, float& distance)
 	{
-		//If layers to check is empty, object must be checked (check = true)
-		bool check = layersToCheck.empty();		
-		for (std::vector<int>::iterator l = layersToCheck.begin(); l != layersToCheck.end() && check == false; l++)
-		{
-			if ((*it)->layer == *l) { check = true; }
-		}
-		if (check)
-		{
-			if ((*it)->RayCast(ray, hit))
-			{
-				break;
-			}
-		}
+		RaycastHit go_hit;
+		if (go->RayCast(ray, go_hit) == false)
+			return false;
+
+		distance = go_hit.distance;
+		if (hit.object == nullptr || go_hit.distance < hit.distance)
+			hit = go_hit;
+		return true;
 	}
 
+	const Ray& ray;
+	const std::vector<int>& layers;
+	RaycastHit hit;
+};
+
+RaycastHit ModuleGOManager::Raycast(const Ray & ray, std::vector<int> layersToCheck, bool keepDrawing)
+{
+	//Entry distances and hit distances are compared along the same normalized direction
+	Ray world_ray(ray.pos, ray.dir.Normalized());
+	SceneRaycastVisitor visitor(world_ray, layersToCheck);
+
+	//Static objects first. Their closest hit prunes the dynamic tree.
+	float max_distance = octree.RayCast(world_ray, visitor);
+	dynamic_tree.RayCast(world_ray, visitor, max_distance);
+
+	RaycastHit hit = visitor.hit;
+
 	if (keepDrawing && hit.object != nullptr)
 	{
 		lastRayData[0] = ray.pos;
@@ -681,126 +795,109 @@ RaycastHit ModuleGOManager::Raycast(const Ray & ray, std::vector<int> layersToCh
 	return hit;
 }
 
-AABB ModuleGOManager::GetWorldAABB(std::vector<int> layersToCheck)
+AABB ModuleGOManager::GetWorldAABB(const std::vector<int>& layersToCheck, GameObject* go)
 {
-	AABB ret;
-	std::vector<float3> points = GetWorldAABB(layersToCheck, root);
-	if (points.empty() == false)
-	{
-		ret.minPoint = points[0];
-		ret.maxPoint = points[1];
-	}
+	if (go == nullptr)
+		go = root;
+
+	AABB ret(float3::zero, float3::zero);
+	if (layersToCheck.empty())
+		ret = go->GetSubtreeAABB();
 	else
-	{
-		ret.maxPoint = float3::zero;
-		ret.minPoint = float3::zero;
-	}
+		go->GetSubtreeAABB(layersToCheck, ret); //Stays zero if there is nothing in those layers
 	return ret;
 }
 
-std::vector<float3> ModuleGOManager::GetWorldAABB(std::vector<int> layersToCheck, GameObject * go)
+void ModuleGOManager::LinkAnimation(GameObject* root) const
 {
-	//return, [0] is min Point and [1] is MaxPoint
-	std::vector<float3> ret;
+	if (root == nullptr)
+		return;
 
-	//Checking if we must check this object according to the layers. If no layers are passed, all of them are checked
-	bool inLayer = false;
-	if (layersToCheck.empty() == false)
-	{
-		for (std::vector<int>::iterator l = layersToCheck.begin(); l != layersToCheck.end(); l++)
-		{
-			if (go->layer == *l)
-			{
-				inLayer = true;
-				break;
-			}
-		}
-	}
-	else
+	const std::vector<Component*>& animations = component_registry.GetAll(C_ANIMATION);
+	for (std::vector<Component*>::const_iterator it = animations.begin(); it != animations.end(); ++it)
 	{
-		inLayer = true;
+		ComponentAnimation* c_anim = (ComponentAnimation*)(*it);
+		if (c_anim->linked == false && (root == this->root || c_anim->GetGameObject()->IsInSubtreeOf(root)))
+			c_anim->LinkAnimation();
 	}
+}
 
-	if (inLayer)
-	{
-		//If we need to consider the GO, we add Max and Min points.
-		ComponentMesh* msh = (ComponentMesh*) go->GetComponent(C_MESH);
-		
-		if (msh)
-		{
-			ret.push_back(msh->GetBoundingBox().minPoint);
-			ret.push_back(msh->GetBoundingBox().maxPoint);
-		}
-		else
-		{
-			ret.push_back(go->transform->GetPosition());
-			ret.push_back(go->transform->GetPosition());
-		}
-	}
+void ModuleGOManager::UpdateComponents()
+{
+	BROFILER_CATEGORY("ModuleGOManager::UpdateComponents", Profiler::Color::SkyBlue)
 
-	//We check all childs and keep the min and max points
-	std::vector<GameObject*>::const_iterator it = go->GetChilds()->begin();
-	for(; it != go->GetChilds()->end(); it++)
-	{
-		std::vector<float3> p = GetWorldAABB(layersToCheck, *it);
-		if (p.empty() == false)
-		{
-			if (ret.empty() == true)
-			{
-				ret = p;
-			}
-			else
-			{
-				ret[0].x = min(ret[0].x, p[0].x); ret[0].y = min(ret[0].y, p[0].y); ret[0].z = min(ret[0].z, p[0].z);
-				ret[1].x = max(ret[1].x, p[1].x); ret[1].y = max(ret[1].y, p[1].y);	ret[1].z = max(ret[1].z, p[1].z);
-			}
-		}
-	}
-	return ret;
+	//Only active components of active GameObjects are in the tick lists
+	component_scheduler.Run(PHASE_PRE_UPDATE);
+	component_scheduler.Run(PHASE_UPDATE);
+	component_scheduler.Run(PHASE_POST_UPDATE);
 }
 
-void ModuleGOManager::LinkAnimation(GameObject* root) const
+void ModuleGOManager::UpdateTransforms()
 {
-	if (root == nullptr)
-		return;
+	BROFILER_CATEGORY("ModuleGOManager::UpdateTransforms", Profiler::Color::Tomato)
 
-	ComponentAnimation* c_anim = (ComponentAnimation*)root->GetComponent(C_ANIMATION);
+	if (transform_order_dirty)
+		RebuildTransformOrder();
 
-	if (c_anim)
+	//Parents come first, so their changed flag is already known when a child is reached
+	for (size_t i = 0; i < transform_order.size(); i++)
 	{
-		if (c_anim->linked == false)
-		{
-			c_anim->LinkAnimation();
-		}
+		int parent = transform_parents[i];
+		bool parent_changed = (parent >= 0) && transform_changed[parent];
+		transform_changed[i] = transform_order[i]->UpdateGlobalMatrix(parent_changed);
+		if (transform_changed[i])
+			transform_notify.push_back(transform_order[i]->GetGameObject());
 	}
 
-	const vector<GameObject*>* childs = root->GetChilds();
-	for (vector<GameObject*>::const_iterator child = (*childs).begin(); child != (*childs).end(); ++child)
-		LinkAnimation(*child);
+	//Components are told once, when every global matrix is final
+	for (size_t i = 0; i < transform_notify.size(); i++)
+		transform_notify[i]->TransformModified();
+
+	//Then the spatial hash takes the final bounds. The root is not a gameplay object.
+	for (size_t i = 0; i < transform_notify.size(); i++)
+		if (transform_notify[i] != root)
+			spatial_hash.Update(transform_notify[i]);
+	transform_notify.clear();
+
+	for (std::unordered_set<GameObject*>::iterator go = spatial_hash_pending.begin(); go != spatial_hash_pending.end(); ++go)
+		spatial_hash.Update(*go);
+	spatial_hash_pending.clear();
 }
 
-void ModuleGOManager::UpdateGameObjects(GameObject* object)
+void ModuleGOManager::RebuildTransformOrder()
 {
-	if(root != object && object->IsActive() == true)
-		object->Update();
+	transform_order.clear();
+	transform_parents.clear();
+	transform_order_dirty = false;
 
-	std::vector<GameObject*>::const_iterator child = object->GetChilds()->begin();
-	for (child; child != object->GetChilds()->end(); ++child)
+	if (root == nullptr)
 	{
-		UpdateGameObjects((*child));
+		transform_changed.clear();
+		return;
 	}
-}
-
-void ModuleGOManager::PreUpdateGameObjects(GameObject * obj)
-{
-	if (root != obj && obj->IsActive() == true)
-		obj->PreUpdate();
 
-	std::vector<GameObject*>::const_iterator child = obj->GetChilds()->begin();
-	for (child; child != obj->GetChilds()->end(); ++child)
+	//Depth-first, pre-order
+	std::vector<std::pair<GameObject*, int>> stack;
+	stack.push_back(std::pair<GameObject*, int>(root, -1));
+	while (stack.empty() == false)
 	{
-		PreUpdateGameObjects((*child));
+		GameObject* go = stack.back().first;
+		int parent = stack.back().second;
+		stack.pop_back();
+
+		if (go->transform == nullptr)
+			continue;
+
+		int index = transform_order.size();
+		transform_order.push_back(go->transform);
+		transform_parents.push_back(parent);
+
+		const std::vector<GameObject*>* childs = go->GetChilds();
+		for (std::vector<GameObject*>::const_reverse_iterator child = childs->rbegin(); child != childs->rend(); ++child)
+			stack.push_back(std::pair<GameObject*, int>(*child, index));
 	}
+
+	transform_changed.assign(transform_order.size(), 0);
 }
 
 void ModuleGOManager::OnPlay()
@@ -3,16 +3,24 @@
 
 #include "Module.h"
 #include "Octree.h"
+#include "AABBTree.h"
 #include "Primitive.h"
+#include "ComponentScheduler.h"
+#include "ComponentRegistry.h"
+#include "SpatialHash.h"
 
 #include <vector>
 #include <map>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
 
 class GameObject;
 class Component;
 class ComponentCamera;
 class ComponentLight;
 class ComponentCanvas;
+class ComponentTransform;
 
 class LayerSystem;
 class RaycastHit;
@@ -53,7 +61,9 @@ public:
 	bool FastRemoveGameObject(GameObject* object); // Doesn't remove the GameObject from the parent list.
 	void DuplicateGameObject(GameObject* object);
 
-	void GetAllComponents(std::vector<Component*> &list, ComponentType type, GameObject *from = nullptr) const;
+	//Components of one type in the subtree of from (the whole scene by default). O(components of that type).
+	void GetAllComponents(std::vector<Component*> &list, ComponentType type, const GameObject *from = nullptr) const;
+	const std::vector<Component*>& GetComponentsOfType(ComponentType type, bool only_active = false) const; //Every live component of that type
 	ComponentLight* GetDirectionalLight(GameObject* from = nullptr)const;
 
 	void LoadEmptyScene();
@@ -75,7 +85,19 @@ public:
 	//Handles the insertion / remove of the octree and dynamic gameobjects list. TODO: Rename the methods. Look confusing.
 	bool InsertGameObjectInOctree(GameObject* go);
 	bool RemoveGameObjectOfOctree(GameObject* go);
-
+	void AddDynamicGameObject(GameObject* go);
+	void RemoveDynamicGameObject(GameObject* go);
+	void OnBoundingBoxModified(GameObject* go); //Keeps the spatial structures in sync when a bounding box changes
+	void OnHierarchyModified(GameObject* attached = nullptr); //Parent/child links changed. The transform order is rebuilt before the next pass. Attached: GameObject that just got a parent.
+	void RegisterComponent(Component* component); //Called when a component is added to a GameObject
+	void UnregisterComponent(Component* component); //Called when a component is deleted
+	void OnComponentActivityChanged(Component* component, bool value); //Updates the tick lists and the active registry
+	void OnComponentRemovalQueued(GameObject* go); //Its removed components are deleted on the next PreUpdate
+	unsigned int GetFrame()const; //Counted on PreUpdate, tells this frame's data from the stale one
+
+	//UUID index. GameObjects register themselves on construction and leave it when they are removed or deleted.
+	void RegisterGameObject(GameObject* go);
+	void UnregisterGameObject(GameObject* go);
 	GameObject* FindGameObjectByUUID(GameObject* start, unsigned int uuid)const;
 	void LinkGameObjectPointer(GameObject **pointer_to_pointer_go, unsigned int uuid_to_assign);
 
@@ -84,14 +106,15 @@ public:
 
 	void LinkAnimation(GameObject* root)const; //Searches all go and links the meshes with the animation bones if is not done yet.
 
-	AABB GetWorldAABB(std::vector<int> layersToCheck = std::vector<int>());
-private:
-	std::vector<float3> GetWorldAABB(std::vector<int> layersToCheck, GameObject* go);
+	AABB GetWorldAABB(const std::vector<int>& layersToCheck = std::vector<int>(), GameObject* go = nullptr); //Bounds of the subtree of go, the whole scene by default. Cached per GameObject.
 
 private:
 
-	void UpdateGameObjects(GameObject* obj);
-	void PreUpdateGameObjects(GameObject* obj);
+	void UpdateComponents();
+	void StopComponents(GameObject* go); //Takes the components of a GameObject queued for removal out of the tick lists
+
+	void UpdateTransforms();
+	void RebuildTransformOrder();
 
 	void OnPlay();
 	void OnPlayGameObjects(GameObject* obj);
@@ -105,6 +128,21 @@ private:
 private:
 
 	vector<GameObject*> go_to_remove;
+	vector<GameObject*> go_removing_components; //GameObjects with components queued for removal
+	unsigned int frame = 0;
+	std::unordered_map<GameObject*, list<GameObject*>::iterator> dynamic_iterators; //O(1) removal from dynamic_gameobjects
+	std::unordered_map<unsigned int, GameObject*> uuid_index; //UUID -> GameObject. O(1) FindGameObjectByUUID.
+
+	//Scene transforms flattened parent before child. One linear pass per frame recomputes the global matrices.
+	std::vector<ComponentTransform*> transform_order;
+	std::vector<int> transform_parents; //Index of the parent inside transform_order. -1 for the root.
+	std::vector<char> transform_changed; //Global matrix changed on the current pass
+	std::vector<GameObject*> transform_notify; //GameObjects to call TransformModified on after the pass
+	bool transform_order_dirty = true;
+	std::unordered_set<GameObject*> spatial_hash_pending; //Attached GameObjects that go through the spatial hash after the next pass, even if their transform didn't change
+
+	ComponentScheduler component_scheduler;
+	ComponentRegistry component_registry;
 
 	string current_assets_scene_path = "";
 	string current_library_scene_path = "";
@@ -115,6 +153,8 @@ public:
 
 	//GameObjects TODO:Add functionallity to make it private
 	Octree<GameObject*> octree; //Static
+	AABBTree<GameObject*> dynamic_tree; //Dynamic GameObjects with a bounding box
+	SpatialHash spatial_hash; //Overlap and nearest queries for gameplay. Kept up to date by the transform pass.
 	list<GameObject*> dynamic_gameobjects;
 	bool draw_octree = false;
 	GameObject* root = nullptr;
@@ -623,61 +623,256 @@ void ModulePhysics3D::CreateGround()
 	world->addRigidBody(body);
 }
 
+//Walks the cells of a regular grid on the XZ plane in the same order the ray crosses them (2D DDA)
+struct TerrainGridWalk
+{
+	TerrainGridWalk(const Ray& ray, float origin_x, float origin_z, float cell_size, int cells_x, int cells_z, float t_start) : cells_x(cells_x), cells_z(cells_z), t_enter(t_start)
+	{
+		float3 start = ray.GetPoint(t_start);
+		x = (int)floor((start.x - origin_x) / cell_size);
+		z = (int)floor((start.z - origin_z) / cell_size);
+		CAP(x, 0, cells_x - 1);
+		CAP(z, 0, cells_z - 1);
+
+		step_x = (ray.dir.x > 0.0f) ? 1 : -1;
+		step_z = (ray.dir.z > 0.0f) ? 1 : -1;
+
+		//Distance to the first boundary and between boundaries on each axis
+		t_next_x = t_delta_x = FLOAT_INF;
+		if (ray.dir.x != 0.0f)
+		{
+			t_next_x = (origin_x + (x + ((step_x > 0) ? 1 : 0)) * cell_size - ray.pos.x) / ray.dir.x;
+			t_delta_x = cell_size / Abs(ray.dir.x);
+		}
+		t_next_z = t_delta_z = FLOAT_INF;
+		if (ray.dir.z != 0.0f)
+		{
+			t_next_z = (origin_z + (z + ((step_z > 0) ? 1 : 0)) * cell_size - ray.pos.z) / ray.dir.z;
+			t_delta_z = cell_size / Abs(ray.dir.z);
+		}
+	}
+
+	bool Valid()const { return x >= 0 && z >= 0 && x < cells_x && z < cells_z; }
+	float Exit()const { return Min(t_next_x, t_next_z); }
+
+	void Step()
+	{
+		if (t_next_x < t_next_z)
+		{
+			x += step_x;
+			t_enter = t_next_x;
+			t_next_x += t_delta_x;
+		}
+		else
+		{
+			z += step_z;
+			t_enter = t_next_z;
+			t_next_z += t_delta_z;
+		}
+	}
+
+	int x, z;
+	int step_x, step_z;
+	int cells_x, cells_z;
+	float t_enter;
+	float t_next_x, t_next_z;
+	float t_delta_x, t_delta_z;
+};
+
 bool ModulePhysics3D::RayCast(Ray raycast, RaycastHit & hit_OUT)
 {
 	BROFILER_CATEGORY("ModulePhysics3D::Terrain_Raycast", Profiler::Color::HoneyDew);
 
-	RaycastHit hit_info;
-	bool ret = false;
+	if (vertices == nullptr || blockMinHeight == nullptr || terrainW < 2 || terrainH < 2)
+		return false;
 
-	std::map<float, chunk> firstPass;
-	float dNear = 0;
-	float dFar = 0;
+	//The grid starts at the first vertex and cells are 1 unit wide
+	float origin_x = vertices[0].x;
+	float origin_z = vertices[0].z;
+	int cells_w = terrainW - 1;
+	int cells_h = terrainH - 1;
 
-	for (std::map<int, std::map<int, chunk>>::iterator it_z = chunks.begin(); it_z != chunks.end(); it_z++)
+	float t_start, t_end;
+	AABB bounds(float3(origin_x, terrainMinY, origin_z), float3(origin_x + cells_w, terrainMaxY, origin_z + cells_h));
+	if (raycast.Intersects(bounds, t_start, t_end) == false)
+		return false;
+
+	//Coarse walk over the height blocks. Only the blocks the ray crosses inside their height range are walked cell by cell.
+	TerrainGridWalk block(raycast, origin_x, origin_z, (float)TERRAIN_RAY_BLOCK, blocksW, blocksH, t_start);
+	while (block.Valid() && block.t_enter <= t_end)
 	{
-		for (std::map<int, chunk>::iterator it_x = it_z->second.begin(); it_x != it_z->second.end(); it_x++)
-		{			
-			if (raycast.Intersects(it_x->second.GetAABB(), dNear, dFar))
+		float t_exit = Min(block.Exit(), t_end);
+		float y_enter = raycast.pos.y + raycast.dir.y * block.t_enter;
+		float y_exit = raycast.pos.y + raycast.dir.y * t_exit;
+		int n = block.z * blocksW + block.x;
+
+		if (Min(y_enter, y_exit) <= blockMaxHeight[n] + 0.001f && Max(y_enter, y_exit) >= blockMinHeight[n] - 0.001f)
+		{
+			TerrainGridWalk cell(raycast, origin_x, origin_z, 1.0f, cells_w, cells_h, block.t_enter);
+			while (cell.Valid() && cell.t_enter <= t_exit)
 			{
-				firstPass.insert(std::pair<float, chunk>(dNear,it_x->second));
+				//Cells are visited front to back, so the first hit is the closest one
+				if (RayCastCell(raycast, cell.x, cell.z, cell.t_enter, Min(cell.Exit(), t_exit), hit_OUT))
+					return true;
+				cell.Step();
 			}
 		}
+		block.Step();
 	}
+	return false;
+}
 
-	uint u1, u2, u3;
+bool ModulePhysics3D::RayCastCell(const Ray & ray, int x, int z, float t_enter, float t_exit, RaycastHit & hit_OUT) const
+{
+	const float3& v00 = vertices[z * terrainW + x];
+	const float3& v10 = vertices[z * terrainW + x + 1];
+	const float3& v01 = vertices[(z + 1) * terrainW + x];
+	const float3& v11 = vertices[(z + 1) * terrainW + x + 1];
+
+	//Skip the cell if the ray passes over or under all its vertices
+	float y_enter = ray.pos.y + ray.dir.y * t_enter;
+	float y_exit = ray.pos.y + ray.dir.y * t_exit;
+	if (Min(y_enter, y_exit) > Max(Max(v00.y, v10.y), Max(v01.y, v11.y)) + 0.001f)
+		return false;
+	if (Max(y_enter, y_exit) < Min(Min(v00.y, v10.y), Min(v01.y, v11.y)) - 0.001f)
+		return false;
+
+	//Same two triangles GenerateIndices adds for this cell
+	Triangle triangles[2] = { Triangle(v01, v10, v00), Triangle(v10, v01, v11) };
+
+	bool ret = false;
 	float distance;
 	vec hit_point;
-	Triangle triangle;
-
-	for (std::map<float, chunk>::iterator it = firstPass.begin(); it != firstPass.end(); it++)
+	for (int i = 0; i < 2; i++)
 	{
-		for (uint n = 0; n < it->second.GetNIndices(); n += 3)
+		if (ray.Intersects(triangles[i], &distance, &hit_point) && (ret == false || distance < hit_OUT.distance))
 		{
-			u1 = it->second.indices[n];
-			u2 = it->second.indices[n + 1];
-			u3 = it->second.indices[n + 2];
-			triangle = Triangle(vertices[u1], vertices[u2], vertices[u3]);
+			ret = true;
+			hit_OUT.distance = distance;
+			hit_OUT.point = hit_point;
+			hit_OUT.normal = triangles[i].NormalCCW();
+		}
+	}
+
+	if (ret)
+	{
+		hit_OUT.object = nullptr;
+		hit_OUT.normal.Normalize();
+	}
+	return ret;
+}
+
+void ModulePhysics3D::RegenerateHeightBounds(int x0, int y0, int x1, int y1)
+{
+	if (vertices == nullptr || terrainW < 2 || terrainH < 2)
+		return;
 
-			if (raycast.Intersects(triangle, &distance, &hit_point))
+	int cells_w = terrainW - 1;
+	int cells_h = terrainH - 1;
+	int w = (cells_w + TERRAIN_RAY_BLOCK - 1) / TERRAIN_RAY_BLOCK;
+	int h = (cells_h + TERRAIN_RAY_BLOCK - 1) / TERRAIN_RAY_BLOCK;
+
+	if (blockMinHeight == nullptr || w != blocksW || h != blocksH)
+	{
+		DeleteHeightBounds();
+		blocksW = w;
+		blocksH = h;
+		blockMinHeight = new float[w * h];
+		blockMaxHeight = new float[w * h];
+		x0 = y0 = 0;
+		x1 = terrainW;
+		y1 = terrainH;
+	}
+
+	//A vertex is shared by the cells at both of its sides
+	int cx0 = x0 - 1, cx1 = x1;
+	int cz0 = y0 - 1, cz1 = y1;
+	CAP(cx0, 0, cells_w - 1);
+	CAP(cx1, 0, cells_w - 1);
+	CAP(cz0, 0, cells_h - 1);
+	CAP(cz1, 0, cells_h - 1);
+
+	for (int bz = cz0 / TERRAIN_RAY_BLOCK; bz <= cz1 / TERRAIN_RAY_BLOCK; bz++)
+	{
+		for (int bx = cx0 / TERRAIN_RAY_BLOCK; bx <= cx1 / TERRAIN_RAY_BLOCK; bx++)
+		{
+			float min_y = FLOAT_INF;
+			float max_y = -FLOAT_INF;
+			int vz_end = Min(bz * TERRAIN_RAY_BLOCK + TERRAIN_RAY_BLOCK, cells_h);
+			int vx_end = Min(bx * TERRAIN_RAY_BLOCK + TERRAIN_RAY_BLOCK, cells_w);
+			for (int vz = bz * TERRAIN_RAY_BLOCK; vz <= vz_end; vz++)
 			{
-				ret = true;
-				if (hit_OUT.distance > distance || hit_OUT.distance == 0)
+				for (int vx = bx * TERRAIN_RAY_BLOCK; vx <= vx_end; vx++)
 				{
-					hit_OUT.distance = distance;
-					hit_OUT.point = hit_point;
-					hit_OUT.normal = triangle.NormalCCW();
+					float y = vertices[vz * terrainW + vx].y;
+					min_y = Min(min_y, y);
+					max_y = Max(max_y, y);
 				}
 			}
+			blockMinHeight[bz * blocksW + bx] = min_y;
+			blockMaxHeight[bz * blocksW + bx] = max_y;
 		}
-		if (ret == true)
+	}
+
+	terrainMinY = FLOAT_INF;
+	terrainMaxY = -FLOAT_INF;
+	for (int n = 0; n < blocksW * blocksH; n++)
+	{
+		terrainMinY = Min(terrainMinY, blockMinHeight[n]);
+		terrainMaxY = Max(terrainMaxY, blockMaxHeight[n]);
+	}
+}
+
+void ModulePhysics3D::DeleteHeightBounds()
+{
+	RELEASE_ARRAY(blockMinHeight);
+	RELEASE_ARRAY(blockMaxHeight);
+	blocksW = blocksH = 0;
+}
+
+void ModulePhysics3D::GetTerrainOccluders(std::vector<float3>& triangles) const
+{
+	if (vertices == nullptr || blockMinHeight == nullptr)
+		return;
+
+	float origin_x = vertices[0].x;
+	float origin_z = vertices[0].z;
+	int cells_w = terrainW - 1;
+	int cells_h = terrainH - 1;
+
+	//Two triangles per height block. Every corner takes the lowest height of the blocks around it,
+	//so the whole quad stays under the cells of its block.
+	std::vector<float> corner_y((blocksW + 1) * (blocksH + 1));
+	for (int cz = 0; cz <= blocksH; cz++)
+	{
+		for (int cx = 0; cx <= blocksW; cx++)
 		{
-			hit_OUT.object = nullptr;
-			hit_OUT.normal.Normalize();
-			return true;
+			float y = FLOAT_INF;
+			for (int bz = Max(cz - 1, 0); bz <= Min(cz, blocksH - 1); bz++)
+				for (int bx = Max(cx - 1, 0); bx <= Min(cx, blocksW - 1); bx++)
+					y = Min(y, blockMinHeight[bz * blocksW + bx]);
+			corner_y[cz * (blocksW + 1) + cx] = y;
 		}
-	}	
-	return false;
+	}
+
+	triangles.reserve(triangles.size() + blocksW * blocksH * 6);
+	for (int bz = 0; bz < blocksH; bz++)
+	{
+		float z0 = origin_z + bz * TERRAIN_RAY_BLOCK;
+		float z1 = origin_z + Min((bz + 1) * TERRAIN_RAY_BLOCK, cells_h);
+		for (int bx = 0; bx < blocksW; bx++)
+		{
+			float x0 = origin_x + bx * TERRAIN_RAY_BLOCK;
+			float x1 = origin_x + Min((bx + 1) * TERRAIN_RAY_BLOCK, cells_w);
+			float3 p00(x0, corner_y[bz * (blocksW + 1) + bx], z0);
+			float3 p10(x1, corner_y[bz * (blocksW + 1) + bx + 1], z0);
+			float3 p01(x0, corner_y[(bz + 1) * (blocksW + 1) + bx], z1);
+			float3 p11(x1, corner_y[(bz + 1) * (blocksW + 1) + bx + 1], z1);
+
+			triangles.push_back(p00); triangles.push_back(p10); triangles.push_back(p11);
+			triangles.push_back(p00); triangles.push_back(p11); triangles.push_back(p01);
+		}
+	}
 }
 
 bool ModulePhysics3D::GenerateHeightmap(string resLibPath)
@@ -1032,6 +1227,7 @@ bool ModulePhysics3D::LoadTextureMap(const char * path)
 				terrainData[n] = vertices[n].y;
 				realTerrainData[n] = terrainData[n] / terrainMaxHeight;
 			}
+			RegenerateHeightBounds(0, 0, terrainW, terrainH);
 
 			RELEASE_ARRAY(normals);
 			bytes = sizeof(float3) * terrainW * terrainH;
@@ -1532,6 +1728,7 @@ void ModulePhysics3D::Sculpt(int x, int y, bool inverse)
 		}
 		ReinterpretVertices();
 		RegenerateNormals(x - brushSize - 1, y - brushSize - 1, x + brushSize + 1, y + brushSize + 1);
+		RegenerateHeightBounds(x - brushSize - 1, y - brushSize - 1, x + brushSize + 1, y + brushSize + 1);
 
 		for (int _y = y - brushSize; _y <= y + brushSize; _y += min(CHUNK_H, brushSize))
 		{
@@ -1663,56 +1860,43 @@ void ModulePhysics3D::AddTriToChunk(const uint& i1, const uint& i2, const uint&
 	it_x->second.AddIndex(i3);
 }
 
-std::vector<chunk> ModulePhysics3D::GetVisibleChunks(ComponentCamera* camera)
+void ModulePhysics3D::GetVisibleChunks(const Frustum& frustum, std::vector<const chunk*>& result) const
 {
-	BROFILER_CATEGORY("ModulePhysics3D::RenderTerrain::Getting visible chunks", Profiler::Color::HoneyDew);
+	BROFILER_CATEGORY("ModulePhysics3D::GetVisibleChunks", Profiler::Color::HoneyDew);
 
-	Frustum frust = camera->GetFrustum();
 	vec corners[8];
-	frust.GetCornerPoints(corners);
+	frustum.GetCornerPoints(corners);
 	AABB frust_box;
 	frust_box.SetNegativeInfinity();
 	frust_box.SetFrom(corners, 8);
 
-	std::vector<chunk> firstPass;
-	for (std::map<int, std::map<int, chunk>>::iterator it_z = chunks.begin(); it_z != chunks.end(); it_z++)
+	//The box of the frustum discards most chunks before the exact test
+	for (std::map<int, std::map<int, chunk>>::const_iterator it_z = chunks.begin(); it_z != chunks.end(); it_z++)
 	{
-		for (std::map<int, chunk>::iterator it_x = it_z->second.begin(); it_x != it_z->second.end(); it_x++)
+		for (std::map<int, chunk>::const_iterator it_x = it_z->second.begin(); it_x != it_z->second.end(); it_x++)
 		{
-			if (it_x->second.GetAABB().Intersects(frust_box))
-			{
-				firstPass.push_back(it_x->second);
-			}
+			AABB box = it_x->second.GetAABB();
+			if (box.Intersects(frust_box) && box.Intersects(frustum))
+				result.push_back(&it_x->second);
 		}
 	}
-
-
-	std::vector<chunk> ret;
-	for (std::vector<chunk>::iterator it = firstPass.begin(); it != firstPass.end(); it++)
-	{
-		if (it->GetAABB().Intersects(frust))
-		{
-			ret.push_back(*it);
-		}
-	}
-	return ret;
 }
 
-void ModulePhysics3D::RenderTerrain(ComponentCamera* camera)
+void ModulePhysics3D::RenderTerrain(ComponentCamera* camera, const std::vector<const chunk*>& visible_chunks)
 {
 	BROFILER_CATEGORY("ModulePhysics3D::RenderTerrain", Profiler::Color::HoneyDew);
 	
 	if (renderFilledTerrain)
 	{
-		RealRenderTerrain(camera, false);
+		RealRenderTerrain(camera, visible_chunks, false);
 	}
 	if (renderWiredTerrain)
 	{
-		RealRenderTerrain(camera, true);
+		RealRenderTerrain(camera, visible_chunks, true);
 	}
 }
 
-void ModulePhysics3D::RealRenderTerrain(ComponentCamera * camera, bool wired)
+void ModulePhysics3D::RealRenderTerrain(ComponentCamera * camera, const std::vector<const chunk*>& visible_chunks, bool wired)
 {
 	if (GetNChunksW() >= 0 && terrainData != nullptr)
 	{
@@ -1932,21 +2116,18 @@ void ModulePhysics3D::RealRenderTerrain(ComponentCamera * camera, bool wired)
 		glBindBuffer(GL_ARRAY_BUFFER, terrainOriginalUvBuffer);
 		glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
 
-		for (std::map<int, std::map<int, chunk>>::iterator it_z = chunks.begin(); it_z != chunks.end(); it_z++)
+		for (std::vector<const chunk*>::const_iterator it = visible_chunks.begin(); it != visible_chunks.end(); it++)
 		{
-			for (std::map<int, chunk>::iterator it_x = it_z->second.begin(); it_x != it_z->second.end(); it_x++)
+			if (renderChunks)
 			{
-				if (renderChunks)
+				(*it)->Render();
+				if (wired)
 				{
-					it_x->second.Render();
-					if (wired)
-					{
-						glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-					}
+					glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 				}
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, it_x->second.GetBuffer());
-				glDrawElements(GL_TRIANGLES, it_x->second.GetNIndices(), GL_UNSIGNED_INT, (void*)0);
 			}
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, (*it)->GetBuffer());
+			glDrawElements(GL_TRIANGLES, (*it)->GetNIndices(), GL_UNSIGNED_INT, (void*)0);
 		}
 
 		glDisableVertexAttribArray(0);
@@ -2065,6 +2246,7 @@ void ModulePhysics3D::GenerateVertices()
 			}
 		}
 		GenerateNormals();
+		RegenerateHeightBounds(0, 0, w, h);
 
 		ReinterpretMesh();
 		ReinterpretHeightmapImg();
@@ -2074,6 +2256,7 @@ void ModulePhysics3D::GenerateVertices()
 void ModulePhysics3D::DeleteVertices()
 {
 	RELEASE_ARRAY(vertices);
+	DeleteHeightBounds();
 	if (terrainVerticesBuffer != 0)
 	{
 		glDeleteBuffers(1, (GLuint*)&terrainVerticesBuffer);
@@ -2587,12 +2770,12 @@ void chunk::GenBuffer()
 	}
 }
 
-int chunk::GetBuffer()
+int chunk::GetBuffer() const
 {
 	return indices_bufferID;
 }
 
-int chunk::GetNIndices()
+int chunk::GetNIndices() const
 {
 	return nIndices;
 }
@@ -2631,7 +2814,7 @@ void chunk::CleanIndices()
 	nIndices = 0;
 }
 
-void chunk::Render()
+void chunk::Render() const
 {
 	App->renderer3D->DrawAABB(aabb.minPoint, aabb.maxPoint, float4(0.674, 0.784, 0.886, 1.0f));
 }
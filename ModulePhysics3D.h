@@ -26,6 +26,8 @@
 #define CHUNK_W 64
 #define CHUNK_H 64
 
+#define TERRAIN_RAY_BLOCK 16 //Cells per side of the min/max height blocks used to skip terrain on raycasts
+
 #define TERRAIN_VERSION 3
 
 class PhysBody3D;
@@ -47,8 +49,8 @@ public:
 	chunk();
 	~chunk();
 
-	int GetBuffer();
-	int GetNIndices();
+	int GetBuffer()const;
+	int GetNIndices()const;
 	const uint* GetIndices();
 
 	void GenBuffer();
@@ -57,9 +59,9 @@ public:
 	void UpdateAABB();
 	void CleanIndices();
 
-	void Render();
+	void Render()const;
 
-	AABB GetAABB() { return aabb; }
+	AABB GetAABB()const { return aabb; }
 	void SetAABB(float3 minPoint, float3 MaxPoint);
 
 	uint* indices = nullptr;
@@ -127,6 +129,7 @@ public:
 	void CreateGround();
 
 	bool RayCast(Ray ray, RaycastHit& hit);
+	void GetTerrainOccluders(std::vector<float3>& triangles)const; //Appends a low-poly version of the terrain that never goes over the real one
 
 	PhysBody3D* AddBody(const Sphere_P& sphere, ComponentCollider* col, float mass = 1.0f, bool is_transparent = false, bool is_trigger = false, TriggerType type = TriggerType::T_ON_TRIGGER );
 	PhysBody3D* AddBody(const Cube_P& cube, ComponentCollider* col, float mass = 1.0f, bool is_transparent = false, bool is_trigger = false, TriggerType type = TriggerType::T_ON_TRIGGER);
@@ -171,11 +174,13 @@ public:
 	uint GetNTextures();
 	float GetTextureScaling() { return textureScaling; }
 
-	void RenderTerrain(ComponentCamera* camera);
+	//Appends the chunks inside the frustum. Only reads the chunks, so cameras can run it in parallel.
+	void GetVisibleChunks(const Frustum& frustum, std::vector<const chunk*>& result)const;
+	void RenderTerrain(ComponentCamera* camera, const std::vector<const chunk*>& visible_chunks);
 
 private:
 
-	void RealRenderTerrain(ComponentCamera* camera, bool wired = false);
+	void RealRenderTerrain(ComponentCamera* camera, const std::vector<const chunk*>& visible_chunks, bool wired = false);
 
 	void AddTerrain();
 	
@@ -192,10 +197,11 @@ private:
 	void DeleteIndices();
 
 	void UpdateChunksAABBs();
+	void RegenerateHeightBounds(int x0, int y0, int x1, int y1);
+	void DeleteHeightBounds();
+	bool RayCastCell(const Ray& ray, int x, int z, float t_enter, float t_exit, RaycastHit& hit_OUT)const;
 	void AddTriToChunk(const uint& i1, const uint& i2, const uint& i3, int& x, int& z);
 
-	std::vector<chunk> GetVisibleChunks(ComponentCamera* camera);
-
 	int GetNChunksW() { return chunks[0].size(); }
 	int GetNChunksH() { return chunks.size(); }
 
@@ -246,6 +252,14 @@ private:
 	float* terrainData = nullptr;
 	float* realTerrainData = nullptr;
 	btHeightfieldTerrainShape* terrain = nullptr;
+
+	//Min/max vertex height of every TERRAIN_RAY_BLOCK x TERRAIN_RAY_BLOCK block of cells. [z * blocksW + x]
+	float* blockMinHeight = nullptr;
+	float* blockMaxHeight = nullptr;
+	int blocksW = 0;
+	int blocksH = 0;
+	float terrainMinY = 0.0f;
+	float terrainMaxY = 0.0f;
 	public:
 	std::vector<std::pair<ResourceFileTexture*, string>> textures;
 	private:
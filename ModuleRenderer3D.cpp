@@ -20,6 +20,7 @@
 #include "Glew\include\glew.h"
 #include <gl/GL.h>
 #include <gl/GLU.h>
+#include <climits>
 
 #include "ModuleWindow.h"
 #include "ModuleCamera3D.h"
@@ -29,13 +30,17 @@
 #include "ComponentCanvas.h"
 #include "ComponentUiText.h"
 #include "ComponentUiButton.h"
+#include "GlyphAtlas.h"
 
 #include "SDL\include\SDL_opengl.h"
 
 #include "ResourceFileMaterial.h"
 #include "ResourceFileRenderTexture.h"
+#include "ShaderComplier.h"
+#include "ShaderReflection.h"
 
 #include "Octree.h"
+#include "JobSystem.h"
 #include "Time.h"
 
 #include "SDL/include/SDL_video.h"
@@ -161,6 +166,18 @@ bool ModuleRenderer3D::Init(Data& config)
 	LOG("OpenGL Version: %s",glGetString(GL_VERSION));
 	LOG("Glew Version: %s", glewGetString(GLEW_VERSION));
 
+	vertex_arrays_supported = (GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object);
+	if (vertex_arrays_supported == false)
+		LOG("Vertex arrays not supported, mesh buffers are set on every draw");
+
+	geometry_arena_supported = vertex_arrays_supported && (GLEW_VERSION_3_2 || (GLEW_ARB_draw_elements_base_vertex && GLEW_ARB_copy_buffer));
+	if (geometry_arena_supported == false)
+		LOG("Base vertex draws not supported, every mesh gets its own buffers");
+
+	multi_draw_supported = geometry_arena_supported && (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+	if (multi_draw_supported == false)
+		LOG("Multi draw indirect not supported, meshes in the geometry arena are drawn one by one");
+
 	// Projection matrix for
 	OnResize(App->window->GetScreenWidth(), App->window->GetScreenHeight(), 60.0f);
 
@@ -192,10 +209,11 @@ update_status ModuleRenderer3D::PreUpdate()
 	for(uint i = 0; i < MAX_LIGHTS; ++i)
 		lights[i].Render();
 
-	objects_to_draw.clear();
 	sprites_to_draw.clear();
 	particles_to_draw.clear();
 
+	geometry_arena.Update();
+
 	return UPDATE_CONTINUE;
 }
 
@@ -204,9 +222,11 @@ update_status ModuleRenderer3D::PostUpdate()
 {
 	BROFILER_CATEGORY("ModuleRenderer3d::PostUpdate", Profiler::Color::MediumOrchid)
 
+	CullScene();
+
 	for (uint i = 0; i < cameras.size(); i++)
 	{
-		DrawScene(cameras[i]);
+		DrawScene(cameras[i], i);
 	}
 
 	glUseProgram(0);
@@ -220,6 +240,13 @@ update_status ModuleRenderer3D::PostUpdate()
 bool ModuleRenderer3D::CleanUp()
 {
 	LOG("Destroying 3D Renderer");
+	if (instance_buffer != 0)
+		glDeleteBuffers(1, &instance_buffer);
+	if (indirect_buffer != 0)
+		glDeleteBuffers(1, &indirect_buffer);
+	if (ui_text_buffer != 0)
+		glDeleteBuffers(1, &ui_text_buffer);
+	geometry_arena.CleanUp();
 	ImGui_ImplSdlGL3_Shutdown();
 	SDL_GL_DeleteContext(context);
 
@@ -281,15 +308,6 @@ void ModuleRenderer3D::AddCamera(ComponentCamera* camera)
 	}
 }
 
-void ModuleRenderer3D::AddToDraw(GameObject* obj)
-{
-	if (obj)
-	{
-		if(obj->IsStatic() == false)
-			objects_to_draw.push_back(obj);
-	}
-}
-
 void ModuleRenderer3D::AddToDrawSprite(ComponentSprite * sprite)
 {
 	if (sprite) sprites_to_draw.push_back(sprite);
@@ -300,252 +318,415 @@ void ModuleRenderer3D::AddToDrawParticle(ComponentParticleSystem * particle_sys)
 	if (particle_sys) particles_to_draw.push_back(particle_sys);
 }
 
-void ModuleRenderer3D::DrawScene(ComponentCamera* cam, bool has_render_tex)
+void ModuleRenderer3D::CullScene()
 {
-	BROFILER_CATEGORY("ModuleRenderer3D::DrawScene", Profiler::Color::NavajoWhite);
-
-	glViewport(cam->viewport_position.x, cam->viewport_position.y, cam->viewport_size.x, cam->viewport_size.y);
+	BROFILER_CATEGORY("ModuleRenderer3D::CullScene", Profiler::Color::NavajoWhite);
 
-	glLoadIdentity();
+	culler.ClearFrustums();
+	for (uint i = 0; i < cameras.size(); i++)
+		culler.AddFrustum(cameras[i]->GetFrustum());
 
-	UpdateProjectionMatrix(cam);
+	//Broadphase: everything that any camera could see
+	culling_candidates.clear();
+	App->go_manager->octree.Intersect(culling_candidates, culler);
+	num_static_candidates = culling_candidates.size();
+	App->go_manager->dynamic_tree.Intersect(culling_candidates, culler);
 
-	int layer_mask = cam->GetLayerMask();
+	//Exact test of every candidate against every camera in one pass
+	culler.ClearBoxes();
+	for (vector<GameObject*>::const_iterator obj = culling_candidates.begin(); obj != culling_candidates.end(); ++obj)
+		culler.AddBox(*(*obj)->bounding_box);
+	culler.Cull();
 
-	//Draw UI
-	if (App->go_manager->current_scene_canvas != nullptr)
+	camera_stats.resize(cameras.size());
+	for (uint i = 0; i < cameras.size(); i++)
 	{
-		vector<GameObject*> ui_objects = App->go_manager->current_scene_canvas->GetUI();
-		for (vector<GameObject*>::const_iterator obj = ui_objects.begin(); obj != ui_objects.end(); ++obj)
-		{
-			if (layer_mask == (layer_mask | (1 << (*obj)->layer)))
-			{
-				if ((*obj)->GetComponent(C_UI_IMAGE) || (*obj)->GetComponent(C_UI_BUTTON))
-					DrawUIImage(*obj);
-				else if ((*obj)->GetComponent(C_UI_TEXT))
-					DrawUIText(*obj);
-			}
-					
-		}
+		camera_stats[i] = CameraRenderStats();
+		camera_stats[i].camera = cameras[i];
 	}
 
-	if (cam->renderTerrain)
+	if (occlusion_culling)
+		OcclusionCull();
+
+	for (uint i = 0; i < cameras.size(); i++)
+		camera_stats[i].visible = culler.NumVisible(i);
+
+	ComputeVisibility();
+}
+
+void ModuleRenderer3D::ComputeVisibility()
+{
+	BROFILER_CATEGORY("ModuleRenderer3D::ComputeVisibility", Profiler::Color::NavajoWhite);
+
+	JobSystem* jobs = App->job_system;
+	visibility.resize(cameras.size());
+
+	//Shared by every camera: the UI list and the bounds of the particle systems
+	Job* shared = jobs->CreateJob("ModuleRenderer3D::SharedVisibility", nullptr);
+	jobs->Run(jobs->CreateJob("ModuleRenderer3D::GatherUI", [this]()
 	{
-		App->physics->RenderTerrain(cam);
-	}
-	if (has_render_tex)
+		ui_objects.clear();
+		if (App->go_manager->current_scene_canvas != nullptr)
+			ui_objects = App->go_manager->current_scene_canvas->GetUI();
+	}, shared));
+	particle_boxes.resize(particles_to_draw.size());
+	jobs->Run(jobs->CreateJob("ModuleRenderer3D::ParticleBounds", [this]()
 	{
-		cam->render_texture->Bind();
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	}
-	map<float, GameObject*> alpha_objects;
-	
-	//Draw Static GO
-	vector<GameObject*> static_objects;
-	App->go_manager->octree.Intersect(static_objects, *cam); //Culling for static objects
+		for (uint i = 0; i < particles_to_draw.size(); i++)
+			particle_boxes[i] = particles_to_draw[i]->GetBoundingBox();
+	}, shared));
+	jobs->Run(shared);
+	jobs->Wait(shared);
 
-	for (vector<GameObject*>::iterator obj = static_objects.begin(); obj != static_objects.end(); ++obj)
+	jobs->ParallelFor("ModuleRenderer3D::CameraVisibility", cameras.size(), 1, [this](unsigned int begin, unsigned int end)
 	{
-		if ((*obj)->IsActive())
-		{
-			if (layer_mask == (layer_mask | (1 << (*obj)->layer)))
-			{
-				pair<float, GameObject*> alpha_object;
-				Draw(*obj, App->lighting->GetLightInfo(), cam, alpha_object);
-				if (alpha_object.second != nullptr)
-				{
-					alpha_objects.insert(alpha_object);
-				}
-			}
-				
-		}
-	}
+		for (unsigned int i = begin; i < end; i++)
+			GatherVisibility(i);
+	});
+}
+
+void ModuleRenderer3D::GatherVisibility(unsigned int cam_index)
+{
+	ComponentCamera* cam = cameras[cam_index];
+	CameraVisibility& vis = visibility[cam_index];
+	int layer_mask = cam->GetLayerMask();
+	Frustum frustum = cam->GetFrustum();
 
-	//Draw dynamic GO
-	for (vector<GameObject*>::const_iterator obj = objects_to_draw.begin(); obj != objects_to_draw.end(); ++obj)
+	vis.static_objects.clear();
+	vis.dynamic_objects.clear();
+	for (uint i = 0; i < culling_candidates.size(); ++i)
 	{
-		if (cam->Intersects(*(*obj)->bounding_box))
+		GameObject* obj = culling_candidates[i];
+		//Only the meshes updated this frame have a mesh to draw
+		if (culler.IsVisible(cam_index, i) && obj->GetMeshToDraw() != nullptr && obj->IsActive() && layer_mask == (layer_mask | (1 << obj->layer)))
 		{
-			if (layer_mask == (layer_mask | (1 << (*obj)->layer)))
-			{
-				pair<float, GameObject*> alpha_object;
-				Draw(*obj, App->lighting->GetLightInfo(), cam, alpha_object);
-				if (alpha_object.second != nullptr)
-				{
-					alpha_objects.insert(alpha_object);
-				}
-			}
+			if (i < num_static_candidates)
+				vis.static_objects.push_back(obj);
+			else
+				vis.dynamic_objects.push_back(obj);
 		}
 	}
 
-	std::multimap<float, GameObject*>::reverse_iterator it = alpha_objects.rbegin();
-	for (; it != alpha_objects.rend(); it++)
+	vis.ui.clear();
+	for (vector<GameObject*>::const_iterator obj = ui_objects.begin(); obj != ui_objects.end(); ++obj)
+		if (layer_mask == (layer_mask | (1 << (*obj)->layer)))
+			vis.ui.push_back(*obj);
+
+	vis.terrain_chunks.clear();
+	if (cam->renderTerrain)
+		App->physics->GetVisibleChunks(frustum, vis.terrain_chunks);
+
+	vis.particles.clear();
+	for (uint i = 0; i < particles_to_draw.size(); i++)
+		if (particle_boxes[i].IsFinite() && frustum.Intersects(particle_boxes[i]))
+			vis.particles.push_back(particles_to_draw[i]);
+}
+
+void ModuleRenderer3D::OcclusionCull()
+{
+	BROFILER_CATEGORY("ModuleRenderer3D::OcclusionCull", Profiler::Color::NavajoWhite);
+
+	//Occluders: the terrain and the static meshes flagged as occluders
+	occlusion.ClearOccluders();
+	occluder_points.clear();
+	App->physics->GetTerrainOccluders(occluder_points);
+	occlusion.AddOccluder(occluder_points.data(), occluder_points.size() / 3, OCCLUSION_TERRAIN_MASK);
+
+	const vector<Component*>& meshes = App->go_manager->GetComponentsOfType(C_MESH, true);
+	for (vector<Component*>::const_iterator it = meshes.begin(); it != meshes.end(); ++it)
 	{
-		pair<float, GameObject*> alpha_object;
-		Draw(it->second, App->lighting->GetLightInfo(),cam, alpha_object,true);
+		ComponentMesh* c_mesh = (ComponentMesh*)(*it);
+		const Mesh* mesh = c_mesh->GetMesh();
+		GameObject* go = c_mesh->GetGameObject();
+		if (c_mesh->occluder == false || mesh == nullptr || mesh->indices == nullptr || go->IsStatic() == false || go->layer < 0 || go->layer > 30)
+			continue;
+
+		float4x4 global = go->GetGlobalMatrix();
+		const float3* vertices = (const float3*)mesh->vertices;
+		occluder_points.clear();
+		for (uint i = 0; i < mesh->num_indices; i++)
+			occluder_points.push_back(global.TransformPos(vertices[mesh->indices[i]]));
+		occlusion.AddOccluder(occluder_points.data(), occluder_points.size() / 3, 1u << go->layer);
 	}
-	alpha_objects.clear();
 
-	DrawSprites(cam);
+	if (occlusion.NumOccluderTriangles() == 0)
+		return;
 
-	DrawParticles(cam);
+	for (uint c = 0; c < cameras.size(); c++)
+	{
+		unsigned int mask = (unsigned int)cameras[c]->GetLayerMask();
+		if (cameras[c]->renderTerrain && App->physics->renderFilledTerrain)
+			mask |= OCCLUSION_TERRAIN_MASK;
 
-	App->editor->skybox.Render(cam);
+		occlusion.Render(cameras[c]->GetFrustum(), mask);
+		camera_stats[c].occluder_triangles = occlusion.NumRenderedTriangles();
+		if (occlusion.NumRenderedTriangles() == 0)
+			continue;
 
-	if(has_render_tex)
-		cam->render_texture->Unbind();
+		for (uint i = 0; i < culling_candidates.size(); i++)
+		{
+			if (culler.IsVisible(c, i) && occlusion.IsOccluded(*culling_candidates[i]->bounding_box))
+			{
+				culler.Hide(c, i);
+				++camera_stats[c].occluded;
+			}
+		}
+	}
 }
 
-
-void ModuleRenderer3D::Draw(GameObject* obj, const LightInfo& light, ComponentCamera* cam, pair<float, GameObject*>& alpha_object, bool alpha_render) const
+const CameraRenderStats* ModuleRenderer3D::GetRenderStats(const ComponentCamera* camera) const
 {
+	for (uint i = 0; i < camera_stats.size(); i++)
+		if (camera_stats[i].camera == camera)
+			return &camera_stats[i];
+	return nullptr;
+}
 
-	ComponentMaterial* material = (ComponentMaterial*)obj->GetComponent(C_MATERIAL);
+GeometryArena* ModuleRenderer3D::GetGeometryArena()
+{
+	return &geometry_arena;
+}
 
-	if (material == nullptr)
-		return;
+bool ModuleRenderer3D::IsMultiDrawSupported() const
+{
+	return multi_draw_supported;
+}
 
-	ComponentMesh* c_mesh = (ComponentMesh*)obj->GetComponent(C_MESH);
-	if (c_mesh->HasBones())
-	{
-		DrawAnimated(obj, light, cam, alpha_object, alpha_render);
-		return;
-	}
+bool ModuleRenderer3D::AreVertexArraysSupported() const
+{
+	return vertex_arrays_supported;
+}
 
-	BROFILER_CATEGORY("ModuleRenderer3D::Draw", Profiler::Color::YellowGreen);
+bool ModuleRenderer3D::IsGeometryArenaSupported() const
+{
+	return geometry_arena_supported;
+}
 
-	uint shader_id = 0;
-	float4 color = { 1.0f,1.0f,1.0f,1.0f };
-	color = float4(material->color);
+void ModuleRenderer3D::DrawScene(ComponentCamera* cam, unsigned int cam_index, bool has_render_tex)
+{
+	BROFILER_CATEGORY("ModuleRenderer3D::DrawScene", Profiler::Color::NavajoWhite);
 
-	if (material->rc_material)
-		shader_id = material->rc_material->GetShaderId();
-	else
-		shader_id = App->resource_manager->GetDefaultShaderId();
+	glViewport(cam->viewport_position.x, cam->viewport_position.y, cam->viewport_size.x, cam->viewport_size.y);
 
-	bool ret_alpha = SetShaderAlpha(material, cam, obj, alpha_object, alpha_render);
-	if (ret_alpha == false)
-		return;
-	
-	//Use shader
-	glUseProgram(shader_id);
+	glLoadIdentity();
 
-	SetShaderUniforms(shader_id, obj, cam, material, light, color);
+	UpdateProjectionMatrix(cam);
 
-	//Buffer vertices == 0
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, obj->mesh_to_draw->id_vertices);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+	const CameraVisibility& vis = visibility[cam_index];
 
-	//Buffer uvs == 1
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, obj->mesh_to_draw->id_uvs);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+	//Draw UI. Consecutive texts are batched, an image in between keeps the draw order.
+	ui_text_draws = 0;
+	for (vector<GameObject*>::const_iterator obj = vis.ui.begin(); obj != vis.ui.end(); ++obj)
+	{
+		if ((*obj)->HasComponent(C_UI_IMAGE) || (*obj)->HasComponent(C_UI_BUTTON))
+		{
+			FlushUIText();
+			DrawUIImage(*obj);
+		}
+		else if ((*obj)->HasComponent(C_UI_TEXT))
+			QueueUIText(*obj);
+	}
+	FlushUIText();
+	camera_stats[cam_index].ui_text_draws = ui_text_draws;
 
-	//Buffer normals == 2
-	glEnableVertexAttribArray(2);
-	glBindBuffer(GL_ARRAY_BUFFER, obj->mesh_to_draw->id_normals);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+	if (cam->renderTerrain)
+	{
+		App->physics->RenderTerrain(cam, vis.terrain_chunks);
+	}
+	if (has_render_tex)
+	{
+		cam->render_texture->Bind();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+	//Record the draws of the visible GO of this camera, then submit them sorted by state
+	render_queue.Clear();
+	for (vector<GameObject*>::const_iterator obj = vis.static_objects.begin(); obj != vis.static_objects.end(); ++obj)
+		QueueObject(*obj, cam);
+	for (vector<GameObject*>::const_iterator obj = vis.dynamic_objects.begin(); obj != vis.dynamic_objects.end(); ++obj)
+		QueueObject(*obj, cam);
+	render_queue.Sort();
+	DrawRenderQueue(cam, App->lighting->GetLightInfo());
+	camera_stats[cam_index].queue = render_state.GetStats();
 
-	//Buffer tangents == 3
-	glEnableVertexAttribArray(3);
-	glBindBuffer(GL_ARRAY_BUFFER, obj->mesh_to_draw->id_tangents);
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+	DrawSprites(cam);
 
-	//Index buffer
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, obj->mesh_to_draw->id_indices);
-	glDrawElements(GL_TRIANGLES, obj->mesh_to_draw->num_indices, GL_UNSIGNED_INT, (void*)0);
+	DrawParticles(cam, vis.particles);
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-	glDisableVertexAttribArray(3);
+	App->editor->skybox.Render(cam);
 
-	glDisable(GL_ALPHA_TEST);
-	glDisable(GL_BLEND);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	if(has_render_tex)
+		cam->render_texture->Unbind();
 }
 
-void ModuleRenderer3D::DrawAnimated(GameObject * obj, const LightInfo & light, ComponentCamera * cam, std::pair<float, GameObject*>& alpha_object, bool alpha_render)const
+
+void ModuleRenderer3D::QueueObject(GameObject* obj, ComponentCamera* cam)
 {
-	BROFILER_CATEGORY("ModuleRenderer3D::DrawAnimated", Profiler::Color::YellowGreen);
 	ComponentMaterial* material = (ComponentMaterial*)obj->GetComponent(C_MATERIAL);
 
 	if (material == nullptr)
 		return;
 
-	ComponentMesh* c_mesh = (ComponentMesh*)obj->GetComponent(C_MESH);
-
-	float4 color = { 1.0f,1.0f,1.0f,1.0f };
-	color = float4(material->color);
+	DrawItem item;
+	item.obj = obj;
+	item.material = material;
+	item.c_mesh = (ComponentMesh*)obj->GetComponent(C_MESH);
+	item.mesh = obj->GetMeshToDraw();
+	item.animated = item.c_mesh->HasBones();
 
-	uint shader_id = 0;
 	if (material->rc_material)
-		shader_id = material->rc_material->GetShaderId();
+		item.shader_id = material->rc_material->GetShaderId();
+	else if (item.animated)
+		item.shader_id = App->resource_manager->GetDefaultAnimShaderId();
+	else if (instancing)
+	{
+		//Objects with the same mesh and material end up together in the queue and are drawn with one call
+		item.shader_id = App->resource_manager->GetDefaultInstancedShaderId();
+		item.instanced = true;
+	}
 	else
-		shader_id = App->resource_manager->GetDefaultAnimShaderId();
+		item.shader_id = App->resource_manager->GetDefaultShaderId();
 
-	bool ret_alpha = SetShaderAlpha(material, cam, obj, alpha_object, alpha_render);
-	if (ret_alpha == false)
-		return;
+	switch (material->alpha)
+	{
+	case (2):
+		item.pass = RENDER_PASS_TRANSPARENT;
+		break;
+	case (1):
+		item.pass = RENDER_PASS_ALPHA_TEST;
+		break;
+	default:
+		item.pass = RENDER_PASS_OPAQUE;
+		break;
+	}
 
-	//Use shader
-	glUseProgram(shader_id);
+	render_queue.Add(item, cam->GetPos().Distance(obj->bounding_box->CenterPoint()));
+}
 
-	
-	SetShaderUniforms(shader_id, obj, cam, material, light, color);
+void ModuleRenderer3D::DrawRenderQueue(ComponentCamera* cam, const LightInfo& light)
+{
+	BROFILER_CATEGORY("ModuleRenderer3D::DrawRenderQueue", Profiler::Color::YellowGreen);
 
-	//Array of bone transformations
-	GLint bone_location = glGetUniformLocation(shader_id, "bones");
-	glUniformMatrix4fv(bone_location, c_mesh->bones_trans.size(), GL_FALSE, reinterpret_cast<GLfloat*>(c_mesh->bones_trans.data()));
+	bool use_multi_draw = (multi_draw && multi_draw_supported);
 
+	//Model matrices of the instanced items, in the order they are submitted.
+	//Each run of instances of a mesh in the arena gets a draw command that reads its matrices from base_instance.
+	instance_matrices.clear();
+	indirect_commands.clear();
+	for (uint i = 0; i < render_queue.Count();)
+	{
+		const DrawItem& item = render_queue.Get(i);
+		uint instances = render_queue.CountInstances(i);
+		if (item.instanced)
+		{
+			if (use_multi_draw && item.mesh->in_arena)
+			{
+				DrawIndirectCommand command;
+				command.count = item.mesh->num_indices;
+				command.instance_count = instances;
+				command.first_index = item.mesh->first_index;
+				command.base_vertex = item.mesh->base_vertex;
+				command.base_instance = instance_matrices.size();
+				indirect_commands.push_back(command);
+			}
+			for (uint j = 0; j < instances; j++)
+				instance_matrices.push_back(render_queue.Get(i + j).obj->GetGlobalMatrix().Transposed());
+		}
+		i += instances;
+	}
 
-	//Buffer vertices == 0
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, obj->mesh_to_draw->id_vertices);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+	if (instance_matrices.empty() == false)
+	{
+		if (instance_buffer == 0)
+			glGenBuffers(1, &instance_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float4x4) * instance_matrices.size(), instance_matrices.data(), GL_STREAM_DRAW);
+	}
 
-	//Buffer uvs == 1
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, obj->mesh_to_draw->id_uvs);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+	if (indirect_commands.empty() == false)
+	{
+		if (indirect_buffer == 0)
+			glGenBuffers(1, &indirect_buffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawIndirectCommand) * indirect_commands.size(), indirect_commands.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
 
-	//Buffer normals == 2
-	glEnableVertexAttribArray(2);
-	glBindBuffer(GL_ARRAY_BUFFER, obj->mesh_to_draw->id_normals);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+	//Terrain, UI and the previous camera changed the state behind the cache
+	render_state.Reset();
 
-	//Buffer tangents == 3
+	const ShaderReflection* shader = nullptr;
+	uint current_material = UINT_MAX;
+	uint instance_cursor = 0;
+	uint command_cursor = 0;
+	for (uint i = 0; i < render_queue.Count();)
+	{
+		const DrawItem& item = render_queue.Get(i);
+		uint instances = render_queue.CountInstances(i);
+		uint commands = 0;
+		if (use_multi_draw && item.instanced && item.mesh->in_arena)
+			instances = render_queue.CountMultiDraw(i, commands);
 
-	glEnableVertexAttribArray(3);
-	glBindBuffer(GL_ARRAY_BUFFER, obj->mesh_to_draw->id_tangents);
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
-		
+		if (render_state.UseProgram(item.shader_id))
+		{
+			shader = ShaderCompiler::GetReflection(item.shader_id);
+			ShaderCameraUniforms(shader, cam);
+			ShaderLightUniforms(shader, light);
+			current_material = UINT_MAX;
+		}
 
-	//Buffer bones id == 4
-	glEnableVertexAttribArray(4);
-	glBindBuffer(GL_ARRAY_BUFFER, c_mesh->bone_id);
-	glVertexAttribIPointer(4, 4, GL_INT, 0, (GLvoid*)0);
+		//Materials with the same id set the same state, the first item of a run sets it for all
+		if (item.material_id != current_material)
+		{
+			SetMaterialAlpha(item.material);
+			ShaderTexturesUniforms(shader, item.material);
+			ShaderCustomUniforms(shader, item.material);
+			ShaderMaterialUniforms(shader, item.material);
+			render_state.CountMaterialChange();
+			current_material = item.material_id;
+		}
 
-	//Buffer weights == 5
-	glEnableVertexAttribArray(5);
-	glBindBuffer(GL_ARRAY_BUFFER, c_mesh->weight_id);
-	glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+		if (item.instanced == false)
+			glUniformMatrix4fv(shader->GetLocation(SLOT_MODEL), 1, GL_FALSE, *(item.obj->GetGlobalMatrix().Transposed()).v);
 
-	//Index buffer
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, obj->mesh_to_draw->id_indices);
-	glDrawElements(GL_TRIANGLES, obj->mesh_to_draw->num_indices, GL_UNSIGNED_INT, (void*)0);
+		//Vertices == 0, uvs == 1, normals == 2, tangents == 3 and the index buffer are in the vertex array of the mesh
+		render_state.BindMesh(*item.mesh);
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-	glDisableVertexAttribArray(3);
-	glDisableVertexAttribArray(4);
-	glDisableVertexAttribArray(5);
+		if (item.animated)
+		{
+			//Array of bone transformations
+			glUniformMatrix4fv(shader->GetLocation(SLOT_BONES), item.c_mesh->bones_trans.size(), GL_FALSE, reinterpret_cast<GLfloat*>(item.c_mesh->bones_trans.data()));
+
+			//Buffer bones id == 4, weights == 5. Per object, so they leave the vertex array after the draw.
+			render_state.VertexAttrib(4, item.c_mesh->bone_id, 4, GL_INT, true);
+			render_state.VertexAttrib(5, item.c_mesh->weight_id, 4, GL_FLOAT);
+			render_state.DrawMesh(*item.mesh);
+			render_state.DisableAttribs(0x30);
+		}
+		else if (item.instanced)
+		{
+			//Model matrix == 6 to 9, one per instance
+			if (commands > 0)
+			{
+				//Every mesh of the arena with this material in one call. base_instance of each command picks its matrices.
+				render_state.InstanceMatrixAttrib(6, instance_buffer, 0);
+				render_state.MultiDrawIndirect(indirect_buffer, command_cursor, commands, item.mesh->index_size, instances);
+				command_cursor += commands;
+			}
+			else
+			{
+				render_state.InstanceMatrixAttrib(6, instance_buffer, instance_cursor * sizeof(float4x4));
+				render_state.DrawMeshInstanced(*item.mesh, instances);
+			}
+			render_state.DisableAttribs(0x3C0);
+			instance_cursor += instances;
+		}
+		else
+			render_state.DrawMesh(*item.mesh);
 
-	glDisable(GL_ALPHA_TEST);
-	glDisable(GL_BLEND);
-	glBindTexture(GL_TEXTURE_2D, 0);
+		i += instances;
+	}
+
+	render_state.Finish();
 }
 
 void ModuleRenderer3D::DrawSprites(ComponentCamera* cam) const
@@ -609,7 +790,7 @@ void ModuleRenderer3D::DrawSprites(ComponentCamera* cam) const
 	
 }
 
-void ModuleRenderer3D::DrawParticles(ComponentCamera * cam) const
+void ModuleRenderer3D::DrawParticles(ComponentCamera * cam, const std::vector<ComponentParticleSystem*>& particles) const
 {
 	unsigned int shader_id = App->resource_manager->GetDefaultParticleShaderId();
 	glUseProgram(shader_id);
@@ -636,7 +817,7 @@ void ModuleRenderer3D::DrawParticles(ComponentCamera * cam) const
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	
-	for (vector<ComponentParticleSystem*>::const_iterator particle = particles_to_draw.begin(); particle != particles_to_draw.end(); ++particle)
+	for (vector<ComponentParticleSystem*>::const_iterator particle = particles.begin(); particle != particles.end(); ++particle)
 	{
 		(*particle)->SortParticles(cam);
 
@@ -705,77 +886,61 @@ void ModuleRenderer3D::DrawParticles(ComponentCamera * cam) const
 	glDisable(GL_BLEND);
 }
 
-bool ModuleRenderer3D::SetShaderAlpha(ComponentMaterial* material, ComponentCamera* cam, GameObject* obj, std::pair<float, GameObject*>& alpha_object, bool alpha_render) const
+void ModuleRenderer3D::ShaderCameraUniforms(const ShaderReflection* shader, ComponentCamera* cam) const
 {
-	BROFILER_CATEGORY("ModuleRenderer3D::SetShaderAlpha", Profiler::Color::Fuchsia);
-	if (material->alpha == 2 && alpha_render == false)
+	glUniformMatrix4fv(shader->GetLocation(SLOT_PROJECTION), 1, GL_FALSE, *cam->GetProjectionMatrix().v);
+	glUniformMatrix4fv(shader->GetLocation(SLOT_VIEW), 1, GL_FALSE, *cam->GetViewMatrix().v);
+
+	//Time(special)
+	GLint time_location = shader->GetLocation(SLOT_TIME);
+	if (time_location != -1)
 	{
-		float distance = cam->GetProjectionMatrix().TranslatePart().Distance(obj->transform->GetPosition());
-		alpha_object = pair<float, GameObject*>(distance, obj);
-		return false;
+		glUniform1f(time_location, time->RealTimeSinceStartup());
 	}
+	//EyeWorld
+	GLint eye_world_pos = shader->GetLocation(SLOT_EYE_WORLD_POS);
+	if (eye_world_pos != -1)
+		glUniform3fv(eye_world_pos, 1, cam->GetPos().ptr());
+}
 
+void ModuleRenderer3D::SetMaterialAlpha(ComponentMaterial* material)
+{
 	switch (material->alpha)
 	{
 	case (2):
-	{
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, material->blend_type);
-	}
+		render_state.SetBlend(true, material->blend_type);
+		render_state.SetAlphaTest(true, material->alpha_test);
+		break;
 	case (1):
-	{
-		glEnable(GL_ALPHA_TEST);
-		glAlphaFunc(GL_GREATER, material->alpha_test);
+		render_state.SetBlend(false);
+		render_state.SetAlphaTest(true, material->alpha_test);
+		break;
+	default:
+		render_state.SetBlend(false);
+		render_state.SetAlphaTest(false);
 		break;
 	}
-	}
-
-	return true;
-}
-
-void ModuleRenderer3D::SetShaderUniforms(unsigned int shader_id, GameObject* obj, ComponentCamera* cam, ComponentMaterial* material, const LightInfo& light, const float4& color) const
-{
-	BROFILER_CATEGORY("ModuleRenderer3D::SetShaderUniforms", Profiler::Color::Fuchsia);
-	ShaderMVPUniforms(shader_id, obj, cam);
-
-	ShaderTexturesUniforms(shader_id, material);
-
-	ShaderLightUniforms(shader_id, light);
-
-	ShaderCustomUniforms(shader_id, material);
-
-	ShaderBuiltInUniforms(shader_id, cam, material, color);
 }
 
-void ModuleRenderer3D::ShaderMVPUniforms(unsigned int shader_id, GameObject* obj, ComponentCamera* cam) const
+void ModuleRenderer3D::ShaderTexturesUniforms(const ShaderReflection* shader, ComponentMaterial* material)
 {
-	GLint model_location = glGetUniformLocation(shader_id, "model");
-	glUniformMatrix4fv(model_location, 1, GL_FALSE, *(obj->GetGlobalMatrix().Transposed()).v);
-	GLint projection_location = glGetUniformLocation(shader_id, "projection");
-	glUniformMatrix4fv(projection_location, 1, GL_FALSE, *cam->GetProjectionMatrix().v);
-	GLint view_location = glGetUniformLocation(shader_id, "view");
-	glUniformMatrix4fv(view_location, 1, GL_FALSE, *cam->GetViewMatrix().v);
-}
-
-void ModuleRenderer3D::ShaderTexturesUniforms(unsigned int shader_id, ComponentMaterial* material) const
-{
-	GLint alpha_location = glGetUniformLocation(shader_id, "_alpha_val");
+	GLint alpha_location = shader->GetLocation(SLOT_ALPHA_VAL);
 	if (alpha_location != -1)
 	{
 		glUniform1f(alpha_location, material->alpha_test);
 	}
+
+	const vector<int>& locations = material->GetTextureLocations(shader);
 	int count = 0;
-	for (map<string, uint>::iterator tex = material->texture_ids.begin(); tex != material->texture_ids.end(); ++tex)
+	uint index = 0;
+	for (map<string, uint>::iterator tex = material->texture_ids.begin(); tex != material->texture_ids.end(); ++tex, ++index)
 	{
 		//Default first texture diffuse (if no specified)
 		if ((*tex).first.compare("0") == 0 && count == 0 && (*tex).second != 0)
 		{
-			GLint has_tex_location = glGetUniformLocation(shader_id, "_HasTexture");
-			glUniform1i(has_tex_location, 1);
-			GLint texture_location = glGetUniformLocation(shader_id, "_Texture");
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, (*tex).second);
-			glUniform1i(texture_location, 0);
+			glUniform1i(shader->GetLocation(SLOT_HAS_TEXTURE), 1);
+			render_state.BindTexture(0, (*tex).second);
+			glUniform1i(shader->GetLocation(SLOT_TEXTURE), 0);
 			count++;
 			continue;
 		}
@@ -783,21 +948,17 @@ void ModuleRenderer3D::ShaderTexturesUniforms(unsigned int shader_id, ComponentM
 		//Default second texture normal (if no specified)
 		if ((*tex).first.compare("1") == 0 && count == 1 && (*tex).second != 0)
 		{
-			GLint has_normal_location = glGetUniformLocation(shader_id, "_HasNormalMap");
-			glUniform1i(has_normal_location, 1);
-			GLint texture_location = glGetUniformLocation(shader_id, "_NormalMap");
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, (*tex).second);
-			glUniform1i(texture_location, 1);
+			glUniform1i(shader->GetLocation(SLOT_HAS_NORMAL_MAP), 1);
+			render_state.BindTexture(1, (*tex).second);
+			glUniform1i(shader->GetLocation(SLOT_NORMAL_MAP), 1);
 			count++;
 			continue;
 		}
 
-		GLint tex_location = glGetUniformLocation(shader_id, (*tex).first.data());
+		GLint tex_location = locations[index];
 		if (tex_location != -1)
 		{
-			glActiveTexture(GL_TEXTURE0 + count);
-			glBindTexture(GL_TEXTURE_2D, (*tex).second);
+			render_state.BindTexture(count, (*tex).second);
 			glUniform1i(tex_location, count);
 			++count;
 		}
@@ -806,93 +967,92 @@ void ModuleRenderer3D::ShaderTexturesUniforms(unsigned int shader_id, ComponentM
 	//Reset Texture and Normal if doesn't have
 	if (material->texture_ids.size() < 2)
 	{
-		GLint has_normal_location = glGetUniformLocation(shader_id, "_HasNormalMap");
-		glUniform1i(has_normal_location, 0);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		glUniform1i(shader->GetLocation(SLOT_HAS_NORMAL_MAP), 0);
+		render_state.BindTexture(1, 0);
 	}
 
 	if (material->texture_ids.empty() == true)
 	{
-		GLint has_tex_location = glGetUniformLocation(shader_id, "_HasTexture");
-		glUniform1i(has_tex_location, 0);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		glUniform1i(shader->GetLocation(SLOT_HAS_TEXTURE), 0);
+		render_state.BindTexture(0, 0);
 	}
 }
 
-void ModuleRenderer3D::ShaderLightUniforms(unsigned int shader_id, const LightInfo& light) const
+void ModuleRenderer3D::ShaderLightUniforms(const ShaderReflection* shader, const LightInfo& light) const
 {
 	//Ambient
-	GLint ambient_intensity_location = glGetUniformLocation(shader_id, "_AmbientIntensity");
+	GLint ambient_intensity_location = shader->GetLocation(SLOT_AMBIENT_INTENSITY);
 	if (ambient_intensity_location != -1)
 		glUniform1f(ambient_intensity_location, light.ambient_intensity);
-	GLint ambient_color_location = glGetUniformLocation(shader_id, "_AmbientColor");
+	GLint ambient_color_location = shader->GetLocation(SLOT_AMBIENT_COLOR);
 	if (ambient_color_location != -1)
 		glUniform3f(ambient_color_location, light.ambient_color.x, light.ambient_color.y, light.ambient_color.z);
 
 	//Directional
-	GLint has_directional_location = glGetUniformLocation(shader_id, "_HasDirectional");
-	glUniform1i(has_directional_location, light.has_directional);
+	glUniform1i(shader->GetLocation(SLOT_HAS_DIRECTIONAL), light.has_directional);
 
 	if (light.has_directional)
 	{
-		GLint directional_intensity_location = glGetUniformLocation(shader_id, "_DirectionalIntensity");
+		GLint directional_intensity_location = shader->GetLocation(SLOT_DIRECTIONAL_INTENSITY);
 		if (directional_intensity_location != -1)
 			glUniform1f(directional_intensity_location, light.directional_intensity);
-		GLint directional_color_location = glGetUniformLocation(shader_id, "_DirectionalColor");
+		GLint directional_color_location = shader->GetLocation(SLOT_DIRECTIONAL_COLOR);
 		if (directional_color_location != -1)
 			glUniform3f(directional_color_location, light.directional_color.x, light.directional_color.y, light.directional_color.z);
-		GLint directional_direction_location = glGetUniformLocation(shader_id, "_DirectionalDirection");
+		GLint directional_direction_location = shader->GetLocation(SLOT_DIRECTIONAL_DIRECTION);
 		if (directional_direction_location != -1)
 			glUniform3f(directional_direction_location, light.directional_direction.x, light.directional_direction.y, light.directional_direction.z);
 	}
 }
 
-void ModuleRenderer3D::ShaderCustomUniforms(unsigned int shader_id, ComponentMaterial* material) const
+void ModuleRenderer3D::ShaderCustomUniforms(const ShaderReflection* shader, ComponentMaterial* material) const
 {
-	if (material->rc_material)
+	//Only the material the program belongs to has its uniforms resolved
+	if (material->rc_material && material->rc_material->GetShader() == shader)
 	{
-		for (vector<Uniform*>::const_iterator uni = material->rc_material->material.uniforms.begin(); uni != material->rc_material->material.uniforms.end(); ++uni)
+		const vector<Uniform*>& uniforms = material->rc_material->material.uniforms;
+		const vector<int>& locations = material->rc_material->GetUniformLocations();
+		for (uint i = 0; i < uniforms.size() && i < locations.size(); i++)
 		{
-			GLint uni_location = glGetUniformLocation(shader_id, (*uni)->name.data());
+			Uniform* uni = uniforms[i];
+			GLint uni_location = locations[i];
 
 			if (uni_location != -1)
-				switch ((*uni)->type)
+				switch (uni->type)
 				{
 				case UniformType::U_BOOL:
 				{
-					glUniform1i(uni_location, *reinterpret_cast<bool*>((*uni)->value));
+					glUniform1i(uni_location, *reinterpret_cast<bool*>(uni->value));
 				}
 				break;
 				case U_INT:
 				{
-					glUniform1i(uni_location, *reinterpret_cast<int*>((*uni)->value));
+					glUniform1i(uni_location, *reinterpret_cast<int*>(uni->value));
 				}
 				break;
 				case U_FLOAT:
 				{
-					glUniform1f(uni_location, *reinterpret_cast<GLfloat*>((*uni)->value));
+					glUniform1f(uni_location, *reinterpret_cast<GLfloat*>(uni->value));
 				}
 				break;
 				case U_VEC2:
 				{
-					glUniform2fv(uni_location, 1, reinterpret_cast<GLfloat*>((*uni)->value));
+					glUniform2fv(uni_location, 1, reinterpret_cast<GLfloat*>(uni->value));
 				}
 				break;
 				case U_VEC3:
 				{
-					glUniform3fv(uni_location, 1, reinterpret_cast<GLfloat*>((*uni)->value));
+					glUniform3fv(uni_location, 1, reinterpret_cast<GLfloat*>(uni->value));
 				}
 				break;
 				case U_VEC4:
 				{
-					glUniform4fv(uni_location, 1, reinterpret_cast<GLfloat*>((*uni)->value));
+					glUniform4fv(uni_location, 1, reinterpret_cast<GLfloat*>(uni->value));
 				}
 				break;
 				case U_MAT4X4:
 				{
-					glUniformMatrix4fv(uni_location, 1, GL_FALSE, reinterpret_cast<GLfloat*>((*uni)->value));
+					glUniformMatrix4fv(uni_location, 1, GL_FALSE, reinterpret_cast<GLfloat*>(uni->value));
 				}
 				break;
 				case U_SAMPLER2D:
@@ -903,30 +1063,20 @@ void ModuleRenderer3D::ShaderCustomUniforms(unsigned int shader_id, ComponentMat
 	}
 }
 
-void ModuleRenderer3D::ShaderBuiltInUniforms(unsigned int shader_id, ComponentCamera* cam, ComponentMaterial* material, const float4 color) const
+void ModuleRenderer3D::ShaderMaterialUniforms(const ShaderReflection* shader, ComponentMaterial* material) const
 {
-	//Time(special)
-	GLint time_location = glGetUniformLocation(shader_id, "time");
-	if (time_location != -1)
-	{
-		glUniform1f(time_location, time->RealTimeSinceStartup());
-	}
 	//Color
-	GLint colorLoc = glGetUniformLocation(shader_id, "material_color");
+	GLint colorLoc = shader->GetLocation(SLOT_MATERIAL_COLOR);
 	if (colorLoc != -1)
 	{
-		glUniform4fv(colorLoc, 1, color.ptr());
+		glUniform4fv(colorLoc, 1, float4(material->color).ptr());
 		if (material->rc_material != nullptr)
 			material->rc_material->material.has_color = true;
 	}
 	//Specular
-	GLint specular_location = glGetUniformLocation(shader_id, "_specular");
+	GLint specular_location = shader->GetLocation(SLOT_SPECULAR);
 	if (specular_location != -1)
 		glUniform1f(specular_location, material->specular);
-	//EyeWorld
-	GLint eye_world_pos = glGetUniformLocation(shader_id, "_EyeWorldPos");
-	if (eye_world_pos != -1)
-		glUniform3fv(eye_world_pos, 1, cam->GetPos().ptr());
 }
 
 void ModuleRenderer3D::DrawUIImage(GameObject * obj) const
@@ -979,12 +1129,10 @@ void ModuleRenderer3D::DrawUIImage(GameObject * obj) const
 	}
 	}
 
-		// Vertices
+		// Vertices and texture coordinates, interleaved
 		glBindBuffer(GL_ARRAY_BUFFER, mesh->id_vertices);
-		glVertexPointer(3, GL_FLOAT, 0, NULL);
-		// Texture coordinates
-		glBindBuffer(GL_ARRAY_BUFFER, mesh->id_uvs);
-		glTexCoordPointer(2, GL_FLOAT, 0, NULL);
+		glVertexPointer(3, GL_FLOAT, MESH_VERTEX_STRIDE, NULL);
+		glTexCoordPointer(2, GL_FLOAT, MESH_VERTEX_STRIDE, (GLvoid*)MESH_UV_OFFSET);
 
 		if (m->texture_ids.size()>m->GetIdToRender())
 		{
@@ -997,7 +1145,7 @@ void ModuleRenderer3D::DrawUIImage(GameObject * obj) const
 		glColor4fv(m->color);
 		// Indices
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->id_indices);
-		glDrawElements(GL_TRIANGLES, mesh->num_indices, GL_UNSIGNED_INT, NULL);
+		glDrawElements(GL_TRIANGLES, mesh->num_indices, (mesh->index_size == sizeof(GLushort)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, NULL);
 
 	glMatrixMode(GL_PROJECTION);              // Select Projection
 	glPopMatrix();							  // Pop The Matrix
@@ -1013,114 +1161,105 @@ void ModuleRenderer3D::DrawUIImage(GameObject * obj) const
 	glDisable(GL_ALPHA_TEST);
 }
 
-void ModuleRenderer3D::DrawUIText(GameObject * obj) const
+void ModuleRenderer3D::QueueUIText(GameObject * obj)
 {
-	BROFILER_CATEGORY("ModuleRenderer3D::DrawUIText", Profiler::Color::Teal);
-
 	ComponentRectTransform* c = (ComponentRectTransform*)obj->GetComponent(C_RECT_TRANSFORM);
-
 	ComponentUiText* t = (ComponentUiText*)obj->GetComponent(C_UI_TEXT);
-	if (t == nullptr)
+	if (t == nullptr || c == nullptr)
 		return;
-	
-	if (t->UImaterial->texture_ids.size() <= 0)
+
+	const vector<float>& quads = t->GetQuads();
+	const GlyphAtlas* atlas = t->GetAtlas();
+	if (quads.empty() || atlas == nullptr)
 		return;
 
+	ComponentMaterial* m = t->UImaterial;
+	if (ui_text_vertices.empty() == false && (ui_text_texture != atlas->GetTexture() || ui_text_alpha != m->alpha || ui_text_blend != m->blend_type || ui_text_alpha_test != m->alpha_test))
+		FlushUIText();
+
+	ui_text_texture = atlas->GetTexture();
+	ui_text_alpha = m->alpha;
+	ui_text_blend = m->blend_type;
+	ui_text_alpha_test = m->alpha_test;
+
+	//The quads only change with the text. The transform is applied here, so the whole batch shares one modelview.
+	float4x4 transform = c->GetFinalTransform();
+	for (uint i = 0; i < quads.size(); i += 4)
+	{
+		float3 pos = transform.TransformPos(float3(quads[i], quads[i + 1], 0.0f));
+		ui_text_vertices.insert(ui_text_vertices.end(), pos.ptr(), pos.ptr() + 3);
+		ui_text_vertices.push_back(quads[i + 2]);
+		ui_text_vertices.push_back(quads[i + 3]);
+		ui_text_vertices.insert(ui_text_vertices.end(), m->color, m->color + 4);
+	}
+}
+
+void ModuleRenderer3D::FlushUIText()
+{
+	if (ui_text_vertices.empty())
+		return;
+
+	BROFILER_CATEGORY("ModuleRenderer3D::FlushUIText", Profiler::Color::Teal);
+
 	glEnableClientState(GL_VERTEX_ARRAY);
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
 
 	glDisable(GL_LIGHTING); // Panel mesh is not afected by lights!
 
 	glMatrixMode(GL_PROJECTION);
 	glPushMatrix();
 	glLoadIdentity();
-	glOrtho(0, App->window->GetScreenWidth(), App->window->GetScreenHeight(), 0, -1, 1);	//
-	glMatrixMode(GL_MODELVIEW);             // Select Modelview Matrix
-	glPushMatrix();							// Push The Matrix
+	glOrtho(0, App->window->GetScreenWidth(), App->window->GetScreenHeight(), 0, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
 	glLoadIdentity();
 
-	switch (t->UImaterial->alpha)
+	switch (ui_text_alpha)
 	{
 	case (2):
 	{
 		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, t->UImaterial->blend_type);
+		glBlendFunc(GL_SRC_ALPHA, ui_text_blend);
 	}
 	case (1):
 	{
 		glEnable(GL_ALPHA_TEST);
-		glAlphaFunc(GL_GREATER, t->UImaterial->alpha_test);
+		glAlphaFunc(GL_GREATER, ui_text_alpha_test);
 		break;
 	}
 	}
 
-	string text = t->GetText();
-	string data_values = t->GetArrayValues();
-	int row_chars = t->GetCharRows();
-	float2 pos = float2(c->GetLocalPos().ptr());
-	float x = 0;
-	float y = 0;
-	Mesh* mesh = c->GetMesh();
-	float4x4 m = c->GetFinalTransform();
-	glMultMatrixf(*m.Transposed().v);
-	float4x4 tmp = float4x4::identity;
-	for (size_t i = 0; i < text.length(); i++)
-	{
-		for (uint j = 0; j < data_values.length(); ++j)
-		{
-			if (data_values[j] == text[i])
-			{
-				float letter_w = 0.0f;
-				float letter_h = 0.0f;
-				glMultMatrixf(*tmp.Transposed().v);
-				if (t->UImaterial->texture_ids.size()>j)
-				{
-					letter_w = t->GetCharwidth(j);
-
-					// Texture
-					glEnable(GL_TEXTURE_2D);
-					glBindTexture(GL_TEXTURE_2D, 0);
-					glBindTexture(GL_TEXTURE_2D, (t->UImaterial->texture_ids.at(to_string(j))));
-					
-					if (t->meshes.size() > j)
-					{
-						mesh = t->meshes.at(j);
-					}
-					// Vertices
-					glBindBuffer(GL_ARRAY_BUFFER, mesh->id_vertices);
-					glVertexPointer(3, GL_FLOAT, 0, NULL);
-				
-					// Texture coordinates
-					glBindBuffer(GL_ARRAY_BUFFER, mesh->id_uvs);
-					glTexCoordPointer(2, GL_FLOAT, 0, NULL);
-
-					glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-					glColor4fv(t->UImaterial->color);
-					// Indices
-					glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->id_indices);
-					glDrawElements(GL_TRIANGLES, mesh->num_indices, GL_UNSIGNED_INT, NULL);
-				}
-				tmp.SetTranslatePart(letter_w + t->GetCharOffset(), 0.0f, 0.0f);
-				x += (letter_w + t->GetCharOffset());
-				break;
-			}
-		}
-	}
-	
-	glMatrixMode(GL_PROJECTION);              // Select Projection
-	glPopMatrix();							  // Pop The Matrix
-	glMatrixMode(GL_MODELVIEW);               // Select Modelview
-	glPopMatrix();						  // Pop The Matrix
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, ui_text_texture);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	if (ui_text_buffer == 0)
+		glGenBuffers(1, &ui_text_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, ui_text_buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * ui_text_vertices.size(), ui_text_vertices.data(), GL_STREAM_DRAW);
+
+	GLsizei stride = 9 * sizeof(float);
+	glVertexPointer(3, GL_FLOAT, stride, NULL);
+	glTexCoordPointer(2, GL_FLOAT, stride, (GLvoid*)(3 * sizeof(float)));
+	glColorPointer(4, GL_FLOAT, stride, (GLvoid*)(5 * sizeof(float)));
+	glDrawArrays(GL_TRIANGLES, 0, ui_text_vertices.size() / 9);
+	++ui_text_draws;
+	ui_text_vertices.clear();
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
 	glPopMatrix();
-	for (size_t i = 0; i < text.length(); i++)
-	{
-		glPopMatrix();
-	}
 	glEnable(GL_LIGHTING);
 
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	glBindTexture(GL_TEXTURE_2D, 0);
 	glDisable(GL_TEXTURE_2D);
 	glDisableClientState(GL_VERTEX_ARRAY);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
 	glDisable(GL_BLEND);
 	glDisable(GL_ALPHA_TEST);
 }
@@ -6,6 +6,10 @@
 
 #include "Light.h"
 #include "Subject.h"
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+#include "GeometryArena.h"
 
 #include <vector>
 #include <utility> // for pair struct
@@ -21,6 +25,29 @@ class ComponentMaterial;
 typedef void *SDL_GLContext;
 class ComponentSprite;
 class ComponentParticleSystem;
+class ShaderReflection;
+class chunk;
+
+//Result of the culling and drawing of one camera in the last frame
+struct CameraRenderStats
+{
+	const ComponentCamera* camera = nullptr;
+	unsigned int visible = 0; //Objects left to draw
+	unsigned int occluded = 0; //Objects in the frustum hidden by the occluders
+	unsigned int occluder_triangles = 0; //Occluder triangles rasterized for this camera
+	RenderQueueStats queue; //Draws and state changes of the render queue
+	unsigned int ui_text_draws = 0; //Draw calls of all the UI texts
+};
+
+//What one camera sees in the frame. Filled on worker threads by the visibility pass, before any GL work. Drawing only reads it.
+struct CameraVisibility
+{
+	std::vector<GameObject*> static_objects; //Visible from the octree: active, in the layer mask and with a mesh updated this frame
+	std::vector<GameObject*> dynamic_objects; //Same, from the dynamic tree
+	std::vector<GameObject*> ui; //UI of the scene canvas in the layer mask, in draw order
+	std::vector<const chunk*> terrain_chunks; //Empty when the camera doesn't render the terrain
+	std::vector<ComponentParticleSystem*> particles; //Systems with alive particles in the frustum
+};
 
 class ModuleRenderer3D : public Module, public Subject
 {
@@ -39,7 +66,6 @@ public:
 	void SetCamera(ComponentCamera* camera);
 	void AddCamera(ComponentCamera* camera);
 
-	void AddToDraw(GameObject* obj);
 	void AddToDrawSprite(ComponentSprite* sprite);
 	void AddToDrawParticle(ComponentParticleSystem* particle_sys);
 
@@ -52,27 +78,42 @@ public:
 	void DrawLocator(float3 pos, Quat rot, float4 color = float4(1, 1, 1, 1));
 	void DrawAABB(float3 minPoint, float3 maxPoint, float4 color = float4(1, 1, 1, 1));
 	void DrawUIImage(GameObject* obj)const;
-	void DrawUIText(GameObject* obj)const;
+	void QueueUIText(GameObject* obj); //Drawn with the next texts that share its font and blending
+	void FlushUIText();
+
+	const CameraRenderStats* GetRenderStats(const ComponentCamera* camera)const; //nullptr if the camera was not drawn last frame
+	GeometryArena* GetGeometryArena();
+	bool IsMultiDrawSupported()const;
+	bool AreVertexArraysSupported()const;
+	bool IsGeometryArenaSupported()const;
 
 private:
 
-	void DrawScene(ComponentCamera* cam, bool has_render_tex = false);
-	void Draw(GameObject* obj, const LightInfo& light, ComponentCamera* cam, std::pair<float, GameObject*>& alpha_object,bool alpha_render = false)const;
-	void DrawAnimated(GameObject* obj, const LightInfo& light, ComponentCamera* cam, std::pair<float, GameObject*>& alpha_object, bool alpha_render = false)const;
+	void CullScene();
+	void OcclusionCull();
+	void ComputeVisibility(); //All the cameras in parallel
+	void GatherVisibility(unsigned int cam_index);
+	void DrawScene(ComponentCamera* cam, unsigned int cam_index, bool has_render_tex = false);
+	void QueueObject(GameObject* obj, ComponentCamera* cam);
+	void DrawRenderQueue(ComponentCamera* cam, const LightInfo& light);
 	void DrawSprites(ComponentCamera* cam)const;
-	void DrawParticles(ComponentCamera* cam)const;
+	void DrawParticles(ComponentCamera* cam, const std::vector<ComponentParticleSystem*>& particles)const;
 
-	bool SetShaderAlpha(ComponentMaterial* material, ComponentCamera* cam, GameObject* obj, std::pair<float, GameObject*>& alpha_object, bool alpha_render = false)const;
-	void SetShaderUniforms(unsigned int shader_id, GameObject* obj, ComponentCamera* cam, ComponentMaterial* material, const LightInfo& light, const float4& color)const;
-	void ShaderMVPUniforms(unsigned int shader_id, GameObject* obj, ComponentCamera* cam)const;
-	void ShaderTexturesUniforms(unsigned int shader_id, ComponentMaterial* material)const;
-	void ShaderLightUniforms(unsigned int shader_id, const LightInfo& light)const;
-	void ShaderCustomUniforms(unsigned int shader_id, ComponentMaterial* material)const;
-	void ShaderBuiltInUniforms(unsigned int shader_id, ComponentCamera* cam, ComponentMaterial* material, const float4 color)const;
+	//Per program: set once each time the program changes
+	void ShaderCameraUniforms(const ShaderReflection* shader, ComponentCamera* cam)const;
+	void ShaderLightUniforms(const ShaderReflection* shader, const LightInfo& light)const;
+	//Per material: set when the program or the material changes
+	void SetMaterialAlpha(ComponentMaterial* material);
+	void ShaderTexturesUniforms(const ShaderReflection* shader, ComponentMaterial* material);
+	void ShaderCustomUniforms(const ShaderReflection* shader, ComponentMaterial* material)const;
+	void ShaderMaterialUniforms(const ShaderReflection* shader, ComponentMaterial* material)const;
 
 public:
 
 	bool renderAABBs = false;
+	bool occlusion_culling = true;
+	bool instancing = true; //Default material objects sharing a mesh are drawn with one instanced call
+	bool multi_draw = true; //Instanced draws of meshes in the geometry arena with the same material go out as one multi draw indirect
 	Light lights[MAX_LIGHTS];
 	SDL_GLContext context;
 	float3x3 NormalMatrix;
@@ -81,7 +122,35 @@ public:
 
 private:
 
-	std::vector<GameObject*> objects_to_draw;
+	FrustumCuller culler; //Visibility of the scene for all the cameras, computed once per frame
+	std::vector<GameObject*> culling_candidates; //Box i in the culler belongs to culling_candidates[i]
+	unsigned int num_static_candidates = 0; //The candidates of the octree come first
+	OcclusionCuller occlusion;
+	std::vector<float3> occluder_points;
+	std::vector<CameraRenderStats> camera_stats; //One per camera
+	std::vector<CameraVisibility> visibility; //One per camera
+	std::vector<GameObject*> ui_objects; //UI of the scene canvas, gathered once per frame for every camera
+	std::vector<AABB> particle_boxes; //Bounds of particles_to_draw[i]
+	RenderQueue render_queue; //Draws of the camera being rendered
+	RenderState render_state;
+	unsigned int instance_buffer = 0; //Model matrices of the instanced draws, refilled for each camera
+	std::vector<float4x4> instance_matrices;
+	GeometryArena geometry_arena; //Buffers of the static meshes
+	bool vertex_arrays_supported = false; //GL 3.0. Without them meshes set their buffers on every draw.
+	bool geometry_arena_supported = false; //GL 3.2: vertex arrays, base vertex draws and buffer copies. Without it meshes get their own buffers.
+	bool multi_draw_supported = false; //Needs the geometry arena, multi draw indirect and base instance
+	unsigned int indirect_buffer = 0; //Commands of the multi draws, refilled for each camera
+	std::vector<DrawIndirectCommand> indirect_commands;
+
+	//UI texts waiting to be drawn: x, y, z, u, v, r, g, b, a per vertex, in screen space
+	std::vector<float> ui_text_vertices;
+	unsigned int ui_text_buffer = 0;
+	unsigned int ui_text_texture = 0; //Glyph atlas of the pending texts
+	int ui_text_alpha = 0;
+	int ui_text_blend = 0;
+	float ui_text_alpha_test = 0.0f;
+	unsigned int ui_text_draws = 0;
+
 	std::vector<ComponentSprite*> sprites_to_draw;
 	std::vector<ComponentParticleSystem*> particles_to_draw;
 };
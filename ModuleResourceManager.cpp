@@ -869,6 +869,11 @@ unsigned int ModuleResourceManager::GetDefaultShaderId() const
 	return default_shader;
 }
 
+unsigned int ModuleResourceManager::GetDefaultInstancedShaderId() const
+{
+	return default_instanced_shader;
+}
+
 unsigned int ModuleResourceManager::GetDefaultAnimShaderId() const
 {
 	return default_anim_shader;
@@ -1105,6 +1110,7 @@ unsigned int ModuleResourceManager::GetUUIDFromLib(const string & library_path)c
 void ModuleResourceManager::LoadDefaults()
 {
 	default_shader = ShaderCompiler::LoadDefaultShader();
+	default_instanced_shader = ShaderCompiler::LoadDefaultInstancedShader();
 	default_anim_shader = ShaderCompiler::LoadDefaultAnimShader();
 	default_terrain_shader = ShaderCompiler::LoadDefaultTerrainShader();
 	default_billboard_shader = ShaderCompiler::LoadDefaultBilboardShader();
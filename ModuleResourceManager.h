@@ -82,6 +82,7 @@ public:
 
 	void SaveMaterial(const Material& material, const char* path, uint uuid = 0);
 	unsigned int GetDefaultShaderId()const;
+	unsigned int GetDefaultInstancedShaderId()const;
 	unsigned int GetDefaultAnimShaderId()const;
 	unsigned int GetDefaultTerrainShaderId()const;
 	unsigned int GetDefaultBillboardShaderId()const;
@@ -163,6 +164,7 @@ private:
 
 	//Defaults
 	unsigned int default_shader = 0;
+	unsigned int default_instanced_shader = 0;
 	unsigned int default_anim_shader = 0;
 	unsigned int default_terrain_shader = 0;
 	unsigned int default_billboard_shader = 0;
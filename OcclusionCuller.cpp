@@ -0,0 +1,293 @@
+#include "OcclusionCuller.h"
+
+#include <xmmintrin.h>
+#include <algorithm>
+#include <cfloat>
+
+OcclusionCuller::OcclusionCuller()
+{
+	unsigned int width = OCCLUSION_BUFFER_WIDTH;
+	unsigned int height = OCCLUSION_BUFFER_HEIGHT;
+	while (true)
+	{
+		levels.push_back(std::vector<float>(width * height, 0.0f));
+		level_width.push_back(width);
+		level_height.push_back(height);
+		if (width == 1 && height == 1)
+			break;
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+	}
+}
+
+OcclusionCuller::~OcclusionCuller()
+{}
+
+void OcclusionCuller::ClearOccluders()
+{
+	points.clear();
+	occluders.clear();
+}
+
+void OcclusionCuller::AddOccluder(const math::float3* triangles, unsigned int num_triangles, unsigned int mask)
+{
+	if (triangles == nullptr || num_triangles == 0)
+		return;
+
+	Occluder occluder;
+	occluder.first_point = points.size();
+	occluder.num_triangles = num_triangles;
+	occluder.mask = mask;
+	occluders.push_back(occluder);
+
+	points.insert(points.end(), triangles, triangles + num_triangles * 3);
+}
+
+unsigned int OcclusionCuller::NumOccluderTriangles() const
+{
+	return points.size() / 3;
+}
+
+void OcclusionCuller::Render(const math::Frustum& frustum, unsigned int mask)
+{
+	rendered_triangles = 0;
+	for (unsigned int l = 0; l < levels.size(); l++)
+		std::fill(levels[l].begin(), levels[l].end(), 0.0f);
+
+	perspective = (frustum.Type() == math::PerspectiveFrustum);
+	if (perspective == false)
+		return;
+
+	view_proj = frustum.ViewProjMatrix();
+	near_plane = frustum.NearPlaneDistance();
+
+	for (std::vector<Occluder>::const_iterator occluder = occluders.begin(); occluder != occluders.end(); ++occluder)
+	{
+		if ((occluder->mask & mask) == 0)
+			continue;
+
+		const math::float3* point = &points[occluder->first_point];
+		for (unsigned int t = 0; t < occluder->num_triangles; t++, point += 3)
+		{
+			math::float4 a = view_proj * math::float4(point[0], 1.0f);
+			math::float4 b = view_proj * math::float4(point[1], 1.0f);
+			math::float4 c = view_proj * math::float4(point[2], 1.0f);
+
+			//Trivial reject when the three points are out through the same side plane
+			if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+				(a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w))
+				continue;
+
+			ClipAndRasterize(a, b, c);
+		}
+	}
+
+	BuildHiZ();
+}
+
+void OcclusionCuller::ClipAndRasterize(const math::float4& a, const math::float4& b, const math::float4& c)
+{
+	const math::float4 in[3] = { a, b, c };
+	bool behind[3];
+	int num_behind = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		behind[i] = in[i].w < near_plane;
+		if (behind[i])
+			++num_behind;
+	}
+
+	if (num_behind == 3)
+		return;
+
+	if (num_behind == 0)
+	{
+		RasterizeTriangle(ToScreen(a), ToScreen(b), ToScreen(c));
+		return;
+	}
+
+	//Cut against the near plane. One triangle in gives one or two out.
+	math::float4 out[4];
+	int num_out = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const math::float4& current = in[i];
+		const math::float4& next = in[(i + 1) % 3];
+		if (behind[i] == false)
+			out[num_out++] = current;
+		if (behind[i] != behind[(i + 1) % 3])
+		{
+			float t = (current.w - near_plane) / (current.w - next.w);
+			out[num_out++] = current + (next - current) * t;
+		}
+	}
+
+	for (int i = 1; i + 1 < num_out; i++)
+		RasterizeTriangle(ToScreen(out[0]), ToScreen(out[i]), ToScreen(out[i + 1]));
+}
+
+math::float4 OcclusionCuller::ToScreen(const math::float4& clip) const
+{
+	float inv_w = 1.0f / clip.w;
+	return math::float4((clip.x * inv_w * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH, (clip.y * inv_w * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT, inv_w, 1.0f);
+}
+
+void OcclusionCuller::RasterizeTriangle(const math::float4& a, const math::float4& b, const math::float4& c)
+{
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (math::Abs(area) < 1e-6f)
+		return;
+
+	//Counter-clockwise, so the inside of every edge is positive
+	const math::float4& v0 = a;
+	const math::float4& v1 = (area > 0.0f) ? b : c;
+	const math::float4& v2 = (area > 0.0f) ? c : b;
+	area = math::Abs(area);
+
+	//Screen rect, clamped before the int conversion because clipped points can be very far away
+	float min_x = math::Clamp(math::Min(v0.x, v1.x, v2.x), 0.0f, (float)(OCCLUSION_BUFFER_WIDTH - 1));
+	float max_x = math::Clamp(math::Max(v0.x, v1.x, v2.x), 0.0f, (float)(OCCLUSION_BUFFER_WIDTH - 1));
+	float min_y = math::Clamp(math::Min(v0.y, v1.y, v2.y), 0.0f, (float)(OCCLUSION_BUFFER_HEIGHT - 1));
+	float max_y = math::Clamp(math::Max(v0.y, v1.y, v2.y), 0.0f, (float)(OCCLUSION_BUFFER_HEIGHT - 1));
+	int x0 = ((int)min_x) & ~3; //Blocks of 4 pixels are aligned to the row
+	int x1 = (int)max_x;
+	int y0 = (int)min_y;
+	int y1 = (int)max_y;
+
+	//Edge functions E(x, y) = A * x + B * y + C. Edge i is the one opposite to vertex i.
+	float edge_a[3] = { v1.y - v2.y, v2.y - v0.y, v0.y - v1.y };
+	float edge_b[3] = { v2.x - v1.x, v0.x - v2.x, v1.x - v0.x };
+	float edge_c[3] = { v1.x * v2.y - v1.y * v2.x, v2.x * v0.y - v2.y * v0.x, v0.x * v1.y - v0.y * v1.x };
+
+	//1/w is linear in screen space: plane from the barycentric weights
+	float inv_area = 1.0f / area;
+	float z_a = (edge_a[0] * v0.z + edge_a[1] * v1.z + edge_a[2] * v2.z) * inv_area;
+	float z_b = (edge_b[0] * v0.z + edge_b[1] * v1.z + edge_b[2] * v2.z) * inv_area;
+	float z_c = (edge_c[0] * v0.z + edge_c[1] * v1.z + edge_c[2] * v2.z) * inv_area;
+
+	const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 e_a[3], e_b[3], e_c[3];
+	for (int i = 0; i < 3; i++)
+	{
+		e_a[i] = _mm_set1_ps(edge_a[i]);
+		e_b[i] = _mm_set1_ps(edge_b[i]);
+		e_c[i] = _mm_set1_ps(edge_c[i]);
+	}
+	__m128 zv_a = _mm_set1_ps(z_a);
+
+	float* depth = levels[0].data();
+	for (int y = y0; y <= y1; y++)
+	{
+		__m128 py = _mm_set1_ps((float)y + 0.5f);
+		__m128 row_e0 = _mm_add_ps(_mm_mul_ps(e_b[0], py), e_c[0]);
+		__m128 row_e1 = _mm_add_ps(_mm_mul_ps(e_b[1], py), e_c[1]);
+		__m128 row_e2 = _mm_add_ps(_mm_mul_ps(e_b[2], py), e_c[2]);
+		__m128 row_z = _mm_set1_ps(z_b * ((float)y + 0.5f) + z_c);
+		float* row = depth + y * OCCLUSION_BUFFER_WIDTH;
+
+		for (int x = x0; x <= x1; x += 4)
+		{
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(e_a[0], px), row_e0);
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(e_a[1], px), row_e1);
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(e_a[2], px), row_e2);
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+
+			//Nearest wins. Pixels outside get 0, which never beats what is stored.
+			__m128 z = _mm_add_ps(_mm_mul_ps(zv_a, px), row_z);
+			__m128 stored = _mm_loadu_ps(row + x);
+			_mm_storeu_ps(row + x, _mm_max_ps(stored, _mm_and_ps(inside, z)));
+		}
+	}
+
+	++rendered_triangles;
+}
+
+void OcclusionCuller::BuildHiZ()
+{
+	for (unsigned int l = 1; l < levels.size(); l++)
+	{
+		const std::vector<float>& src = levels[l - 1];
+		unsigned int src_w = level_width[l - 1];
+		unsigned int src_h = level_height[l - 1];
+		std::vector<float>& dst = levels[l];
+
+		for (unsigned int y = 0; y < level_height[l]; y++)
+		{
+			unsigned int sy0 = y * 2;
+			unsigned int sy1 = math::Min(sy0 + 1, src_h - 1);
+			for (unsigned int x = 0; x < level_width[l]; x++)
+			{
+				unsigned int sx0 = x * 2;
+				unsigned int sx1 = math::Min(sx0 + 1, src_w - 1);
+				dst[y * level_width[l] + x] = math::Min(math::Min(src[sy0 * src_w + sx0], src[sy0 * src_w + sx1]), math::Min(src[sy1 * src_w + sx0], src[sy1 * src_w + sx1]));
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::IsOccluded(const math::AABB& box) const
+{
+	if (perspective == false || rendered_triangles == 0)
+		return false;
+
+	float min_x = FLT_MAX, max_x = -FLT_MAX;
+	float min_y = FLT_MAX, max_y = -FLT_MAX;
+	float nearest = 0.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		math::float4 clip = view_proj * math::float4(box.CornerPoint(i), 1.0f);
+		if (clip.w < near_plane)
+			return false; //The box reaches the camera
+
+		math::float4 screen = ToScreen(clip);
+		min_x = math::Min(min_x, screen.x); max_x = math::Max(max_x, screen.x);
+		min_y = math::Min(min_y, screen.y); max_y = math::Max(max_y, screen.y);
+		nearest = math::Max(nearest, screen.z);
+	}
+
+	//Off screen boxes are left to the frustum culling
+	if (max_x < 0.0f || min_x >= OCCLUSION_BUFFER_WIDTH || max_y < 0.0f || min_y >= OCCLUSION_BUFFER_HEIGHT)
+		return false;
+
+	unsigned int x0 = (unsigned int)math::Max(min_x, 0.0f);
+	unsigned int x1 = (unsigned int)math::Min(max_x, (float)(OCCLUSION_BUFFER_WIDTH - 1));
+	unsigned int y0 = (unsigned int)math::Max(min_y, 0.0f);
+	unsigned int y1 = (unsigned int)math::Min(max_y, (float)(OCCLUSION_BUFFER_HEIGHT - 1));
+
+	//Finest level where the rect covers at most OCCLUSION_TEST_TEXELS per side
+	unsigned int l = 0;
+	while (l + 1 < levels.size() && ((x1 >> l) - (x0 >> l) >= OCCLUSION_TEST_TEXELS || (y1 >> l) - (y0 >> l) >= OCCLUSION_TEST_TEXELS))
+		++l;
+
+	float depth = nearest * OCCLUSION_DEPTH_BIAS;
+	const std::vector<float>& level = levels[l];
+	unsigned int w = level_width[l];
+	unsigned int h = level_height[l];
+	for (unsigned int y = y0 >> l; y <= math::Min(y1 >> l, h - 1); y++)
+		for (unsigned int x = x0 >> l; x <= math::Min(x1 >> l, w - 1); x++)
+			if (level[y * w + x] <= depth)
+				return false;
+
+	return true;
+}
+
+unsigned int OcclusionCuller::NumRenderedTriangles() const
+{
+	return rendered_triangles;
+}
+
+const float* OcclusionCuller::GetDepth(unsigned int level, unsigned int& width, unsigned int& height) const
+{
+	width = level_width[level];
+	height = level_height[level];
+	return levels[level].data();
+}
+
+unsigned int OcclusionCuller::NumLevels() const
+{
+	return levels.size();
+}
@@ -0,0 +1,67 @@
+#ifndef __OCCLUSION_CULLER_H__
+#define __OCCLUSION_CULLER_H__
+
+#include "MathGeoLib\include\MathGeoLib.h"
+
+#include <vector>
+
+#define OCCLUSION_BUFFER_WIDTH 256 //Must be a multiple of 4
+#define OCCLUSION_BUFFER_HEIGHT 128
+#define OCCLUSION_TEST_TEXELS 4 //Max texels per side checked for one box. Picks the hierarchical-Z level.
+#define OCCLUSION_DEPTH_BIAS 1.001f //A box must be this much behind the occluders to be hidden. Keeps occluders from hiding themselves.
+#define OCCLUSION_TERRAIN_MASK (1u << 31) //Occluder mask bit of the terrain. The other bits are layers.
+
+/*
+	Software occlusion culling, fully on the CPU.
+	Occluders are low-poly triangle sets, each one with a mask. Render() rasterizes the ones that match a camera into a small
+	depth buffer with SSE and builds a hierarchical-Z pyramid from it. IsOccluded() projects a box and checks it against
+	the finest pyramid level where its screen rect covers at most OCCLUSION_TEST_TEXELS per side.
+	Depth is stored as 1/w (bigger is nearer, 0 is empty), so it doesn't depend on the depth range of the projection.
+	Only perspective frustums are supported. With any other frustum nothing is occluded.
+*/
+class OcclusionCuller
+{
+public:
+	OcclusionCuller();
+	~OcclusionCuller();
+
+	void ClearOccluders();
+	void AddOccluder(const math::float3* triangles, unsigned int num_triangles, unsigned int mask); //3 points per triangle, in world space
+	unsigned int NumOccluderTriangles()const;
+
+	void Render(const math::Frustum& frustum, unsigned int mask); //Only the occluders whose mask shares a bit with mask
+	bool IsOccluded(const math::AABB& box)const;
+	unsigned int NumRenderedTriangles()const;
+
+	const float* GetDepth(unsigned int level, unsigned int& width, unsigned int& height)const;
+	unsigned int NumLevels()const;
+
+private:
+	struct Occluder
+	{
+		unsigned int first_point;
+		unsigned int num_triangles;
+		unsigned int mask;
+	};
+
+	void RasterizeTriangle(const math::float4& a, const math::float4& b, const math::float4& c);
+	void ClipAndRasterize(const math::float4& a, const math::float4& b, const math::float4& c);
+	math::float4 ToScreen(const math::float4& clip)const; //x, y in pixels, z = 1/w
+	void BuildHiZ();
+
+private:
+	std::vector<math::float3> points;
+	std::vector<Occluder> occluders;
+
+	math::float4x4 view_proj;
+	float near_plane = 0.0f;
+	bool perspective = false;
+	unsigned int rendered_triangles = 0;
+
+	//Level 0 is the depth buffer. Each next level keeps the farthest depth of 2x2 texels of the previous one.
+	std::vector<std::vector<float>> levels;
+	std::vector<unsigned int> level_width;
+	std::vector<unsigned int> level_height;
+};
+
+#endif // !__OCCLUSION_CULLER_H__
@@ -4,34 +4,62 @@
 #include "MathGeoLib\include\MathGeoLib.h"
 
 #include "DebugDraw.h"
+#include "PoolAllocator.h"
 
 #include <vector>
-#include <stack>
+#include <unordered_map>
 #include <queue>
+#include <functional>
+
+#define OCTREE_NODE_CAPACITY 8 //Objects a leaf can hold before it gets divided
+#define OCTREE_MAX_DEPTH 8
+#define OCTREE_LOOSENESS 2.0f //Loose bounds = tight bounds * looseness
+#define OCTREE_POOL_NODES 512 //Nodes per pool block
 
 template<typename Type> class Octree;
 
+/*
+	Loose octree node. Each node has a tight cell (bbox) and a loose cell (loose_bbox) that is OCTREE_LOOSENESS
+	times bigger. An object is stored in the deepest node whose cell contains its center and whose loose cell
+	contains its whole AABB, so queries against the loose cell never miss the real extents of the object.
+	Objects and their AABBs are kept in two contiguous arrays.
+*/
 template<typename Type>
 class OctreeNode
 {
 	friend class Octree<Type>;
 public:
 	OctreeNode();
-	OctreeNode(OctreeNode<Type>* parent, const math::AABB& bbox);
+	OctreeNode(OctreeNode<Type>* parent, const math::AABB& bbox, unsigned int depth);
 	~OctreeNode();
 
-private:
+	bool IsLeaf()const;
 
-	void Divide();
+private:
+	unsigned int ChildIndex(const math::float3& point)const;
+	math::AABB ChildBox(unsigned int index)const;
 
 private:
 	math::AABB bbox;
-	Type content;
-	math::float3 position;
+	math::AABB loose_bbox;
 	OctreeNode<Type>* parent = nullptr;
-	std::vector<OctreeNode*> childs;
-	OctreeNode<Type>* next = nullptr;
-	bool empty = true;
+	OctreeNode<Type>* childs[8];
+	unsigned int depth = 0;
+	unsigned int subtree_count = 0; //Objects in this node and all its children
+
+	std::vector<Type> objects;
+	std::vector<math::AABB> boxes;
+};
+
+//Pending node or object of an ordered ray traversal
+template<typename Type>
+struct OctreeRayEntry
+{
+	float distance; //Ray entry distance
+	const OctreeNode<Type>* node;
+	int object; //Index inside the node objects. -1 means the node itself.
+
+	bool operator >(const OctreeRayEntry& other)const { return distance > other.distance; }
 };
 
 template<typename Type>
@@ -41,97 +69,106 @@ public:
 	Octree();
 	~Octree();
 
-	bool Insert(Type object, const math::float3& position, OctreeNode<Type>* start_from = nullptr);
-	bool Remove(Type object, const math::float3& position);
+	bool Insert(Type object, const math::AABB& box); //False if the octree was not created or the object is already in
+	bool Remove(Type object);
+	bool Update(Type object, const math::AABB& box); //Moves the object if it was already inserted. False if it wasn't.
+	bool Contains(Type object)const;
 	void Create(float size);
+	void Clear();
 	void Draw();
-	
+	unsigned int Size()const;
+
 	template<typename Primitive>
-	bool Intersect(vector<Type>& results, Primitive& prim)const;
+	bool Intersect(std::vector<Type>& results, Primitive& prim)const;
+
+	/*
+		Visits nodes and objects in order of ray entry distance. The visitor needs:
+			bool Accept(Type object) -> Cheap filter (layers...). Rejected objects never get into the queue.
+			bool Hit(Type object, float& distance) -> Exact test. Distance along the ray of the confirmed hit.
+		Stops when the next entry is farther than the closest confirmed hit. Returns that distance (or max_distance).
+	*/
+	template<typename Visitor>
+	float RayCast(const math::Ray& ray, Visitor& visitor, float max_distance = FLOAT_INF)const;
+
 private:
+	Octree(const Octree&); //Prevent copies
+	Octree& operator= (const Octree&);
+
+	void InsertInNode(OctreeNode<Type>* node, Type object, const math::AABB& box);
+	void Divide(OctreeNode<Type>* node);
+	void Collapse(OctreeNode<Type>* node);
+	void CollectObjects(OctreeNode<Type>* node, std::vector<Type>& objects, std::vector<math::AABB>& boxes);
 	void RemoveUnnecessaryNodes(OctreeNode<Type>* start);
 
+	OctreeNode<Type>* AllocateNode(OctreeNode<Type>* parent, const math::AABB& bbox, unsigned int depth);
+	void DeallocateNode(OctreeNode<Type>* node);
+	void DeallocateTree(OctreeNode<Type>* node);
+
 private:
 	OctreeNode<Type>* root = nullptr;
+	std::unordered_map<Type, OctreeNode<Type>*> locations; //Object -> node that stores it. O(1) removal.
+
+	std::vector<PoolAllocator*> pools;
+	std::vector<char*> pools_memory;
 };
 
 // OCTREE NODE ------------------------------------------------------------------------------------------------------------------------------
 template<typename Type>
 inline OctreeNode<Type>::OctreeNode()
-{}
+{
+	for (unsigned int i = 0; i < 8; i++)
+		childs[i] = nullptr;
+}
 
 template<typename Type>
-inline OctreeNode<Type>::OctreeNode(OctreeNode<Type>* parent, const math::AABB& bbox) : parent(parent), bbox(bbox)
-{}
+inline OctreeNode<Type>::OctreeNode(OctreeNode<Type>* parent, const math::AABB& bbox, unsigned int depth) : parent(parent), bbox(bbox), depth(depth)
+{
+	for (unsigned int i = 0; i < 8; i++)
+		childs[i] = nullptr;
+
+	math::float3 half_loose = bbox.HalfSize() * OCTREE_LOOSENESS;
+	loose_bbox = math::AABB(bbox.CenterPoint() - half_loose, bbox.CenterPoint() + half_loose);
+}
 
 template<typename Type>
 inline OctreeNode<Type>::~OctreeNode()
 {}
 
 template<typename Type>
-inline void OctreeNode<Type>::Divide()
+inline bool OctreeNode<Type>::IsLeaf() const
+{
+	return childs[0] == nullptr;
+}
+
+template<typename Type>
+inline unsigned int OctreeNode<Type>::ChildIndex(const math::float3& point) const
 {
-	AABB bbox = this->bbox;
-	OctreeNode<Type>* previous = nullptr;
-	float3 center = this->bbox.CenterPoint();
-	float half = this->bbox.HalfSize().x; //Same size at X/Y/Z
 	/*
-		---------	 ---------
-		| 0 | 1 |	 | 4 | 5 |
-		---------	 ---------
-		| 2 | 3 |	 | 6 | 7 |
-		---------	 ---------
-		bottom			top
-	
+		Bit 0: x >= center.x
+		Bit 1: y >= center.y
+		Bit 2: z >= center.z
 	*/
-	for (int i = 0; i < 8; i++)
-	{
-		switch (i)
-		{
-		case 0:
-			bbox.minPoint = this->bbox.minPoint + float3(0, 0, half);
-			bbox.maxPoint = center + float3(0, 0, half);
-			break;
-		case 1:
-			bbox.minPoint = this->bbox.minPoint + float3(half, 0, half);
-			bbox.maxPoint = center + float3(half, 0, half);
-			break;
-		case 2:
-			bbox.minPoint = this->bbox.minPoint;
-			bbox.maxPoint = center;
-			break;
-		case 3:
-			bbox.minPoint = this->bbox.minPoint + float3(half, 0, 0);
-			bbox.maxPoint = center + float3(half, 0, 0);
-			break;
-		case 4:
-			bbox.minPoint = center - float3(half, 0, 0);
-			bbox.maxPoint = this->bbox.maxPoint - float3(half, 0, 0);
-			break;
-		case 5:
-			bbox.minPoint = center;
-			bbox.maxPoint = this->bbox.maxPoint;
-			break;
-		case 6:
-			bbox.minPoint = center - float3(half, 0, half);
-			bbox.maxPoint = this->bbox.maxPoint - float3(half, 0, half);
-			break;
-		case 7:
-			bbox.minPoint = center - float3(0, 0, half);
-			bbox.maxPoint = this->bbox.maxPoint - float3(0, 0, half);
-			break;
-		}
-
-		OctreeNode<Type>* node = new OctreeNode<Type>(this, bbox);
-		
-		if (previous)
-			previous->next = node;
-
-		previous = node;
-		childs.push_back(node);
-	}
+	math::float3 center = bbox.CenterPoint();
+	unsigned int index = 0;
+	if (point.x >= center.x) index |= 1;
+	if (point.y >= center.y) index |= 2;
+	if (point.z >= center.z) index |= 4;
+	return index;
 }
 
+template<typename Type>
+inline math::AABB OctreeNode<Type>::ChildBox(unsigned int index) const
+{
+	math::float3 center = bbox.CenterPoint();
+	math::AABB box;
+	box.minPoint.x = (index & 1) ? center.x : bbox.minPoint.x;
+	box.maxPoint.x = (index & 1) ? bbox.maxPoint.x : center.x;
+	box.minPoint.y = (index & 2) ? center.y : bbox.minPoint.y;
+	box.maxPoint.y = (index & 2) ? bbox.maxPoint.y : center.y;
+	box.minPoint.z = (index & 4) ? center.z : bbox.minPoint.z;
+	box.maxPoint.z = (index & 4) ? bbox.maxPoint.z : center.z;
+	return box;
+}
 
 // OCTREE ------------------------------------------------------------------------------------------------------------------------------
 template<typename Type>
@@ -141,117 +178,117 @@ inline Octree<Type>::Octree()
 template<typename Type>
 inline Octree<Type>::~Octree()
 {
-	if (root)
-		delete root;
+	Clear();
+
+	for (size_t i = 0; i < pools.size(); i++)
+	{
+		delete pools[i];
+		delete[] pools_memory[i];
+	}
+	pools.clear();
+	pools_memory.clear();
 }
 
 template<typename Type>
-inline bool Octree<Type>::Insert(Type object, const math::float3& position, OctreeNode<Type>* start_from)
+inline bool Octree<Type>::Insert(Type object, const math::AABB& box)
 {
-	OctreeNode<Type>* start_node = (start_from) ? start_from : root;
-
 	if (root == nullptr) //Octree has not been created
 		return false;
 
-	if (start_node->bbox.Contains(position) == false) //Point out of the boundaries
-		return false; 
+	if (locations.find(object) != locations.end()) //Already inserted
+		return false;
 
-	bool ret = false;
-	queue<OctreeNode<Type>*> queue;
-	OctreeNode<Type>* current = nullptr;
+	//Objects out of the boundaries are not dropped: they stay near the root with their real box, and the root is always visited
+	InsertInNode(root, object, box);
+	return true;
+}
 
-	queue.push(start_node);
+template<typename Type>
+inline bool Octree<Type>::Remove(Type object)
+{
+	typename std::unordered_map<Type, OctreeNode<Type>*>::iterator location = locations.find(object);
+	if (location == locations.end())
+		return false;
 
-	while (queue.empty() == false)
-	{
-		current = queue.front();
-		queue.pop();
+	OctreeNode<Type>* node = location->second;
+	locations.erase(location);
 
-		if (current->bbox.Contains(position))
+	for (size_t i = 0; i < node->objects.size(); i++)
+	{
+		if (node->objects[i] == object)
 		{
-			if (current->childs.size() == 0) //Leaf node ->Insertion
-			{
-				if (current->empty)
-				{
-					current->content = object;
-					current->position = position;
-					current->empty = false;
-					ret = true; //Successful insertion!
-					break;
-				}
-				else
-				{
-					current->Divide();
-					current->empty = true;
-
-					//Insert current content
-					ret = Insert(current->content, current->position, current);
-					if (ret == false) //Error while inserting current content
-						break;
-					//Insert new content
-					ret = Insert(object, position, current); //If ret == true is a successful insertion!
-					break;
-				}
-			}
+			//Swap with the last one to keep the arrays contiguous
+			node->objects[i] = node->objects.back();
+			node->boxes[i] = node->boxes.back();
+			node->objects.pop_back();
+			node->boxes.pop_back();
+			break;
 		}
-
-		for (vector<OctreeNode<Type>*>::iterator child = current->childs.begin(); child != current->childs.end(); ++child)
-			queue.push(*child);
-
 	}
 
-	return ret;
+	for (OctreeNode<Type>* current = node; current != nullptr; current = current->parent)
+		--current->subtree_count;
+
+	RemoveUnnecessaryNodes(node);
+	return true;
 }
 
 template<typename Type>
-inline bool Octree<Type>::Remove(Type object, const math::float3 & position)
+inline bool Octree<Type>::Update(Type object, const math::AABB& box)
 {
-	if (root == nullptr) //Octree has not been created
-		return false;
-
-	if (root->bbox.Contains(position) == false) //Point out of the boundaries
+	typename std::unordered_map<Type, OctreeNode<Type>*>::iterator location = locations.find(object);
+	if (location == locations.end())
 		return false;
 
-	bool ret = false;
-	queue<OctreeNode<Type>*> queue;
-	OctreeNode<Type>* current = nullptr;
-
-	queue.push(root);
+	OctreeNode<Type>* node = location->second;
 
-	while (queue.empty() == false)
+	//Cheap path: the object still belongs to the same node, only refresh its box
+	bool fits_here = node->loose_bbox.Contains(box) && node->bbox.Contains(box.CenterPoint());
+	bool fits_deeper = false;
+	if (fits_here && node->IsLeaf() == false)
 	{
-		current = queue.front();
-		queue.pop();
+		unsigned int index = node->ChildIndex(box.CenterPoint());
+		fits_deeper = node->childs[index]->loose_bbox.Contains(box);
+	}
 
-		if (current->bbox.Contains(position))
+	if (fits_here && !fits_deeper)
+	{
+		for (size_t i = 0; i < node->objects.size(); i++)
 		{
-			if (current->childs.size() == 0) //Leaf node
+			if (node->objects[i] == object)
 			{
-				if (!current->empty && current->content == object && current->position.Equals(position))
-				{
-					current->empty = true;
-					RemoveUnnecessaryNodes(current);
-					ret = true; //Successful erase!
-					break;
-				}
+				node->boxes[i] = box;
+				break;
 			}
 		}
-
-		for (vector<OctreeNode<Type>*>::iterator child = current->childs.begin(); child != current->childs.end(); ++child)
-			queue.push(*child);
-
+		return true;
 	}
 
-	return ret;
+	Remove(object);
+	return Insert(object, box);
+}
+
+template<typename Type>
+inline bool Octree<Type>::Contains(Type object) const
+{
+	return locations.find(object) != locations.end();
 }
 
 template<typename Type>
 inline void Octree<Type>::Create(float size)
 {
-	if (root)
-		delete root; 
+	Clear();
 	math::AABB bbox = math::AABB(math::vec(-(size / 2.0f)), math::vec(size / 2.0f));
-	root = new OctreeNode<Type>(nullptr, bbox);
+	root = AllocateNode(nullptr, bbox, 0);
+}
+
+template<typename Type>
+inline void Octree<Type>::Clear()
+{
+	if (root)
+		DeallocateTree(root);
+	root = nullptr;
+	locations.clear();
 }
 
 template<typename Type>
@@ -260,101 +297,247 @@ inline void Octree<Type>::Draw()
 	if (root == nullptr)
 		return;
 
-	stack<OctreeNode<Type>*> stack;
-	OctreeNode<Type>* current = root;
-	OctreeNode<Type>* print_item;
-	while (current != nullptr || stack.size() != 0)
+	std::vector<OctreeNode<Type>*> stack;
+	stack.push_back(root);
+	while (stack.empty() == false)
 	{
-		if (current == nullptr)
-		{
-			print_item = stack.top();
-			stack.pop();
-			g_Debug->AddAABB(print_item->bbox, g_Debug->red, 3.0f);
-			current = print_item->next;
-		}
-		else
-		{
-			stack.push(current);
-			if (current->childs.size() > 0)
-				current = current->childs.front();
-			else
-				current = nullptr;
-		}
-	}	
+		OctreeNode<Type>* current = stack.back();
+		stack.pop_back();
+
+		g_Debug->AddAABB(current->bbox, g_Debug->red, 3.0f);
+
+		if (current->IsLeaf() == false)
+			for (unsigned int i = 0; i < 8; i++)
+				stack.push_back(current->childs[i]);
+	}
+}
+
+template<typename Type>
+inline unsigned int Octree<Type>::Size() const
+{
+	return locations.size();
+}
+
+template<typename Type>
+inline void Octree<Type>::InsertInNode(OctreeNode<Type>* node, Type object, const math::AABB& box)
+{
+	math::float3 center = box.CenterPoint();
+
+	//Go down while a child can hold the whole object inside its loose bounds
+	while (node->IsLeaf() == false)
+	{
+		OctreeNode<Type>* child = node->childs[node->ChildIndex(center)];
+		if (child->loose_bbox.Contains(box) == false)
+			break;
+		++node->subtree_count;
+		node = child;
+	}
+
+	node->objects.push_back(object);
+	node->boxes.push_back(box);
+	++node->subtree_count;
+	locations[object] = node;
+
+	if (node->IsLeaf() && node->objects.size() > OCTREE_NODE_CAPACITY && node->depth < OCTREE_MAX_DEPTH)
+		Divide(node);
+}
+
+template<typename Type>
+inline void Octree<Type>::Divide(OctreeNode<Type>* node)
+{
+	for (unsigned int i = 0; i < 8; i++)
+		node->childs[i] = AllocateNode(node, node->ChildBox(i), node->depth + 1);
+
+	//Push down the objects that fit inside a child. Big ones stay here.
+	std::vector<Type> objects;
+	std::vector<math::AABB> boxes;
+	objects.swap(node->objects);
+	boxes.swap(node->boxes);
+	node->subtree_count -= objects.size();
+
+	for (size_t i = 0; i < objects.size(); i++)
+		InsertInNode(node, objects[i], boxes[i]);
+}
+
+template<typename Type>
+inline void Octree<Type>::Collapse(OctreeNode<Type>* node)
+{
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		CollectObjects(node->childs[i], node->objects, node->boxes);
+		DeallocateTree(node->childs[i]);
+		node->childs[i] = nullptr;
+	}
+
+	for (size_t i = 0; i < node->objects.size(); i++)
+		locations[node->objects[i]] = node;
+}
+
+template<typename Type>
+inline void Octree<Type>::CollectObjects(OctreeNode<Type>* node, std::vector<Type>& objects, std::vector<math::AABB>& boxes)
+{
+	objects.insert(objects.end(), node->objects.begin(), node->objects.end());
+	boxes.insert(boxes.end(), node->boxes.begin(), node->boxes.end());
+
+	if (node->IsLeaf() == false)
+		for (unsigned int i = 0; i < 8; i++)
+			CollectObjects(node->childs[i], objects, boxes);
 }
 
 template<typename Type>
 inline void Octree<Type>::RemoveUnnecessaryNodes(OctreeNode<Type>* start)
 {
-	if (start == root)
-		return;
+	//Find the highest ancestor that can hold all its subtree as a single leaf
+	OctreeNode<Type>* collapse = nullptr;
+	OctreeNode<Type>* current = (start->IsLeaf()) ? start->parent : start;
+	while (current != nullptr && current->subtree_count <= OCTREE_NODE_CAPACITY)
+	{
+		collapse = current;
+		current = current->parent;
+	}
+
+	if (collapse != nullptr && collapse->IsLeaf() == false)
+		Collapse(collapse);
+}
+
+template<typename Type>
+inline OctreeNode<Type>* Octree<Type>::AllocateNode(OctreeNode<Type>* parent, const math::AABB& bbox, unsigned int depth)
+{
+	void* memory = nullptr;
+	for (size_t i = 0; i < pools.size() && memory == nullptr; i++)
+		memory = pools[i]->Allocate(sizeof(OctreeNode<Type>), alignof(OctreeNode<Type>));
 
-	OctreeNode<Type>* parent = start->parent;
-	Type content;
-	float3 pos;
-	while (parent != nullptr)
+	if (memory == nullptr) //All pools are full. Add a new block.
 	{
-		int num_child_with_content = 0;
-		for (vector<OctreeNode<Type>*>::iterator child = parent->childs.begin(); child != parent->childs.end(); ++child)
-		{
-			if ((*child)->empty == false)
-			{
-				++num_child_with_content;
-				content = (*child)->content;
-				pos = (*child)->position;
-			}
-		}
+		size_t block_size = sizeof(OctreeNode<Type>) * OCTREE_POOL_NODES + alignof(OctreeNode<Type>);
+		char* block = new char[block_size];
+		PoolAllocator* pool = new PoolAllocator(sizeof(OctreeNode<Type>), alignof(OctreeNode<Type>), block_size, block);
+		pools.push_back(pool);
+		pools_memory.push_back(block);
+		memory = pool->Allocate(sizeof(OctreeNode<Type>), alignof(OctreeNode<Type>));
+	}
+
+	return new (memory) OctreeNode<Type>(parent, bbox, depth);
+}
 
-		if (num_child_with_content == 1)
+template<typename Type>
+inline void Octree<Type>::DeallocateNode(OctreeNode<Type>* node)
+{
+	for (size_t i = 0; i < pools.size(); i++)
+	{
+		char* start = (char*)pools[i]->GetStart();
+		if ((char*)node >= start && (char*)node < start + pools[i]->GetSize())
 		{
-			parent->childs.clear();
-			parent->content = content;
-			parent->position = pos;
-			parent->empty = false;
-			parent = parent->parent;
+			allocator::DeallocateDelete(*pools[i], *node);
+			return;
 		}
-		else
-			break;
 	}
 }
 
+template<typename Type>
+inline void Octree<Type>::DeallocateTree(OctreeNode<Type>* node)
+{
+	if (node->IsLeaf() == false)
+		for (unsigned int i = 0; i < 8; i++)
+			DeallocateTree(node->childs[i]);
+
+	DeallocateNode(node);
+}
+
 template<typename Type>
 template<typename Primitive>
-inline bool Octree<Type>::Intersect(vector<Type>& results, Primitive & prim) const
+inline bool Octree<Type>::Intersect(std::vector<Type>& results, Primitive & prim) const
 {
 	if (root == nullptr) //Octree has not been created
 		return false;
 
-	if (!prim.Intersects(root->bbox)) //Point out of the boundaries
-		return false;
-
 	bool ret = false;
-	queue<OctreeNode<Type>*> queue;
-	OctreeNode<Type>* current = nullptr;
+	std::vector<OctreeNode<Type>*> stack;
+	stack.push_back(root);
+
+	while (stack.empty() == false)
+	{
+		OctreeNode<Type>* current = stack.back();
+		stack.pop_back();
+
+		if (current->subtree_count == 0)
+			continue;
+
+		//Root is always visited: it keeps the objects that overflow its loose bounds
+		if (current != root && !prim.Intersects(current->loose_bbox))
+			continue;
+
+		for (size_t i = 0; i < current->boxes.size(); i++)
+		{
+			if (prim.Intersects(current->boxes[i]))
+			{
+				results.push_back(current->objects[i]);
+				ret = true;
+			}
+		}
+
+		if (current->IsLeaf() == false)
+			for (unsigned int i = 0; i < 8; i++)
+				stack.push_back(current->childs[i]);
+	}
+	return ret;
+}
+
+template<typename Type>
+template<typename Visitor>
+inline float Octree<Type>::RayCast(const math::Ray & ray, Visitor & visitor, float max_distance) const
+{
+	if (root == nullptr || root->subtree_count == 0)
+		return max_distance;
+
+	std::priority_queue<OctreeRayEntry<Type>, std::vector<OctreeRayEntry<Type>>, std::greater<OctreeRayEntry<Type>>> queue;
 
-	queue.push(root);
+	//Root is always visited: it keeps the objects that overflow its loose bounds
+	OctreeRayEntry<Type> entry = { 0.0f, root, -1 };
+	queue.push(entry);
 
+	float d_near, d_far;
 	while (queue.empty() == false)
 	{
-		current = queue.front();
+		entry = queue.top();
 		queue.pop();
 
-		if (prim.Intersects(current->bbox))
+		if (entry.distance > max_distance) //Nothing left can be closer than the current hit
+			break;
+
+		const OctreeNode<Type>* node = entry.node;
+		if (entry.object >= 0)
+		{
+			float distance;
+			if (visitor.Hit(node->objects[entry.object], distance) && distance < max_distance)
+				max_distance = distance;
+			continue;
+		}
+
+		for (size_t i = 0; i < node->boxes.size(); i++)
 		{
-			if (current->childs.size() == 0) //Leaf node
+			if (ray.Intersects(node->boxes[i], d_near, d_far) && d_near <= max_distance && visitor.Accept(node->objects[i]))
 			{
-				if (current->empty == false)
+				OctreeRayEntry<Type> object_entry = { d_near, node, (int)i };
+				queue.push(object_entry);
+			}
+		}
+
+		if (node->IsLeaf() == false)
+		{
+			for (unsigned int i = 0; i < 8; i++)
+			{
+				const OctreeNode<Type>* child = node->childs[i];
+				if (child->subtree_count > 0 && ray.Intersects(child->loose_bbox, d_near, d_far) && d_near <= max_distance)
 				{
-					results.push_back(current->content);
-					ret = true;
+					OctreeRayEntry<Type> child_entry = { d_near, child, -1 };
+					queue.push(child_entry);
 				}
 			}
-			else
-				for (vector<OctreeNode<Type>*>::iterator child = current->childs.begin(); child != current->childs.end(); ++child)
-					queue.push(*child);
 		}
 	}
-	return ret; 
+
+	return max_distance;
 }
 
 #endif // !__OCTREE_H__
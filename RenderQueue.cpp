@@ -0,0 +1,437 @@
+#include "RenderQueue.h"
+#include "ComponentMesh.h"
+#include "ComponentMaterial.h"
+
+#include "Glew\include\glew.h"
+#include <gl/GL.h>
+
+#include <string.h>
+
+#define RENDER_STATE_UNKNOWN 0xFFFFFFFF
+
+//Bits of each field of the sort key
+#define KEY_PASS_BITS 2
+#define KEY_SHADER_BITS 12
+#define KEY_MATERIAL_BITS 14
+#define KEY_MESH_BITS 12
+#define KEY_DEPTH_BITS 24
+
+static inline GLenum IndexType(unsigned int index_size)
+{
+	return (index_size == sizeof(GLushort)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+static inline uint64_t KeyField(unsigned int value, unsigned int bits)
+{
+	return (uint64_t)(value & ((1u << bits) - 1));
+}
+
+// ---- RenderQueue ----------------------------------------------------
+
+RenderQueue::RenderQueue()
+{}
+
+RenderQueue::~RenderQueue()
+{}
+
+void RenderQueue::Clear()
+{
+	items.clear();
+	order.clear();
+	material_ids.clear();
+	material_hashes.clear();
+	material_states.clear();
+	mesh_ids.clear();
+}
+
+void RenderQueue::Add(const DrawItem & item, float depth)
+{
+	items.push_back(item);
+	items.back().material_id = MaterialId(item.material);
+
+	SortEntry entry;
+	entry.key = MakeKey(items.back(), depth);
+	entry.item = items.size() - 1;
+	order.push_back(entry);
+}
+
+unsigned int RenderQueue::MaterialId(const ComponentMaterial * material)
+{
+	std::unordered_map<const ComponentMaterial*, unsigned int>::iterator it = material_ids.find(material);
+	if (it != material_ids.end())
+		return it->second;
+
+	unsigned int id = material_states.size();
+	size_t hash = (material) ? material->RenderStateHash() : 0;
+	typedef std::unordered_multimap<size_t, unsigned int>::iterator HashIterator;
+	std::pair<HashIterator, HashIterator> range = material_hashes.equal_range(hash);
+	for (HashIterator same = range.first; same != range.second; ++same)
+	{
+		const ComponentMaterial* other = material_states[same->second];
+		if (other == material || (material && other && material->SameRenderState(*other)))
+		{
+			id = same->second;
+			break;
+		}
+	}
+
+	if (id == material_states.size())
+	{
+		material_hashes.insert(std::make_pair(hash, id));
+		material_states.push_back(material);
+	}
+	material_ids[material] = id;
+	return id;
+}
+
+uint64_t RenderQueue::MakeKey(const DrawItem & item, float depth)
+{
+	unsigned int material = item.material_id;
+
+	unsigned int mesh = mesh_ids.size();
+	std::unordered_map<const Mesh*, unsigned int>::iterator mesh_it = mesh_ids.find(item.mesh);
+	if (mesh_it != mesh_ids.end())
+		mesh = mesh_it->second;
+	else
+		mesh_ids[item.mesh] = mesh;
+
+	//Positive floats keep their order when compared as integers. The lowest mantissa bits are dropped.
+	if (!(depth > 0.0f))
+		depth = 0.0f;
+	unsigned int depth_bits;
+	memcpy(&depth_bits, &depth, sizeof(depth_bits));
+	depth_bits >>= (32 - KEY_DEPTH_BITS);
+
+	uint64_t key = KeyField(item.pass, KEY_PASS_BITS) << (64 - KEY_PASS_BITS);
+	if (item.pass == RENDER_PASS_TRANSPARENT)
+	{
+		//Blending needs back to front, state grouping only breaks ties
+		key |= KeyField(~depth_bits, KEY_DEPTH_BITS) << (KEY_SHADER_BITS + KEY_MATERIAL_BITS + KEY_MESH_BITS);
+		key |= KeyField(item.shader_id, KEY_SHADER_BITS) << (KEY_MATERIAL_BITS + KEY_MESH_BITS);
+		key |= KeyField(material, KEY_MATERIAL_BITS) << KEY_MESH_BITS;
+		key |= KeyField(mesh, KEY_MESH_BITS);
+	}
+	else
+	{
+		key |= KeyField(item.shader_id, KEY_SHADER_BITS) << (KEY_MATERIAL_BITS + KEY_MESH_BITS + KEY_DEPTH_BITS);
+		key |= KeyField(material, KEY_MATERIAL_BITS) << (KEY_MESH_BITS + KEY_DEPTH_BITS);
+		key |= KeyField(mesh, KEY_MESH_BITS) << KEY_DEPTH_BITS;
+		key |= KeyField(depth_bits, KEY_DEPTH_BITS);
+	}
+	return key;
+}
+
+void RenderQueue::Sort()
+{
+	unsigned int count = order.size();
+	if (count < 2)
+		return;
+
+	scratch.resize(count);
+	SortEntry* src = order.data();
+	SortEntry* dst = scratch.data();
+
+	for (unsigned int shift = 0; shift < 64; shift += 8)
+	{
+		unsigned int offsets[256];
+		memset(offsets, 0, sizeof(offsets));
+		for (unsigned int i = 0; i < count; i++)
+			++offsets[(src[i].key >> shift) & 0xFF];
+
+		//Every key has the same byte here: nothing to move
+		if (offsets[(src[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		unsigned int sum = 0;
+		for (unsigned int b = 0; b < 256; b++)
+		{
+			unsigned int size = offsets[b];
+			offsets[b] = sum;
+			sum += size;
+		}
+
+		for (unsigned int i = 0; i < count; i++)
+			dst[offsets[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+		SortEntry* tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if (src != order.data())
+		order.swap(scratch);
+}
+
+unsigned int RenderQueue::Count() const
+{
+	return order.size();
+}
+
+const DrawItem & RenderQueue::Get(unsigned int index) const
+{
+	return items[order[index].item];
+}
+
+unsigned int RenderQueue::CountInstances(unsigned int first) const
+{
+	const DrawItem& item = Get(first);
+	if (item.instanced == false)
+		return 1;
+
+	//Same material means same pass. Transparent runs are consecutive in depth, so their order is kept.
+	unsigned int count = 1;
+	while (first + count < order.size())
+	{
+		const DrawItem& next = Get(first + count);
+		if (next.instanced == false || next.shader_id != item.shader_id || next.material_id != item.material_id || next.mesh != item.mesh)
+			break;
+		++count;
+	}
+	return count;
+}
+
+unsigned int RenderQueue::CountMultiDraw(unsigned int first, unsigned int & runs) const
+{
+	const DrawItem& item = Get(first);
+	unsigned int count = CountInstances(first);
+	runs = 1;
+	if (item.instanced == false)
+		return count;
+
+	while (first + count < order.size())
+	{
+		const DrawItem& next = Get(first + count);
+		if (next.instanced == false || next.shader_id != item.shader_id || next.material_id != item.material_id || next.mesh->id_vao != item.mesh->id_vao)
+			break;
+		count += CountInstances(first + count);
+		++runs;
+	}
+	return count;
+}
+
+// ---- RenderState ----------------------------------------------------
+
+RenderState::RenderState()
+{
+	Reset();
+}
+
+RenderState::~RenderState()
+{}
+
+void RenderState::Reset()
+{
+	program = RENDER_STATE_UNKNOWN;
+	vertex_array = RENDER_STATE_UNKNOWN;
+	array_buffer = RENDER_STATE_UNKNOWN;
+	indirect_buffer = RENDER_STATE_UNKNOWN;
+	active_unit = RENDER_STATE_UNKNOWN;
+	for (unsigned int i = 0; i < RENDER_STATE_MAX_TEXTURE_UNITS; i++)
+		textures[i] = RENDER_STATE_UNKNOWN;
+	blend = -1;
+	blend_dst = RENDER_STATE_UNKNOWN;
+	alpha_test = -1;
+	alpha_ref = -1.0f;
+
+	stats = RenderQueueStats();
+}
+
+void RenderState::Finish()
+{
+	//Only touched when a vertex array was bound, GL may not have them at all
+	if (vertex_array != RENDER_STATE_UNKNOWN && vertex_array != 0)
+		BindVertexArray(0);
+	if (indirect_buffer != RENDER_STATE_UNKNOWN && indirect_buffer != 0)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		indirect_buffer = 0;
+	}
+	SetBlend(false);
+	SetAlphaTest(false);
+	for (unsigned int i = 0; i < RENDER_STATE_MAX_TEXTURE_UNITS; i++)
+		if (textures[i] != RENDER_STATE_UNKNOWN && textures[i] != 0)
+			BindTexture(i, 0);
+	if (active_unit != 0)
+	{
+		glActiveTexture(GL_TEXTURE0);
+		active_unit = 0;
+	}
+}
+
+bool RenderState::UseProgram(unsigned int program)
+{
+	if (this->program == program)
+		return false;
+
+	glUseProgram(program);
+	this->program = program;
+	++stats.program_changes;
+	return true;
+}
+
+void RenderState::BindVertexArray(unsigned int vao)
+{
+	if (vertex_array == vao)
+		return;
+
+	glBindVertexArray(vao);
+	vertex_array = vao;
+	++stats.buffer_binds;
+}
+
+void RenderState::BindMesh(const Mesh & mesh)
+{
+	if (mesh.id_vao != 0)
+	{
+		BindVertexArray(mesh.id_vao);
+		return;
+	}
+
+	//No vertex arrays: the attributes live in the default state and are set again for each mesh
+	BindArrayBuffer(mesh.id_vertices);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)MESH_UV_OFFSET);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)MESH_NORMAL_OFFSET);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)MESH_TANGENT_OFFSET);
+	glEnableVertexAttribArray(3);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.id_indices);
+	++stats.buffer_binds;
+}
+
+void RenderState::VertexAttrib(unsigned int index, unsigned int buffer, int size, unsigned int type, bool integer)
+{
+	BindArrayBuffer(buffer);
+	if (integer)
+		glVertexAttribIPointer(index, size, type, 0, (GLvoid*)0);
+	else
+		glVertexAttribPointer(index, size, type, GL_FALSE, 0, (GLvoid*)0);
+	glEnableVertexAttribArray(index);
+}
+
+void RenderState::InstanceMatrixAttrib(unsigned int index, unsigned int buffer, unsigned int offset)
+{
+	//The divisor is vertex array state too, set it with the pointers
+	BindArrayBuffer(buffer);
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		unsigned int attrib = index + column;
+		glVertexAttribPointer(attrib, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (GLvoid*)(offset + column * 4 * sizeof(float)));
+		glVertexAttribDivisor(attrib, 1);
+		glEnableVertexAttribArray(attrib);
+	}
+}
+
+void RenderState::DisableAttribs(unsigned int mask)
+{
+	for (unsigned int i = 0; i < RENDER_STATE_MAX_ATTRIBS; i++)
+		if (mask & (1u << i))
+			glDisableVertexAttribArray(i);
+}
+
+void RenderState::BindArrayBuffer(unsigned int buffer)
+{
+	if (array_buffer == buffer)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	array_buffer = buffer;
+	++stats.buffer_binds;
+}
+
+void RenderState::BindTexture(unsigned int unit, unsigned int texture)
+{
+	if (unit >= RENDER_STATE_MAX_TEXTURE_UNITS || textures[unit] == texture)
+		return;
+
+	if (active_unit != unit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		active_unit = unit;
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
+	textures[unit] = texture;
+	++stats.texture_binds;
+}
+
+void RenderState::SetBlend(bool enabled, unsigned int dst_factor)
+{
+	if (blend != (int)enabled)
+	{
+		if (enabled)
+			glEnable(GL_BLEND);
+		else
+			glDisable(GL_BLEND);
+		blend = enabled;
+	}
+
+	if (enabled && blend_dst != dst_factor)
+	{
+		glBlendFunc(GL_SRC_ALPHA, dst_factor);
+		blend_dst = dst_factor;
+	}
+}
+
+void RenderState::SetAlphaTest(bool enabled, float ref)
+{
+	if (alpha_test != (int)enabled)
+	{
+		if (enabled)
+			glEnable(GL_ALPHA_TEST);
+		else
+			glDisable(GL_ALPHA_TEST);
+		alpha_test = enabled;
+	}
+
+	if (enabled && alpha_ref != ref)
+	{
+		glAlphaFunc(GL_GREATER, ref);
+		alpha_ref = ref;
+	}
+}
+
+void RenderState::DrawMesh(const Mesh & mesh)
+{
+	if (mesh.base_vertex != 0)
+		glDrawElementsBaseVertex(GL_TRIANGLES, mesh.num_indices, IndexType(mesh.index_size), (void*)(mesh.first_index * mesh.index_size), mesh.base_vertex);
+	else
+		glDrawElements(GL_TRIANGLES, mesh.num_indices, IndexType(mesh.index_size), (void*)(mesh.first_index * mesh.index_size));
+	++stats.draws;
+}
+
+void RenderState::DrawMeshInstanced(const Mesh & mesh, unsigned int instances)
+{
+	if (mesh.base_vertex != 0)
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.num_indices, IndexType(mesh.index_size), (void*)(mesh.first_index * mesh.index_size), instances, mesh.base_vertex);
+	else
+		glDrawElementsInstanced(GL_TRIANGLES, mesh.num_indices, IndexType(mesh.index_size), (void*)(mesh.first_index * mesh.index_size), instances);
+	++stats.draws;
+	stats.instances += instances;
+}
+
+void RenderState::MultiDrawIndirect(unsigned int buffer, unsigned int first_command, unsigned int num_commands, unsigned int index_size, unsigned int instances)
+{
+	if (indirect_buffer != buffer)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+		indirect_buffer = buffer;
+		++stats.buffer_binds;
+	}
+
+	glMultiDrawElementsIndirect(GL_TRIANGLES, IndexType(index_size), (void*)(first_command * sizeof(DrawIndirectCommand)), num_commands, 0);
+	++stats.draws;
+	stats.instances += instances;
+	stats.indirect_commands += num_commands;
+}
+
+const RenderQueueStats & RenderState::GetStats() const
+{
+	return stats;
+}
+
+void RenderState::CountMaterialChange()
+{
+	++stats.material_changes;
+}
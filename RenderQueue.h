@@ -0,0 +1,158 @@
+#ifndef __RENDER_QUEUE_H__
+#define __RENDER_QUEUE_H__
+
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+#define RENDER_STATE_MAX_ATTRIBS 16
+#define RENDER_STATE_MAX_TEXTURE_UNITS 16
+
+class GameObject;
+class ComponentMaterial;
+class ComponentMesh;
+struct Mesh;
+
+//Passes are drawn in this order
+enum RenderPass
+{
+	RENDER_PASS_OPAQUE = 0,
+	RENDER_PASS_ALPHA_TEST = 1,
+	RENDER_PASS_TRANSPARENT = 2
+};
+
+//Everything needed to submit one draw call, so the submission doesn't go back to the components of the GameObject
+struct DrawItem
+{
+	GameObject* obj = nullptr;
+	ComponentMaterial* material = nullptr;
+	unsigned int material_id = 0; //Same id, same material render state. Set by RenderQueue::Add.
+	ComponentMesh* c_mesh = nullptr;
+	const Mesh* mesh = nullptr;
+	unsigned int shader_id = 0;
+	RenderPass pass = RENDER_PASS_OPAQUE;
+	bool animated = false;
+	bool instanced = false; //The program takes the model matrix per instance
+};
+
+/*
+	Draw calls of one camera, recorded first and submitted later in the order of a 64 bit sort key.
+	Opaque and alpha tested items: pass | shader | material | mesh | depth (front to back).
+	Transparent items: pass | depth (back to front) | shader | material | mesh.
+	Materials and meshes get a compact id the first time they are seen after Clear(). Key collisions only make the grouping worse.
+	Each GameObject has its own ComponentMaterial, so materials are told apart by their render state and not by pointer:
+	objects that look the same share an id and can be drawn together.
+	Sort() is a stable LSD radix sort, so items with equal keys keep the order they were added.
+*/
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	void Clear();
+	void Add(const DrawItem& item, float depth); //depth: distance to the camera
+	void Sort();
+
+	unsigned int Count()const;
+	const DrawItem& Get(unsigned int index)const; //In sorted order after Sort()
+	//Items from first on that can be drawn as instances of the first one: consecutive instanced items with the same program, material id and mesh
+	unsigned int CountInstances(unsigned int first)const;
+	//Items from first on that can go to one multi draw: consecutive instanced items with the same program, material id and vertex array.
+	//runs gets the number of CountInstances() runs among them, one draw command each.
+	unsigned int CountMultiDraw(unsigned int first, unsigned int& runs)const;
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		unsigned int item;
+	};
+
+	uint64_t MakeKey(const DrawItem& item, float depth);
+	unsigned int MaterialId(const ComponentMaterial* material);
+
+private:
+	std::vector<DrawItem> items;
+	std::vector<SortEntry> order;
+	std::vector<SortEntry> scratch;
+	std::unordered_map<const ComponentMaterial*, unsigned int> material_ids; //Each component is compared once per Clear()
+	std::unordered_multimap<size_t, unsigned int> material_hashes; //Render state hash -> material id
+	std::vector<const ComponentMaterial*> material_states; //First material seen with each id
+	std::unordered_map<const Mesh*, unsigned int> mesh_ids; //Meshes in the GeometryArena share their buffers, buffer ids don't tell them apart
+};
+
+//Layout read by glMultiDrawElementsIndirect
+struct DrawIndirectCommand
+{
+	unsigned int count = 0; //Indices
+	unsigned int instance_count = 0;
+	unsigned int first_index = 0;
+	int base_vertex = 0;
+	unsigned int base_instance = 0; //First element of the attributes with divisor
+};
+
+//State changes done while submitting a queue. The redundant ones skipped by RenderState are not counted.
+struct RenderQueueStats
+{
+	unsigned int draws = 0;
+	unsigned int instances = 0; //Objects drawn by instanced draws
+	unsigned int indirect_commands = 0; //Draws merged into multi draws, each multi draw counts once in draws
+	unsigned int program_changes = 0;
+	unsigned int material_changes = 0;
+	unsigned int buffer_binds = 0;
+	unsigned int texture_binds = 0;
+};
+
+/*
+	Shadow copy of the GL state touched by the render queue. Every call is skipped when it would not change anything.
+	Reset() forgets everything, call it before submitting because other code changes the GL state between queues.
+	Meshes keep their attributes and index buffer in a vertex array, so a mesh change is one BindVertexArray().
+	Attributes set with VertexAttrib() or InstanceMatrixAttrib() are stored in the bound vertex array: disable them after the draw.
+	Finish() leaves the state as the rest of the renderer expects it: vertex array 0, no blend, no alpha test and no textures.
+*/
+class RenderState
+{
+public:
+	RenderState();
+	~RenderState();
+
+	void Reset();
+	void Finish();
+
+	bool UseProgram(unsigned int program); //True if the program changed
+	void BindVertexArray(unsigned int vao);
+	void BindMesh(const Mesh& mesh); //Its vertex array, or its buffers and attributes when it has none
+	void VertexAttrib(unsigned int index, unsigned int buffer, int size, unsigned int type, bool integer = false); //Sets and enables it
+	void InstanceMatrixAttrib(unsigned int index, unsigned int buffer, unsigned int offset); //mat4 in attributes index to index + 3, one per instance
+	void DisableAttribs(unsigned int mask); //Bit i disables attribute i of the bound vertex array
+	void BindTexture(unsigned int unit, unsigned int texture);
+	void SetBlend(bool enabled, unsigned int dst_factor = 0);
+	void SetAlphaTest(bool enabled, float ref = 0.0f);
+	void DrawMesh(const Mesh& mesh); //With the mesh bound. Only meshes in the geometry arena need base vertex draws (GL 3.2).
+	void DrawMeshInstanced(const Mesh& mesh, unsigned int instances);
+	//commands: DrawIndirectCommand array in buffer. Every mesh drawn must share the bound vertex array and index_size.
+	void MultiDrawIndirect(unsigned int buffer, unsigned int first_command, unsigned int num_commands, unsigned int index_size, unsigned int instances);
+
+	const RenderQueueStats& GetStats()const;
+	void CountMaterialChange();
+
+private:
+	void BindArrayBuffer(unsigned int buffer);
+
+private:
+	unsigned int program;
+	unsigned int vertex_array;
+	unsigned int array_buffer;
+	unsigned int indirect_buffer;
+	unsigned int active_unit;
+	unsigned int textures[RENDER_STATE_MAX_TEXTURE_UNITS];
+	int blend; //-1 unknown
+	unsigned int blend_dst;
+	int alpha_test; //-1 unknown
+	float alpha_ref;
+
+	RenderQueueStats stats;
+};
+
+#endif // !__RENDER_QUEUE_H__
@@ -3,6 +3,7 @@
 #include "ResourceFileMaterial.h"
 #include "ShaderComplier.h"
 #include "Material.h"
+#include "ShaderReflection.h"
 
 ResourceFileMaterial::ResourceFileMaterial(ResourceFileType type, const std::string& file_path, unsigned int uuid) : ResourceFile(type, file_path, uuid)
 {}
@@ -15,6 +16,25 @@ uint ResourceFileMaterial::GetShaderId()
 	return shader_id;
 }
 
+const ShaderReflection * ResourceFileMaterial::GetShader() const
+{
+	return shader;
+}
+
+const std::vector<int>& ResourceFileMaterial::GetUniformLocations()
+{
+	//Resolved by name once, again only if the program is relinked or the uniforms of the material change
+	if (shader != nullptr && (shader->GetGeneration() != uniform_locations_generation || material.uniforms_version != uniform_locations_version))
+	{
+		uniform_locations.clear();
+		for (vector<Uniform*>::const_iterator uni = material.uniforms.begin(); uni != material.uniforms.end(); ++uni)
+			uniform_locations.push_back(shader->FindLocation((*uni)->name));
+		uniform_locations_generation = shader->GetGeneration();
+		uniform_locations_version = material.uniforms_version;
+	}
+	return uniform_locations;
+}
+
 
 void ResourceFileMaterial::LoadInMemory()
 {
@@ -22,6 +42,8 @@ void ResourceFileMaterial::LoadInMemory()
 	vertex_id = ShaderCompiler::CompileVertex(material.vertex_path.data());
 	fragment_id = ShaderCompiler::CompileFragment(material.fragment_path.data());
 	shader_id = ShaderCompiler::CompileShader(vertex_id, fragment_id);
+	shader = ShaderCompiler::GetReflection(shader_id);
+	GetUniformLocations();
 }
 
 void ResourceFileMaterial::UnloadInMemory()
@@ -29,4 +51,6 @@ void ResourceFileMaterial::UnloadInMemory()
 	ShaderCompiler::DeleteShader(vertex_id);
 	ShaderCompiler::DeleteShader(fragment_id);
 	ShaderCompiler::DeleteShader(shader_id);
+	shader = nullptr;
+	uniform_locations.clear();
 }
@@ -5,6 +5,10 @@
 #include "ResourceFileMaterial.h"
 #include "Material.h"
 
+#include <vector>
+
+class ShaderReflection;
+
 class ResourceFileMaterial : public ResourceFile
 {
 public:
@@ -12,6 +16,9 @@ public:
 	~ResourceFileMaterial();
 
 	uint GetShaderId();
+	const ShaderReflection* GetShader()const;
+	//Location of each uniform of the material in the program, same order as material.uniforms
+	const std::vector<int>& GetUniformLocations();
 
 private:
 
@@ -24,6 +31,10 @@ private:
 	uint shader_id = 0;
 	uint vertex_id = 0;
 	uint fragment_id = 0;
+	const ShaderReflection* shader = nullptr;
+	std::vector<int> uniform_locations;
+	uint uniform_locations_generation = 0; //Of the shader reflection they were resolved from
+	uint uniform_locations_version = 0; //Of material.uniforms
 
 };
 
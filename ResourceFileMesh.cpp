@@ -5,6 +5,7 @@
 #include "ComponentMesh.h"
 #include "MeshImporter.h"
 #include "ModuleResourceManager.h"
+#include "MeshBVH.h"
 
 ResourceFileMesh::ResourceFileMesh(ResourceFileType type, const std::string& file_path, unsigned int uuid) : ResourceFile(type, file_path, uuid)
 {
@@ -12,6 +13,7 @@ ResourceFileMesh::ResourceFileMesh(ResourceFileType type, const std::string& fil
 
 ResourceFileMesh::~ResourceFileMesh()
 {
+	DeleteBVH();
 	delete mesh;
 }
 
@@ -20,31 +22,48 @@ Mesh * ResourceFileMesh::GetMesh() const
 	return mesh;
 }
 
+MeshBVH * ResourceFileMesh::GetBVH()
+{
+	if (bvh == nullptr && mesh != nullptr && mesh->vertices != nullptr && mesh->indices != nullptr)
+	{
+		bvh = new MeshBVH();
+		bvh->Build(mesh->vertices, mesh->indices, mesh->num_indices);
+	}
+	return bvh;
+}
+
+void ResourceFileMesh::DeleteBVH()
+{
+	if (bvh)
+	{
+		delete bvh;
+		bvh = nullptr;
+	}
+}
+
 void ResourceFileMesh::ReLoadInMemory()
 {
-	App->renderer3D->RemoveBuffer(mesh->id_vertices);
-	App->renderer3D->RemoveBuffer(mesh->id_indices);
-	App->renderer3D->RemoveBuffer(mesh->id_uvs);
-	MeshImporter::LoadBuffers(mesh);
+	DeleteBVH();
+	MeshImporter::DeleteBuffers(mesh);
 
 	if (mesh)
 	{
-		bytes += sizeof(float) * 3 * mesh->num_vertices;
-		bytes += sizeof(uint) * mesh->num_indices;
-		bytes += sizeof(float) * 2 * mesh->num_uvs, mesh->uvs;
+		UploadBuffers();
+		bytes += MESH_VERTEX_STRIDE * mesh->num_vertices;
+		bytes += mesh->index_size * mesh->num_indices;
 	}
 
 }
 
 void ResourceFileMesh::LoadInMemory()
 {
-	mesh = MeshImporter::Load(file_path.data());
+	mesh = MeshImporter::Load(file_path.data(), false);
 
 	if (mesh)
 	{
-		bytes += sizeof(float) * 3 * mesh->num_vertices;
-		bytes += sizeof(uint) * mesh->num_indices;
-		bytes += sizeof(float) * 2 * mesh->num_uvs, mesh->uvs;
+		UploadBuffers();
+		bytes += MESH_VERTEX_STRIDE * mesh->num_vertices;
+		bytes += mesh->index_size * mesh->num_indices;
 	}
 	else
 	{
@@ -53,8 +72,16 @@ void ResourceFileMesh::LoadInMemory()
 	}
 }
 
+void ResourceFileMesh::UploadBuffers()
+{
+	//Static meshes share the buffers of the arena. The big ones get their own.
+	if (mesh->keep_out_of_arena || App->renderer3D->IsGeometryArenaSupported() == false || App->renderer3D->GetGeometryArena()->Add(mesh) == false)
+		MeshImporter::LoadBuffers(mesh);
+}
+
 void ResourceFileMesh::UnloadInMemory()
 {
+	DeleteBVH();
 	MeshImporter::DeleteBuffers(mesh);
 	App->resource_manager->RemoveResourceFromList(this);
 }
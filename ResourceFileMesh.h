@@ -5,6 +5,7 @@
 #include <string>
 
 struct Mesh;
+class MeshBVH;
 
 class ResourceFileMesh : public ResourceFile
 {
@@ -13,6 +14,7 @@ public:
 	~ResourceFileMesh();
 
 	Mesh* GetMesh() const;
+	MeshBVH* GetBVH(); //Built the first time it's requested
 
 	void ReLoadInMemory();
 	Mesh* mesh = nullptr;
@@ -21,7 +23,11 @@ private:
 	void UnloadInMemory();
 
 private:
-	
+	void DeleteBVH();
+	void UploadBuffers(); //To the geometry arena when the mesh can go there, to buffers of its own otherwise
+
+private:
+	MeshBVH* bvh = nullptr;
 };
 
 #endif // !__RESOURCEFILEMESH_H__
@@ -114,7 +114,7 @@ GameObject* ResourceFilePrefab::LoadPrefabFromScene(const Data & go_data, GameOb
 	bool is_static = root_prefab.GetBool("static");
 	int layer = root_prefab.GetInt("layer");
  
-	game_object->layer = layer;
+	game_object->SetLayer(layer);
 	game_object->local_uuid = local_uuid;
 
 	Data component;
@@ -134,7 +134,7 @@ GameObject* ResourceFilePrefab::LoadPrefabFromScene(const Data & go_data, GameOb
 		{
 			float4x4 transform_matrix = component.GetMatrix("matrix");
 			c_transform->SetScale(transform_matrix.GetScale());
-			c_transform->Update(); //To update the matrix manually
+			c_transform->ForceUpdate(); //To update the matrix manually
 		}
 	}
 
@@ -292,10 +292,10 @@ void ResourceFilePrefab::CreateChildsByUUID(const Data & go_data, map<unsigned i
 		go_component->Load(component);
 	}
 
-	if (is_static)
-		App->go_manager->octree.Insert(go, go->bounding_box->CenterPoint()); //Needs to go after the components because of the bounding box reference
-	else
-		App->go_manager->dynamic_gameobjects.push_back(go);
+	if (is_static == false)
+		App->go_manager->AddDynamicGameObject(go);
+	else if (go->bounding_box)
+		App->go_manager->octree.Insert(go, *go->bounding_box); //Needs to go after the components because of the bounding box reference
 
 	parents.push_back(go);
 }
@@ -410,7 +410,7 @@ void ResourceFilePrefab::ResetInstance(GameObject * origin, vector<GameObject*>&
 	bool is_static = root_prefab.GetBool("static");
 	int layer = root_prefab.GetInt("layer");
 
-	game_object->layer = layer;
+	game_object->SetLayer(layer);
 	game_object->local_uuid = local_uuid;
 
 	Data component;
@@ -430,7 +430,7 @@ void ResourceFilePrefab::ResetInstance(GameObject * origin, vector<GameObject*>&
 		{
 			float4x4 transform_matrix = component.GetMatrix("matrix");
 			c_transform->SetScale(transform_matrix.GetScale());
-			c_transform->Update(); //To update the matrix manually
+			c_transform->ForceUpdate(); //To update the matrix manually
 		}
 	}
 
@@ -1,6 +1,7 @@
 #include "Application.h"
 #include "ShaderComplier.h"
 #include "ModuleFileSystem.h"
+#include "ShaderReflection.h"
 #include "Glew\include\glew.h"
 #include "SDL\include\SDL_opengl.h"
 #include <gl/GL.h>
@@ -10,6 +11,13 @@
 #pragma comment (lib, "opengl32.lib") /* link Microsoft OpenGL lib   */
 #pragma comment (lib, "Glew/libx86/glew32.lib") 
 
+static std::map<unsigned int, ShaderReflection> reflections; //By program id
+
+static void ReflectProgram(unsigned int program_id)
+{
+	reflections[program_id].Reflect(program_id);
+}
+
 bool ShaderCompiler::TryCompileVertex(const char* path)
 {
 	char* buffer = nullptr;
@@ -210,10 +218,106 @@ int ShaderCompiler::CompileShader(unsigned int vertex_id, unsigned int fragment_
 		glGetProgramInfoLog(shader_program, 512, NULL, info);
 		LOG("Shader link error: %s", info);
 	}
+	else
+		ReflectProgram(shader_program);
 	
 	return shader_program;
 }
 
+//Fragment shader of the default material, shared by the default and the instanced shaders
+static const GLchar* default_fragment_code =
+	"#version 330 core\n"
+	"in vec2 TexCoord;\n"
+	"in vec3 normal0;\n"
+	"in vec3 tangent0;\n"
+	"in vec3 world_pos0;\n"
+	"out vec4 color;\n"
+	"uniform vec3 _EyeWorldPos;\n"
+	"uniform bool _HasTexture;\n"
+	"uniform sampler2D _Texture;\n"
+	"uniform sampler2D _NormalMap;\n"
+	"uniform bool _HasNormalMap;\n"
+	"uniform float _AmbientIntensity;\n"
+	"uniform vec3 _AmbientColor;\n"
+	"uniform bool _HasDirectional;\n"
+	"uniform float _DirectionalIntensity;\n"
+	"uniform vec3 _DirectionalColor;\n"
+	"uniform vec3 _DirectionalDirection;\n"
+	"uniform vec4 material_color;\n"
+	"uniform float _specular;\n"
+	"uniform float _alpha_val;\n"
+
+	"vec3 CalculateBumpedNormal()\n"
+	"{\n"
+	"	vec3 normal = normalize(normal0);\n"
+	"   vec3 tangent = normalize(tangent0);\n"
+	"   tangent = normalize(tangent - dot(tangent, normal) * normal);\n"
+	"   vec3 bitangent = cross(tangent, normal);\n"
+	"   vec3 bumpmap_normal = texture(_NormalMap, TexCoord).xyz;\n"
+	"   bumpmap_normal = 2.0f * bumpmap_normal - vec3(1.0f, 1.0f, 1.0f);\n"
+	"   vec3 new_normal;\n"
+	"   mat3 tan_bit_nor = mat3(tangent, bitangent, normal);\n"
+	"   new_normal = tan_bit_nor * bumpmap_normal;\n"
+	"   new_normal = normalize(new_normal);\n"
+	"   return new_normal;\n"
+	"}\n"
+
+	"float stepmix(float edge0, float edge1, float E, float x)\n"
+	"{\n"
+	"	float T = clamp(0.5f * (x - edge0 + E) / E, 0.0f, 1.0f);\n"
+	"	return mix(edge0, edge1, T);\n"
+	"}\n"
+
+	"float step(float edge, float x)\n"
+	"{\n"
+	"	return x < edge ? 0.0f : 1.0f;\n"
+	"}\n"
+
+	"void main()\n"
+	"{\n"
+	"   vec4 tex_color = (_HasTexture) ? texture(_Texture, TexCoord) : vec4(1,1,1,1);\n"
+	"	if(tex_color.a < _alpha_val) discard;\n"
+	"   vec3 new_normal = (_HasNormalMap) ? CalculateBumpedNormal() : normal0;\n"
+	"	vec4 ambient = vec4(_AmbientIntensity) * vec4(_AmbientColor, 1.0f);\n"
+	"	vec4 directional_color = vec4(_DirectionalColor * _DirectionalIntensity, 1.0f);\n"
+	"	float ddf = dot(normalize(new_normal), -_DirectionalDirection);\n"
+	"   vec4 diffuse = vec4(0,0,0,0);\n"
+	"   vec4 specular_color = vec4(0,0,0,0);\n"
+	"   if(_HasDirectional && ddf > 0)\n"
+	"   {\n"
+	"		const float A = 0.1f;\n"
+	"		const float B = 0.3f;\n"
+	"		const float C = 0.6f;\n"
+	"		const float D = 1.0f;\n"
+	"		float E = fwidth(ddf);\n"
+
+	"			 if(ddf > A - E && ddf < A + E) ddf = stepmix(A, B, E, ddf);\n"
+	"       else if(ddf > B - E && ddf < B + E) ddf = stepmix(B, C, E, ddf);\n"
+	"       else if(ddf > C - E && ddf < C + E) ddf = stepmix(C, D, E, ddf);\n"
+	"		else if(ddf < A) ddf = 0.0f;\n"
+	"		else if(ddf < B) ddf = B;\n"
+	"		else if(ddf < C) ddf = C;\n"
+	"		else ddf = D;\n"
+
+	"		diffuse = vec4(_DirectionalColor * _DirectionalIntensity * ddf, 1.0f);\n"
+
+	"       vec3 vertex_to_eye = normalize(_EyeWorldPos - world_pos0);\n"
+	"       vec3 light_reflect = normalize(reflect(_DirectionalDirection, normalize(normal0)));\n"
+	"       float sf = dot(vertex_to_eye, light_reflect);\n"
+	"       if(sf > 0)\n"
+	"       {\n"
+
+	"			E = fwidth(sf);\n"
+	"			if(sf > 0.5f - E && sf < 0.5f + E)\n"
+	"				sf = stepmix(0.5f, 0.8f, E, sf);\n"
+	"			else\n"
+	"				sf = step(0.5f, sf);\n"
+	"			specular_color = vec4(_DirectionalColor * _specular * sf, 1.0f);\n"
+	"       }\n"
+	"   }\n"
+	"	color = material_color * tex_color * (ambient + diffuse + specular_color);\n"
+	"}\n";
+
 int ShaderCompiler::LoadDefaultShader()
 {
 	GLuint vertex_shader, fragment_shader;
@@ -241,99 +345,69 @@ int ShaderCompiler::LoadDefaultShader()
 		"   world_pos0 = (model * vec4(position, 1.0f)).xyz;\n"
 		"}\n";
 
-	const GLchar* fragment_code =
-		"#version 330 core\n"
-		"in vec2 TexCoord;\n"
-		"in vec3 normal0;\n"
-		"in vec3 tangent0;\n"
-		"in vec3 world_pos0;\n"
-		"out vec4 color;\n"
-		"uniform vec3 _EyeWorldPos;\n"
-		"uniform bool _HasTexture;\n"
-		"uniform sampler2D _Texture;\n"
-		"uniform sampler2D _NormalMap;\n"
-		"uniform bool _HasNormalMap;\n"
-		"uniform float _AmbientIntensity;\n"
-		"uniform vec3 _AmbientColor;\n"
-		"uniform bool _HasDirectional;\n"
-		"uniform float _DirectionalIntensity;\n"
-		"uniform vec3 _DirectionalColor;\n"
-		"uniform vec3 _DirectionalDirection;\n"
-		"uniform vec4 material_color;\n"
-		"uniform float _specular;\n"
-		"uniform float _alpha_val;\n"
+	const GLchar* fragment_code = default_fragment_code;
 
-		"vec3 CalculateBumpedNormal()\n"
-		"{\n"
-		"	vec3 normal = normalize(normal0);\n"
-		"   vec3 tangent = normalize(tangent0);\n"
-		"   tangent = normalize(tangent - dot(tangent, normal) * normal);\n"
-		"   vec3 bitangent = cross(tangent, normal);\n"
-		"   vec3 bumpmap_normal = texture(_NormalMap, TexCoord).xyz;\n"
-		"   bumpmap_normal = 2.0f * bumpmap_normal - vec3(1.0f, 1.0f, 1.0f);\n"
-		"   vec3 new_normal;\n"
-		"   mat3 tan_bit_nor = mat3(tangent, bitangent, normal);\n"
-		"   new_normal = tan_bit_nor * bumpmap_normal;\n"
-		"   new_normal = normalize(new_normal);\n"
-		"   return new_normal;\n"
-		"}\n"
-
-		"float stepmix(float edge0, float edge1, float E, float x)\n"
-		"{\n"
-		"	float T = clamp(0.5f * (x - edge0 + E) / E, 0.0f, 1.0f);\n"
-		"	return mix(edge0, edge1, T);\n"
-		"}\n"
-
-		"float step(float edge, float x)\n"
-		"{\n"
-		"	return x < edge ? 0.0f : 1.0f;\n"
-		"}\n"
+	GLint success;
+	GLchar info[512];
 
-		"void main()\n"
-		"{\n"
-		"   vec4 tex_color = (_HasTexture) ? texture(_Texture, TexCoord) : vec4(1,1,1,1);\n"
-		"	if(tex_color.a < _alpha_val) discard;\n"
-		"   vec3 new_normal = (_HasNormalMap) ? CalculateBumpedNormal() : normal0;\n"
-		"	vec4 ambient = vec4(_AmbientIntensity) * vec4(_AmbientColor, 1.0f);\n"
-		"	vec4 directional_color = vec4(_DirectionalColor * _DirectionalIntensity, 1.0f);\n"
-		"	float ddf = dot(normalize(new_normal), -_DirectionalDirection);\n"
-		"   vec4 diffuse = vec4(0,0,0,0);\n"
-		"   vec4 specular_color = vec4(0,0,0,0);\n"
-		"   if(_HasDirectional && ddf > 0)\n"
-		"   {\n"
-		"		const float A = 0.1f;\n"
-		"		const float B = 0.3f;\n"
-		"		const float C = 0.6f;\n"
-		"		const float D = 1.0f;\n"
-		"		float E = fwidth(ddf);\n"
+	vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+	fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(vertex_shader, 1, &vertex_code, 0);
+	glShaderSource(fragment_shader, 1, &fragment_code, 0);
+	glCompileShader(vertex_shader);
+	
+	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
+	if (success == 0)
+	{
+		glGetShaderInfoLog(vertex_shader, 512, NULL, info);
+		LOG("Default shader vertex compilation error (%s)", info);
+	}
+	glCompileShader(fragment_shader);
+	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
+	if (success == 0)
+	{
+		glGetShaderInfoLog(fragment_shader, 512, NULL, info);
+		LOG("Default shader fragment compilation error (%s)", info);
+	}
 
-		"			 if(ddf > A - E && ddf < A + E) ddf = stepmix(A, B, E, ddf);\n"
-		"       else if(ddf > B - E && ddf < B + E) ddf = stepmix(B, C, E, ddf);\n"
-		"       else if(ddf > C - E && ddf < C + E) ddf = stepmix(C, D, E, ddf);\n"
-		"		else if(ddf < A) ddf = 0.0f;\n"
-		"		else if(ddf < B) ddf = B;\n"
-		"		else if(ddf < C) ddf = C;\n"
-		"		else ddf = D;\n"
+	glAttachShader(shader, vertex_shader);
+	glAttachShader(shader, fragment_shader);
+	glLinkProgram(shader);
+	ReflectProgram(shader);
 
-		"		diffuse = vec4(_DirectionalColor * _DirectionalIntensity * ddf, 1.0f);\n"
+	return shader;
+}
 
-		"       vec3 vertex_to_eye = normalize(_EyeWorldPos - world_pos0);\n"
-		"       vec3 light_reflect = normalize(reflect(_DirectionalDirection, normalize(normal0)));\n"
-		"       float sf = dot(vertex_to_eye, light_reflect);\n"
-		"       if(sf > 0)\n"
-		"       {\n"
+int ShaderCompiler::LoadDefaultInstancedShader()
+{
+	GLuint vertex_shader, fragment_shader;
+	GLuint shader = glCreateProgram();
 
-		"			E = fwidth(sf);\n"
-		"			if(sf > 0.5f - E && sf < 0.5f + E)\n"
-		"				sf = stepmix(0.5f, 0.8f, E, sf);\n"
-		"			else\n"
-		"				sf = step(0.5f, sf);\n"
-		"			specular_color = vec4(_DirectionalColor * _specular * sf, 1.0f);\n"
-		"       }\n"
-		"   }\n"
-		"	color = material_color * tex_color * (ambient + diffuse + specular_color);\n"
+	const GLchar* vertex_code =
+		"#version 330 core \n"
+		"layout(location = 0) in vec3 position;\n"
+		"layout(location = 1) in vec2 texCoord;\n"
+		"layout(location = 2) in vec3 normal;\n"
+		"layout(location = 3) in vec3 tangent;\n"
+		"layout(location = 6) in mat4 instance_model;\n" //One per instance, takes locations 6 to 9
+		"out vec2 TexCoord;\n"
+		"out vec3 normal0;\n"
+		"out vec3 tangent0;\n"
+		"out vec3 world_pos0;\n"
+		"uniform mat4 view;\n"
+		"uniform mat4 projection;\n"
+		"void main()\n"
+		"{\n"
+		"	mat4 model = instance_model;\n"
+		"	gl_Position = projection * view * model * vec4(position, 1.0f);\n"
+		"	TexCoord = texCoord;\n"
+		"	normal0 = (model * vec4(normal, 0.0f)).xyz;\n"
+		"   tangent0 = (model * vec4(tangent, 0.0f)).xyz;\n"
+		"   world_pos0 = (model * vec4(position, 1.0f)).xyz;\n"
 		"}\n";
 
+	const GLchar* fragment_code = default_fragment_code;
+
 	GLint success;
 	GLchar info[512];
 
@@ -347,19 +421,20 @@ int ShaderCompiler::LoadDefaultShader()
 	if (success == 0)
 	{
 		glGetShaderInfoLog(vertex_shader, 512, NULL, info);
-		LOG("Default shader vertex compilation error (%s)", info);
+		LOG("Default instanced shader vertex compilation error (%s)", info);
 	}
 	glCompileShader(fragment_shader);
 	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
 	if (success == 0)
 	{
 		glGetShaderInfoLog(fragment_shader, 512, NULL, info);
-		LOG("Default shader fragment compilation error (%s)", info);
+		LOG("Default instanced shader fragment compilation error (%s)", info);
 	}
 
 	glAttachShader(shader, vertex_shader);
 	glAttachShader(shader, fragment_shader);
 	glLinkProgram(shader);
+	ReflectProgram(shader);
 
 	return shader;
 }
@@ -520,6 +595,7 @@ int ShaderCompiler::LoadDefaultAnimShader()
 	glAttachShader(shader, vertex_shader);
 	glAttachShader(shader, fragment_shader);
 	glLinkProgram(shader);
+	ReflectProgram(shader);
 
 	return shader;
 }
@@ -714,6 +790,7 @@ int ShaderCompiler::LoadDefaultTerrainShader()
 	glAttachShader(shader, vertex_shader);
 	glAttachShader(shader, fragment_shader);
 	glLinkProgram(shader);
+	ReflectProgram(shader);
 
 	return shader;
 }
@@ -777,11 +854,29 @@ int ShaderCompiler::LoadDefaultBilboardShader()
 	glAttachShader(shader, vertex_shader);
 	glAttachShader(shader, fragment_shader);
 	glLinkProgram(shader);
+	ReflectProgram(shader);
 
 	return shader;
 }
 
 void ShaderCompiler::DeleteShader(unsigned int shader_id)
 {
-	glDeleteShader(shader_id);
+	if (glIsProgram(shader_id))
+	{
+		reflections.erase(shader_id);
+		glDeleteProgram(shader_id);
+	}
+	else
+		glDeleteShader(shader_id);
+}
+
+const ShaderReflection* ShaderCompiler::GetReflection(unsigned int program_id)
+{
+	std::map<unsigned int, ShaderReflection>::iterator it = reflections.find(program_id);
+	if (it != reflections.end())
+		return &it->second;
+
+	ShaderReflection& reflection = reflections[program_id];
+	reflection.Reflect(program_id);
+	return &reflection;
 }
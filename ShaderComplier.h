@@ -1,6 +1,8 @@
 #ifndef __SHADER_COMPILER_H__
 #define __SHADER_COMPILER_H__
 
+class ShaderReflection;
+
 namespace ShaderCompiler
 {
 	bool TryCompileVertex(const char* file_path);
@@ -11,11 +13,15 @@ namespace ShaderCompiler
 	int CompileFragment(const char* file_path);
 	int CompileShader(unsigned int vertex_id, unsigned int fragment_id);
 	int LoadDefaultShader();
+	int LoadDefaultInstancedShader(); //Default shader with the model matrix as a per instance attribute
 	int LoadDefaultAnimShader();
 	int LoadDefaultTerrainShader();
 	int LoadDefaultBilboardShader();
 
-	void DeleteShader(unsigned int shader_id);
+	void DeleteShader(unsigned int shader_id); //Shaders and programs
+
+	//Active uniforms of a program, reflected once after the link. Programs linked elsewhere are reflected the first time they are requested.
+	const ShaderReflection* GetReflection(unsigned int program_id);
 }
 
 #endif // !__SHADER_COMPILER_H__
@@ -0,0 +1,113 @@
+#include "ShaderReflection.h"
+
+#include "Glew\include\glew.h"
+#include <gl/GL.h>
+
+//Same order as ShaderSlot
+static const char* slot_names[NUM_SHADER_SLOTS] =
+{
+	"model",
+	"view",
+	"projection",
+	"bones",
+	"time",
+	"_EyeWorldPos",
+	"_AmbientIntensity",
+	"_AmbientColor",
+	"_HasDirectional",
+	"_DirectionalIntensity",
+	"_DirectionalColor",
+	"_DirectionalDirection",
+	"material_color",
+	"_specular",
+	"_alpha_val",
+	"_HasTexture",
+	"_Texture",
+	"_HasNormalMap",
+	"_NormalMap"
+};
+
+static unsigned int last_generation = 0; //Shared by all reflections: a program id reused after a relink still gets a new generation
+
+ShaderReflection::ShaderReflection()
+{
+	for (int i = 0; i < NUM_SHADER_SLOTS; i++)
+		slots[i] = -1;
+}
+
+ShaderReflection::~ShaderReflection()
+{}
+
+void ShaderReflection::Reflect(unsigned int program)
+{
+	this->program = program;
+	generation = ++last_generation;
+	uniforms.clear();
+	lookup.clear();
+	for (int i = 0; i < NUM_SHADER_SLOTS; i++)
+		slots[i] = -1;
+
+	GLint linked = 0;
+	if (program == 0 || glIsProgram(program) == GL_FALSE)
+		return;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked == 0)
+		return;
+
+	GLint count = 0, max_length = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+	std::vector<GLchar> name(max_length + 1);
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program, i, name.size(), &length, &size, &type, name.data());
+
+		ShaderUniform uniform;
+		uniform.name = std::string(name.data(), length);
+		if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+			uniform.name.resize(uniform.name.size() - 3);
+		uniform.type = type;
+		uniform.size = size;
+		uniform.location = glGetUniformLocation(program, uniform.name.data());
+
+		//Uniforms of uniform blocks have no location
+		if (uniform.location == -1)
+			continue;
+
+		lookup[uniform.name] = uniforms.size();
+		uniforms.push_back(uniform);
+	}
+
+	for (int i = 0; i < NUM_SHADER_SLOTS; i++)
+		slots[i] = FindLocation(slot_names[i]);
+}
+
+unsigned int ShaderReflection::GetProgram() const
+{
+	return program;
+}
+
+unsigned int ShaderReflection::GetGeneration() const
+{
+	return generation;
+}
+
+int ShaderReflection::GetLocation(ShaderSlot slot) const
+{
+	return slots[slot];
+}
+
+int ShaderReflection::FindLocation(const std::string & name) const
+{
+	std::map<std::string, unsigned int>::const_iterator it = lookup.find(name);
+	return (it != lookup.end()) ? uniforms[it->second].location : -1;
+}
+
+const std::vector<ShaderUniform>& ShaderReflection::GetUniforms() const
+{
+	return uniforms;
+}
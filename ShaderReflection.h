@@ -0,0 +1,68 @@
+#ifndef __SHADER_REFLECTION_H__
+#define __SHADER_REFLECTION_H__
+
+#include <string>
+#include <vector>
+#include <map>
+
+//Uniforms the engine sets by itself. Each one has a fixed slot, -1 when the program doesn't use it.
+enum ShaderSlot
+{
+	SLOT_MODEL,
+	SLOT_VIEW,
+	SLOT_PROJECTION,
+	SLOT_BONES,
+	SLOT_TIME,
+	SLOT_EYE_WORLD_POS,
+	SLOT_AMBIENT_INTENSITY,
+	SLOT_AMBIENT_COLOR,
+	SLOT_HAS_DIRECTIONAL,
+	SLOT_DIRECTIONAL_INTENSITY,
+	SLOT_DIRECTIONAL_COLOR,
+	SLOT_DIRECTIONAL_DIRECTION,
+	SLOT_MATERIAL_COLOR,
+	SLOT_SPECULAR,
+	SLOT_ALPHA_VAL,
+	SLOT_HAS_TEXTURE,
+	SLOT_TEXTURE,
+	SLOT_HAS_NORMAL_MAP,
+	SLOT_NORMAL_MAP,
+	NUM_SHADER_SLOTS
+};
+
+struct ShaderUniform
+{
+	std::string name; //Arrays without the "[0]"
+	unsigned int type = 0; //GL type (GL_FLOAT_VEC3, GL_SAMPLER_2D...)
+	int size = 1; //Elements of an array
+	int location = -1;
+};
+
+/*
+	Active uniforms of a linked program, enumerated once after the link.
+	Built-in uniforms are read by slot with GetLocation(). FindLocation() looks up by name and is meant for
+	resolving material uniforms once, never for each draw.
+*/
+class ShaderReflection
+{
+public:
+	ShaderReflection();
+	~ShaderReflection();
+
+	void Reflect(unsigned int program);
+
+	unsigned int GetProgram()const;
+	unsigned int GetGeneration()const; //Changes on every Reflect(). Locations cached from an older generation are stale.
+	int GetLocation(ShaderSlot slot)const;
+	int FindLocation(const std::string& name)const;
+	const std::vector<ShaderUniform>& GetUniforms()const;
+
+private:
+	unsigned int program = 0;
+	unsigned int generation = 0;
+	int slots[NUM_SHADER_SLOTS];
+	std::vector<ShaderUniform> uniforms;
+	std::map<std::string, unsigned int> lookup; //Name to index in uniforms
+};
+
+#endif // !__SHADER_REFLECTION_H__
@@ -77,11 +77,11 @@ void Skybox::Render(ComponentCamera* camera)
 		//Buffer vertices
 		glEnableVertexAttribArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, sphere_mesh->id_vertices);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE, (GLvoid*)0);
 
 		//Index buffer
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphere_mesh->id_indices);
-		glDrawElements(GL_TRIANGLES, sphere_mesh->num_indices, GL_UNSIGNED_INT, (void*)0);
+		glDrawElements(GL_TRIANGLES, sphere_mesh->num_indices, (sphere_mesh->index_size == sizeof(GLushort)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)0);
 
 	}
 
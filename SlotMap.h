@@ -0,0 +1,169 @@
+#ifndef __SLOT_MAP_H__
+#define __SLOT_MAP_H__
+
+#include <vector>
+#include <type_traits>
+#include <new>
+
+#define SLOT_MAP_CHUNK_SIZE 256 //Slots per chunk. Chunks are never moved or freed until the map is destroyed.
+
+//Index + generation. A handle stays invalid forever once its item is released, even if the slot is reused.
+template<class T>
+struct SlotHandle
+{
+	unsigned int index = 0;
+	unsigned int generation = 0; //0 is never used by a live slot
+
+	bool operator==(const SlotHandle& other)const { return index == other.index && generation == other.generation; }
+	bool operator!=(const SlotHandle& other)const { return !(*this == other); }
+	bool IsNull()const { return generation == 0; }
+};
+
+/*
+	Generational slot map. Items live in fixed size chunks so their address never changes.
+	Create/Release/Get are O(1). Released slots go to a free list and bump their generation so old handles fail to resolve.
+	Two ways to use it:
+		- Allocate/Release: raw storage for one T, constructed by the caller (used by GameObject::operator new).
+		- Insert/Erase: stores a copy of the value.
+	Tag is the type the handles are for. It only differs from T when the map stores pointers (SlotMap<Component*, Component>).
+*/
+template<class T, class Tag = T>
+class SlotMap
+{
+public:
+	SlotMap()
+	{}
+
+	~SlotMap()
+	{
+		for (unsigned int i = 0; i < chunks.size(); i++)
+			delete[] chunks[i];
+		chunks.clear();
+	}
+
+	void* Allocate(SlotHandle<Tag>& handle)
+	{
+		if (first_free == NO_SLOT)
+			AddChunk();
+
+		Slot* slot = GetSlot(first_free);
+		first_free = slot->next_free;
+		slot->next_free = NO_SLOT;
+		slot->alive = true;
+		++count;
+
+		handle.index = slot->index;
+		handle.generation = slot->generation;
+		return &slot->storage;
+	}
+
+	//Frees the slot of an item returned by Allocate. The item must be already destroyed.
+	void Release(const void* item)
+	{
+		Slot* slot = (Slot*)item; //storage is the first member
+		if (slot->alive == false)
+			return;
+
+		slot->alive = false;
+		if (++slot->generation == 0)
+			slot->generation = 1;
+		slot->next_free = first_free;
+		first_free = slot->index;
+		--count;
+	}
+
+	SlotHandle<Tag> Insert(const T& value)
+	{
+		SlotHandle<Tag> handle;
+		new (Allocate(handle)) T(value);
+		return handle;
+	}
+
+	void Erase(const SlotHandle<Tag>& handle)
+	{
+		T* item = Get(handle);
+		if (item)
+		{
+			item->~T();
+			Release(item);
+		}
+	}
+
+	//nullptr if the handle was never valid or its item was released
+	T* Get(const SlotHandle<Tag>& handle)const
+	{
+		if (handle.generation == 0 || handle.index >= num_slots)
+			return nullptr;
+
+		Slot* slot = GetSlot(handle.index);
+		return (slot->alive && slot->generation == handle.generation) ? (T*)&slot->storage : nullptr;
+	}
+
+	bool IsValid(const SlotHandle<Tag>& handle)const
+	{
+		return Get(handle) != nullptr;
+	}
+
+	//Handle of an item returned by Allocate/Insert. Null handle if the slot is not alive.
+	SlotHandle<Tag> GetHandle(const T* item)const
+	{
+		SlotHandle<Tag> handle;
+		const Slot* slot = (const Slot*)item;
+		if (item != nullptr && slot->alive)
+		{
+			handle.index = slot->index;
+			handle.generation = slot->generation;
+		}
+		return handle;
+	}
+
+	unsigned int Count()const
+	{
+		return count;
+	}
+
+	unsigned int Capacity()const
+	{
+		return num_slots;
+	}
+
+private:
+	static const unsigned int NO_SLOT = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage; //Must stay the first member
+		unsigned int index = 0;
+		unsigned int generation = 1;
+		unsigned int next_free = NO_SLOT;
+		bool alive = false;
+	};
+
+	void AddChunk()
+	{
+		Slot* chunk = new Slot[SLOT_MAP_CHUNK_SIZE];
+		chunks.push_back(chunk);
+
+		//Link the new slots in order so allocation walks the chunk forward
+		for (unsigned int i = 0; i < SLOT_MAP_CHUNK_SIZE; i++)
+		{
+			chunk[i].index = num_slots + i;
+			chunk[i].next_free = (i + 1 < SLOT_MAP_CHUNK_SIZE) ? num_slots + i + 1 : first_free;
+		}
+		first_free = num_slots;
+		num_slots += SLOT_MAP_CHUNK_SIZE;
+	}
+
+	Slot* GetSlot(unsigned int index)const
+	{
+		return &chunks[index / SLOT_MAP_CHUNK_SIZE][index % SLOT_MAP_CHUNK_SIZE];
+	}
+
+private:
+	std::vector<Slot*> chunks;
+	unsigned int first_free = NO_SLOT;
+	unsigned int num_slots = 0;
+	unsigned int count = 0;
+};
+
+#endif // !__SLOT_MAP_H__
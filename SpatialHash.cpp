@@ -0,0 +1,299 @@
+#include "SpatialHash.h"
+#include "GameObject.h"
+#include "ComponentTransform.h"
+
+#include <algorithm>
+
+#define SPATIAL_HASH_MAX_COORD 1000000 //Cell coordinates are clamped so far away objects don't overflow
+
+SpatialHash::SpatialHash(float cell_size) : cell_size(cell_size)
+{}
+
+SpatialHash::~SpatialHash()
+{}
+
+int SpatialHash::CellCoord(float value) const
+{
+	float cell = floorf(value / cell_size);
+	return (int)math::Clamp(cell, (float)-SPATIAL_HASH_MAX_COORD, (float)SPATIAL_HASH_MAX_COORD);
+}
+
+long long SpatialHash::CellKey(int x, int z)
+{
+	return ((long long)x << 32) | (unsigned int)z;
+}
+
+void SpatialHash::Update(GameObject * go)
+{
+	if (go == nullptr || go->transform == nullptr)
+		return;
+
+	unsigned int index;
+	std::unordered_map<const GameObject*, unsigned int>::iterator it = lookup.find(go);
+	if (it == lookup.end())
+	{
+		if (free_entries.empty())
+		{
+			index = entries.size();
+			entries.push_back(Entry());
+		}
+		else
+		{
+			index = free_entries.back();
+			free_entries.pop_back();
+		}
+		entries[index].go = go;
+		lookup[go] = index;
+	}
+	else
+		index = it->second;
+
+	Entry& entry = entries[index];
+	if (go->bounding_box)
+		entry.box = *go->bounding_box;
+	else
+	{
+		float3 position = go->GetGlobalMatrix().TranslatePart();
+		entry.box = AABB(position, position);
+	}
+
+	int x0 = CellCoord(entry.box.minPoint.x), x1 = CellCoord(entry.box.maxPoint.x);
+	int z0 = CellCoord(entry.box.minPoint.z), z1 = CellCoord(entry.box.maxPoint.z);
+	bool oversized = (x1 - x0 >= SPATIAL_HASH_MAX_CELLS || z1 - z0 >= SPATIAL_HASH_MAX_CELLS);
+
+	//Most updates are small moves inside the same cells
+	if (oversized == entry.oversized && (oversized || (x0 == entry.x0 && x1 == entry.x1 && z0 == entry.z0 && z1 == entry.z1)))
+		return;
+
+	RemoveFromCells(index);
+	entry.oversized = oversized;
+	if (oversized == false)
+	{
+		entry.x0 = x0; entry.x1 = x1;
+		entry.z0 = z0; entry.z1 = z1;
+	}
+	AddToCells(index);
+}
+
+void SpatialHash::Remove(const GameObject * go)
+{
+	std::unordered_map<const GameObject*, unsigned int>::iterator it = lookup.find(go);
+	if (it == lookup.end())
+		return;
+
+	unsigned int index = it->second;
+	RemoveFromCells(index);
+	entries[index] = Entry();
+	free_entries.push_back(index);
+	lookup.erase(it);
+}
+
+bool SpatialHash::Contains(const GameObject * go) const
+{
+	return lookup.find(go) != lookup.end();
+}
+
+void SpatialHash::Clear()
+{
+	entries.clear();
+	free_entries.clear();
+	lookup.clear();
+	cells.clear();
+	oversized.clear();
+	used_x0 = used_z0 = 0;
+	used_x1 = used_z1 = -1;
+}
+
+unsigned int SpatialHash::Count() const
+{
+	return lookup.size();
+}
+
+void SpatialHash::AddToCells(unsigned int index)
+{
+	Entry& entry = entries[index];
+	if (entry.oversized)
+	{
+		oversized.push_back(index);
+		return;
+	}
+
+	for (int z = entry.z0; z <= entry.z1; z++)
+		for (int x = entry.x0; x <= entry.x1; x++)
+			cells[CellKey(x, z)].push_back(index);
+
+	if (used_x1 < used_x0)
+	{
+		used_x0 = entry.x0; used_x1 = entry.x1;
+		used_z0 = entry.z0; used_z1 = entry.z1;
+	}
+	else
+	{
+		used_x0 = std::min(used_x0, entry.x0); used_x1 = std::max(used_x1, entry.x1);
+		used_z0 = std::min(used_z0, entry.z0); used_z1 = std::max(used_z1, entry.z1);
+	}
+}
+
+void SpatialHash::RemoveFromCells(unsigned int index)
+{
+	Entry& entry = entries[index];
+	if (entry.oversized)
+	{
+		std::vector<unsigned int>::iterator it = std::find(oversized.begin(), oversized.end(), index);
+		if (it != oversized.end())
+		{
+			*it = oversized.back();
+			oversized.pop_back();
+		}
+		entry.oversized = false;
+		return;
+	}
+
+	for (int z = entry.z0; z <= entry.z1; z++)
+	{
+		for (int x = entry.x0; x <= entry.x1; x++)
+		{
+			std::unordered_map<long long, std::vector<unsigned int>>::iterator cell = cells.find(CellKey(x, z));
+			if (cell == cells.end())
+				continue;
+
+			std::vector<unsigned int>& list = cell->second;
+			std::vector<unsigned int>::iterator it = std::find(list.begin(), list.end(), index);
+			if (it != list.end())
+			{
+				*it = list.back();
+				list.pop_back();
+			}
+			if (list.empty())
+				cells.erase(cell);
+		}
+	}
+	entry.x0 = entry.z0 = 0;
+	entry.x1 = entry.z1 = -1;
+}
+
+bool SpatialHash::Accept(const Entry & entry, unsigned int layer_mask) const
+{
+	if (entry.stamp == query_stamp)
+		return false;
+	entry.stamp = query_stamp;
+
+	int layer = entry.go->layer;
+	if (layer < 0 || layer > 31 || (layer_mask & (1u << layer)) == 0)
+		return false;
+	return entry.go->IsActive();
+}
+
+template<class Visitor>
+void SpatialHash::VisitCells(int x0, int z0, int x1, int z1, Visitor visit) const
+{
+	//Nothing outside the used cells. Keeps big queries from walking empty space.
+	x0 = std::max(x0, used_x0); x1 = std::min(x1, used_x1);
+	z0 = std::max(z0, used_z0); z1 = std::min(z1, used_z1);
+
+	for (int z = z0; z <= z1; z++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			std::unordered_map<long long, std::vector<unsigned int>>::const_iterator cell = cells.find(CellKey(x, z));
+			if (cell == cells.end())
+				continue;
+			for (std::vector<unsigned int>::const_iterator it = cell->second.begin(); it != cell->second.end(); ++it)
+				visit(*it);
+		}
+	}
+}
+
+void SpatialHash::OverlapSphere(const float3 & center, float radius, std::vector<GameObject*>& result, unsigned int layer_mask) const
+{
+	++query_stamp;
+	VisitCells(CellCoord(center.x - radius), CellCoord(center.z - radius), CellCoord(center.x + radius), CellCoord(center.z + radius), [&](unsigned int index)
+	{
+		const Entry& entry = entries[index];
+		if (Accept(entry, layer_mask) && entry.box.Distance(center) <= radius)
+			result.push_back(entry.go);
+	});
+
+	for (std::vector<unsigned int>::const_iterator it = oversized.begin(); it != oversized.end(); ++it)
+	{
+		const Entry& entry = entries[*it];
+		if (Accept(entry, layer_mask) && entry.box.Distance(center) <= radius)
+			result.push_back(entry.go);
+	}
+}
+
+void SpatialHash::OverlapAABB(const AABB & box, std::vector<GameObject*>& result, unsigned int layer_mask) const
+{
+	++query_stamp;
+	VisitCells(CellCoord(box.minPoint.x), CellCoord(box.minPoint.z), CellCoord(box.maxPoint.x), CellCoord(box.maxPoint.z), [&](unsigned int index)
+	{
+		const Entry& entry = entries[index];
+		if (Accept(entry, layer_mask) && entry.box.Intersects(box))
+			result.push_back(entry.go);
+	});
+
+	for (std::vector<unsigned int>::const_iterator it = oversized.begin(); it != oversized.end(); ++it)
+	{
+		const Entry& entry = entries[*it];
+		if (Accept(entry, layer_mask) && entry.box.Intersects(box))
+			result.push_back(entry.go);
+	}
+}
+
+void SpatialHash::Nearest(const float3 & point, unsigned int k, std::vector<GameObject*>& result, unsigned int layer_mask, float max_distance) const
+{
+	if (k == 0 || lookup.empty())
+		return;
+
+	++query_stamp;
+	candidates.clear();
+	auto consider = [&](unsigned int index)
+	{
+		const Entry& entry = entries[index];
+		if (Accept(entry, layer_mask))
+		{
+			float distance = entry.box.Distance(point);
+			if (distance <= max_distance)
+				candidates.push_back(std::pair<float, unsigned int>(distance, index));
+		}
+	};
+
+	for (std::vector<unsigned int>::const_iterator it = oversized.begin(); it != oversized.end(); ++it)
+		consider(*it);
+
+	//Rings of cells around the cell of the point. Everything not seen after ring r is at least r cells away.
+	int cx = CellCoord(point.x);
+	int cz = CellCoord(point.z);
+	int max_ring = -1;
+	if (used_x1 >= used_x0)
+		max_ring = std::max(std::max(std::abs(cx - used_x0), std::abs(used_x1 - cx)), std::max(std::abs(cz - used_z0), std::abs(used_z1 - cz)));
+
+	for (int r = 0; r <= max_ring; r++)
+	{
+		float ring_distance = r * cell_size;
+		if (r > 0 && ring_distance - cell_size > max_distance)
+			break;
+
+		if (r == 0)
+			VisitCells(cx, cz, cx, cz, consider);
+		else
+		{
+			VisitCells(cx - r, cz - r, cx + r, cz - r, consider); //Bottom row
+			VisitCells(cx - r, cz + r, cx + r, cz + r, consider); //Top row
+			VisitCells(cx - r, cz - r + 1, cx - r, cz + r - 1, consider); //Left column
+			VisitCells(cx + r, cz - r + 1, cx + r, cz + r - 1, consider); //Right column
+		}
+
+		if (candidates.size() >= k)
+		{
+			std::nth_element(candidates.begin(), candidates.begin() + (k - 1), candidates.end());
+			if (candidates[k - 1].first <= ring_distance)
+				break;
+		}
+	}
+
+	unsigned int count = std::min((unsigned int)candidates.size(), k);
+	std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end());
+	for (unsigned int i = 0; i < count; i++)
+		result.push_back(entries[candidates[i].second].go);
+}
@@ -0,0 +1,72 @@
+#ifndef __SPATIAL_HASH_H__
+#define __SPATIAL_HASH_H__
+
+#include "MathGeoLib\include\MathGeoLib.h"
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#define SPATIAL_HASH_CELL_SIZE 10.0f
+#define SPATIAL_HASH_MAX_CELLS 8 //Objects covering more cells than this per side go to a list that every query checks
+
+class GameObject;
+
+/*
+	Uniform grid over the XZ plane for proximity queries of gameplay code.
+	Each GameObject is stored in every cell its bounds touch: the mesh bounding box or, without mesh, its world position.
+	Only the cells of a query are visited, so many small queries per frame are cheap and never touch the physics broadphase.
+	Queries skip inactive GameObjects and filter by layer_mask, with one bit per layer like the camera layer mask.
+	Not thread safe: updates and queries must run on the main thread.
+*/
+class SpatialHash
+{
+public:
+	SpatialHash(float cell_size = SPATIAL_HASH_CELL_SIZE);
+	~SpatialHash();
+
+	void Update(GameObject* go); //Inserts the GameObject or moves it to the cells of its current bounds
+	void Remove(const GameObject* go);
+	bool Contains(const GameObject* go)const;
+	void Clear();
+	unsigned int Count()const;
+
+	//Results are appended
+	void OverlapSphere(const float3& center, float radius, std::vector<GameObject*>& result, unsigned int layer_mask = 0xFFFFFFFF)const;
+	void OverlapAABB(const AABB& box, std::vector<GameObject*>& result, unsigned int layer_mask = 0xFFFFFFFF)const;
+	void Nearest(const float3& point, unsigned int k, std::vector<GameObject*>& result, unsigned int layer_mask = 0xFFFFFFFF, float max_distance = FLOAT_INF)const; //Nearest first, by distance to the bounds
+
+private:
+	struct Entry
+	{
+		GameObject* go = nullptr;
+		AABB box;
+		int x0 = 0, z0 = 0, x1 = -1, z1 = -1; //Cell range. Empty while the entry is in the oversized list or free.
+		bool oversized = false;
+		mutable unsigned int stamp = 0; //Last query that visited the entry. Avoids duplicates of objects in several cells.
+	};
+
+	int CellCoord(float value)const;
+	static long long CellKey(int x, int z);
+	void AddToCells(unsigned int index);
+	void RemoveFromCells(unsigned int index);
+	bool Accept(const Entry& entry, unsigned int layer_mask)const;
+	template<class Visitor>
+	void VisitCells(int x0, int z0, int x1, int z1, Visitor visit)const;
+
+private:
+	float cell_size;
+	std::vector<Entry> entries;
+	std::vector<unsigned int> free_entries;
+	std::unordered_map<const GameObject*, unsigned int> lookup;
+	std::unordered_map<long long, std::vector<unsigned int>> cells;
+	std::vector<unsigned int> oversized;
+
+	//Cells used so far. Only grows, bounds the rings walked by Nearest.
+	int used_x0 = 0, used_z0 = 0, used_x1 = -1, used_z1 = -1;
+
+	mutable unsigned int query_stamp = 0;
+	mutable std::vector<std::pair<float, unsigned int>> candidates; //Scratch of Nearest
+};
+
+#endif // !__SPATIAL_HASH_H__
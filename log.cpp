@@ -2,11 +2,15 @@
 #include "Globals.h"
 #include "Console.h"
 
+#include <mutex>
+
 void log(const char file[], int line, const char* format, ...)
 {
 	static char tmp_string[4096];
 	static char tmp_string2[4096];
 	static va_list  ap;
+	static std::mutex log_mutex; //Components may log from the job system workers
+	std::lock_guard<std::mutex> lock(log_mutex);
 
 	// Construct the string from variable arguments
 	va_start(ap, format);